@@ -0,0 +1,291 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+/* microbenchmarks of the kernel's libc and scheduler core on the host
+ *
+ * usage: bench [-l] [filter]
+ *
+ * runs every benchmark whose name contains filter and prints one line per
+ * benchmark in the format of the kernel benchmarks. the binary is meant to
+ * be run under perf and valgrind, e.g.
+ *
+ *   perf record -g host/bench schedule
+ *   valgrind --tool=callgrind host/bench printf
+ */
+
+#include "mock/hw.h"
+
+#include "kernel/page_alloc.h"
+#include "kernel/scheduler.h"
+#include "kernel/softirq.h"
+#include "kernel/timeout.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 5
+
+// tasks in the run queue during the scheduler benchmarks
+#define SCHED_TASKS 8
+
+static unsigned char src[4096];
+static unsigned char dst[4096];
+
+static volatile int sink;
+
+// ## libc
+
+static void
+bench_memcpy_64 (unsigned int n)
+{
+  while (n--)
+    ns_memcpy(dst, src, 64);
+}
+
+static void
+bench_memcpy_1500 (unsigned int n)
+{
+  while (n--)
+    ns_memcpy(dst, src, 1500);
+}
+
+static void
+bench_memcpy_4096 (unsigned int n)
+{
+  while (n--)
+    ns_memcpy(dst, src, 4096);
+}
+
+static void
+bench_memset_1500 (unsigned int n)
+{
+  while (n--)
+    ns_memset(dst, n, 1500);
+}
+
+static void
+bench_memcmp_1500 (unsigned int n)
+{
+  while (n--)
+    sink = ns_memcmp(dst, src, 1500);
+}
+
+static void
+bench_printf (unsigned int n)
+{
+  while (n--)
+    ns_printf("  task %i: %s 0x%x %u%%\n", n, "shuriken", n, n % 100);
+}
+
+// ## Scheduler
+//
+// the tasks never run, the benchmarks drive the scheduler the way the
+// interrupt and syscall paths do
+
+static void
+task_entry (void)
+{ }
+
+static void
+bench_schedule (unsigned int n)
+{
+  while (n--)
+    schedule();
+}
+
+static void
+bench_tick_sleep (unsigned int n)
+{
+  while (n--)
+    {
+      sleep_current_task(1);
+      scheduler_tick();
+    }
+}
+
+static void
+bench_block_wake (unsigned int n)
+{
+  wait_queue_t queue = { 0 };
+  while (n--)
+    {
+      block_current_task(&queue, 0);
+      schedule();
+      wake_up(&queue);
+    }
+}
+
+static unsigned int
+noop_softirq (unsigned int budget)
+{
+  return 1;
+}
+
+static void
+bench_softirq (unsigned int n)
+{
+  while (n--)
+    {
+      softirq_raise(SOFTIRQ_NET_RX);
+      softirq_run();
+    }
+}
+
+// ## Timeouts
+
+#define TIMEOUTS 64
+
+static void
+timeout_noop (void *arg)
+{ }
+
+static void
+bench_timeout_add_del (unsigned int n)
+{
+  struct timeout t[TIMEOUTS];
+  unsigned int i;
+  for (i = 0; i < TIMEOUTS; ++i)
+    timeout_set(&t[i], &timeout_noop, 0);
+
+  while (n--)
+    {
+      for (i = 0; i < TIMEOUTS; ++i)
+        timeout_add(&t[i], (i * 37 + n) % 97 + 1);
+      for (i = 0; i < TIMEOUTS; ++i)
+        timeout_del(&t[i]);
+    }
+}
+
+static void
+bench_timeout_run (unsigned int n)
+{
+  struct timeout t[TIMEOUTS];
+  unsigned int i;
+  for (i = 0; i < TIMEOUTS; ++i)
+    timeout_set(&t[i], &timeout_noop, 0);
+
+  while (n--)
+    {
+      for (i = 0; i < TIMEOUTS; ++i)
+        timeout_add(&t[i], 1);
+      tick_count++;
+      timeout_run();
+    }
+}
+
+// ## Page allocator
+
+static void
+bench_page_alloc (unsigned int n)
+{
+  while (n--)
+    page_put(page_alloc());
+}
+
+struct bench
+{
+  const char *name;
+  void (*fn) (unsigned int n);
+  unsigned int iterations;
+};
+
+static const struct bench benches[] =
+{
+  { "memcpy_64", &bench_memcpy_64, 100000 },
+  { "memcpy_1500", &bench_memcpy_1500, 10000 },
+  { "memcpy_4096", &bench_memcpy_4096, 5000 },
+  { "memset_1500", &bench_memset_1500, 10000 },
+  { "memcmp_1500", &bench_memcmp_1500, 10000 },
+  { "printf", &bench_printf, 20000 },
+  { "schedule", &bench_schedule, 1000000 },
+  { "tick_sleep", &bench_tick_sleep, 1000000 },
+  { "block_wake", &bench_block_wake, 1000000 },
+  { "softirq", &bench_softirq, 1000000 },
+  { "timeout_add_del", &bench_timeout_add_del, 10000 },
+  { "timeout_run", &bench_timeout_run, 10000 },
+  { "page_alloc", &bench_page_alloc, 1000000 },
+};
+#define BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static unsigned long long
+now_ns (void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// run one round to warm up, then ROUNDS rounds, and report the fastest and
+// the average round like the kernel benchmarks do
+static void
+run (const struct bench *bench)
+{
+  bench->fn(bench->iterations);
+
+  unsigned long long min = ~0ULL, total = 0;
+  unsigned int round;
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      unsigned long long start = now_ns();
+      bench->fn(bench->iterations);
+      unsigned long long elapsed = now_ns() - start;
+
+      total += elapsed;
+      if (elapsed < min)
+        min = elapsed;
+    }
+
+  printf("bench: %s iterations=%u min_ns=%llu avg_ns=%llu\n", bench->name,
+         bench->iterations, min / bench->iterations,
+         total / ROUNDS / bench->iterations);
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *filter = "";
+  int list = 0;
+  int i;
+  for (i = 1; i < argc; ++i)
+    if (!strcmp(argv[i], "-l"))
+      list = 1;
+    else
+      filter = argv[i];
+
+  unsigned int b;
+  if (list)
+    {
+      for (b = 0; b < BENCHES; ++b)
+        puts(benches[b].name);
+      return 0;
+    }
+
+  for (b = 0; b < SCHED_TASKS; ++b)
+    add_task(&task_entry);
+  softirq_register(SOFTIRQ_NET_RX, "net_rx", &noop_softirq, 1);
+  start_scheduler();
+
+  for (b = 0; b < BENCHES; ++b)
+    if (strstr(benches[b].name, filter))
+      run(&benches[b]);
+
+  return 0;
+}
@@ -0,0 +1,194 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+/* mock of the hardware layer below the kernel code of the host build
+ *
+ * the timer counter is backed by the monotonic clock of the host and the
+ * page pool is mapped at its physical address, all other hardware calls do
+ * nothing. console output of the kernel's libc is counted
+ * but dropped, unless host_console or host_capture is set.
+ */
+
+#include "hw.h"
+
+#include "kernel/memory.h"
+#include "kernel/mmu.h"
+#include "kernel/interrupt.h"
+#include "kernel/drivers/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+int host_console = 0;
+unsigned long host_console_chars = 0;
+
+char *host_capture = 0;
+unsigned int host_capture_size = 0;
+unsigned int host_capture_len = 0;
+
+unsigned int irq_kernel_pc = 0;
+
+// ## Timer
+
+void
+timer_start (unsigned int period)
+{ }
+
+void
+timer_stop (void)
+{ }
+
+void
+timer_ack (void)
+{ }
+
+void
+timer_counter_start (void)
+{ }
+
+unsigned int
+timer_counter_read (void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  unsigned long long us = now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+  return us * TIMER_COUNTER_MHZ;
+}
+
+// ## Interrupts
+
+void
+init_interrupt_handling (void)
+{ }
+
+void
+interrupt_register (unsigned int irq, interrupt_handler_t handler)
+{ }
+
+void
+interrupt_dispatch (void)
+{ }
+
+void
+interrupt_resched (void)
+{ }
+
+// ## Memory management
+
+// the kernel uses the addresses of pages directly, see kernel/net/pbuf.c
+static void
+__attribute((constructor))
+host_map_page_pool (void)
+{
+  void *pool = mmap((void*) PAGE_POOL_BASE, PAGE_POOL_SIZE,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+                    | MAP_FIXED_NOREPLACE, -1, 0);
+  if (pool != (void*) PAGE_POOL_BASE)
+    {
+      fprintf(stderr, "host: can't map the page pool at 0x%x\n",
+              PAGE_POOL_BASE);
+      abort();
+    }
+}
+
+void
+mmu_init (void)
+{ }
+
+unsigned int
+mmu_init_task (unsigned int slot)
+{
+  return MMU_DACR_KERNEL;
+}
+
+void
+mmu_release_task (unsigned int slot)
+{ }
+
+void
+mmu_fork_task (unsigned int parent, unsigned int child)
+{ }
+
+int
+mmu_user_range (unsigned int addr, unsigned int size)
+{
+  return 1;
+}
+
+// ## Subsystems outside of the host build
+
+void
+net_tick (void)
+{ }
+
+void
+socket_release_task (void)
+{ }
+
+void
+profile_sample (void)
+{ }
+
+// ## Entry points into assembly and user mode
+
+void
+start_first_task (void)
+{ }
+
+void
+idle_loop (void)
+{
+  fprintf(stderr, "host: the idle task can't run on the host\n");
+  abort();
+}
+
+int
+syscall (unsigned int number, unsigned int arg0, unsigned int arg1,
+         unsigned int arg2, unsigned int arg3)
+{
+  fprintf(stderr, "host: syscall %u can't be made on the host\n", number);
+  abort();
+}
+
+// ## Console of the kernel's libc
+
+int
+ns_putchar (int c)
+{
+  host_console_chars++;
+  if (host_capture)
+    {
+      if (host_capture_len + 1 < host_capture_size)
+        {
+          host_capture[host_capture_len] = c;
+          host_capture[host_capture_len + 1] = 0;
+        }
+      host_capture_len++;
+    }
+  else if (host_console)
+    {
+      if (fputc(c, stdout) == EOF)
+        return -1;
+    }
+  return c;
+}
@@ -0,0 +1,57 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdarg.h>
+
+/* the libc of the kernel, built with a prefix to keep it apart from the libc
+ * of the host, see LIBC_SYMBOLS in host/Makefile
+ */
+int ns_printf (const char *format, ...);
+int ns_vprintf (const char *format, va_list ap);
+int ns_puts (const char *s);
+int ns_putchar (int c);
+void *ns_memcpy (void *dest, const void *src, unsigned int n);
+void *ns_memset (void *s, int c, unsigned int n);
+int ns_memcmp (const void *s1, const void *s2, unsigned int n);
+
+/* print the kernel's console output to stdout instead of dropping it */
+extern int host_console;
+
+/* the number of characters the kernel's libc wrote to the console */
+extern unsigned long host_console_chars;
+
+/* if set, the console output is collected here instead, as a string of at
+ * most host_capture_size - 1 characters. host_capture_len counts all
+ * characters, including those that did not fit.
+ */
+extern char *host_capture;
+extern unsigned int host_capture_size;
+extern unsigned int host_capture_len;
+
+struct pbuf;
+
+/* returns:
+ *   the oldest packet passed to ip_output by the kernel, the payload starts
+ *   at the transport header and the caller takes over the reference. 0 if
+ *   no packet is left.
+ */
+struct pbuf* host_ip_take (void);
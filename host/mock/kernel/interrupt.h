@@ -0,0 +1,54 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+/* host stand-in for kernel/interrupt.h, which is shadowed by the include
+ * path of the host build. there are no interrupts on the host, the
+ * functions of the real header are mocked in host/mock/hw.c.
+ */
+
+typedef void (*interrupt_handler_t) (void);
+
+void init_interrupt_handling(void);
+
+void interrupt_register (unsigned int irq, interrupt_handler_t handler);
+
+void interrupt_dispatch (void);
+
+extern unsigned int irq_kernel_pc;
+
+void interrupt_resched (void);
+
+static inline int
+in_syscall (void)
+{
+  return 0;
+}
+
+static inline unsigned int
+irq_save (void)
+{
+  return 0;
+}
+
+static inline void
+irq_restore (unsigned int cpsr)
+{ }
@@ -0,0 +1,101 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+/* mock of the network layer below kernel/net/tcp.c in the host build
+ *
+ * the checksum routines stand in for checksum_arm.S. every destination is
+ * routed through eth_netif, and the packets passed to ip_output are queued
+ * for the tests instead of being sent, see host_ip_take.
+ */
+
+#include "hw.h"
+
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+struct netif eth_netif = { .name = "eth0", .mtu = 1500 };
+
+static struct pbuf *sent_head;
+static struct pbuf *sent_tail;
+
+// ## Checksums
+
+unsigned int
+chksum_add (unsigned int sum, const void *data, unsigned int length)
+{
+  const unsigned char *in = data;
+  unsigned long long acc = sum;
+
+  // the words are summed as they are laid out in memory, little endian
+  for (; length > 1; length -= 2, in += 2)
+    acc += in[0] | (in[1] << 8);
+  if (length)
+    acc += in[0];
+
+  while (acc >> 16)
+    acc = (acc & 0xFFFF) + (acc >> 16);
+  return acc;
+}
+
+unsigned int
+chksum_copy (void *dst, const void *src, unsigned int length,
+             unsigned int sum)
+{
+  ns_memcpy(dst, src, length);
+  return chksum_add(sum, dst, length);
+}
+
+// ## Routing and output
+
+struct netif*
+route_lookup (unsigned int dst, unsigned int *nexthop)
+{
+  *nexthop = dst;
+  return &eth_netif;
+}
+
+int
+ip_output (struct pbuf *p, unsigned int src, unsigned int dst,
+           unsigned char proto)
+{
+  p->link = 0;
+  if (sent_tail)
+    sent_tail->link = p;
+  else
+    sent_head = p;
+  sent_tail = p;
+  return 0;
+}
+
+struct pbuf*
+host_ip_take (void)
+{
+  struct pbuf *p = sent_head;
+  if (p)
+    {
+      sent_head = p->link;
+      if (!sent_head)
+        sent_tail = 0;
+      p->link = 0;
+    }
+  return p;
+}
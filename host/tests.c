@@ -0,0 +1,637 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+/* unit tests of the kernel's libc and scheduler core on the host
+ *
+ * usage: tests [-l] [filter]
+ *
+ * runs every test whose name contains filter, each in a forked process so
+ * it starts from the state the kernel has at boot. prints one line per test
+ * and exits with a nonzero status if any test failed.
+ */
+
+#include "mock/hw.h"
+
+#include "kernel/memory.h"
+#include "kernel/page_alloc.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+#include "kernel/timeout.h"
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+#include "kernel/net/tcp.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+// unistd.h clashes with the syscall wrappers of kernel/syscall.h
+pid_t fork (void);
+
+static int failed;
+
+#define CHECK(COND)                                                      \
+  do                                                                     \
+    {                                                                    \
+      if (!(COND))                                                       \
+        {                                                                \
+          fprintf(stderr, "%s:%d: check failed: %s\n",                   \
+                  __FILE__, __LINE__, #COND);                            \
+          failed = 1;                                                    \
+        }                                                                \
+    }                                                                    \
+  while (0)
+
+// ## libc
+
+static void
+test_memcpy (void)
+{
+  unsigned char src[256], dst[256 + 8], ref[256 + 8];
+  unsigned int i, offset, len;
+  for (i = 0; i < sizeof(src); ++i)
+    src[i] = i * 7 + 1;
+
+  // every alignment of source and destination, sizes around the word and
+  // block sizes of the copy loops
+  for (offset = 0; offset < 8; ++offset)
+    for (len = 0; len <= 200; ++len)
+      {
+        memset(dst, 0xA5, sizeof(dst));
+        memset(ref, 0xA5, sizeof(ref));
+        void *res = ns_memcpy(dst + offset, src + (len % 4), len);
+        memcpy(ref + offset, src + (len % 4), len);
+        CHECK(res == dst + offset);
+        CHECK(memcmp(dst, ref, sizeof(dst)) == 0);
+      }
+}
+
+static void
+test_memset_memcmp (void)
+{
+  unsigned char a[100], b[100];
+  CHECK(ns_memset(a, 0x5A, sizeof(a)) == a);
+  memset(b, 0x5A, sizeof(b));
+  CHECK(memcmp(a, b, sizeof(a)) == 0);
+
+  CHECK(ns_memcmp(a, b, sizeof(a)) == 0);
+  b[50] = 0x5B;
+  CHECK(ns_memcmp(a, b, sizeof(a)) < 0);
+  CHECK(ns_memcmp(b, a, sizeof(a)) > 0);
+  CHECK(ns_memcmp(a, b, 50) == 0);
+}
+
+// compare the output of the kernel's vprintf to the one of the host
+static void
+check_printf (const char *format, ...)
+{
+  char out[256], ref[256];
+  va_list ap;
+
+  host_capture = out;
+  host_capture_size = sizeof(out);
+  host_capture_len = 0;
+  out[0] = 0;
+  va_start(ap, format);
+  int res = ns_vprintf(format, ap);
+  va_end(ap);
+  host_capture = 0;
+
+  va_start(ap, format);
+  int expected = vsnprintf(ref, sizeof(ref), format, ap);
+  va_end(ap);
+
+  if (strcmp(out, ref) || res != expected || host_capture_len != expected)
+    {
+      fprintf(stderr, "vprintf(\"%s\"): \"%s\" (%d), expected \"%s\" (%d)\n",
+              format, out, res, ref, expected);
+      failed = 1;
+    }
+}
+
+static void
+test_vprintf (void)
+{
+  check_printf("plain text");
+  check_printf("100%%");
+  check_printf("%c%c%c", 'a', 'b', 'c');
+  check_printf("[%s] [%s]", "shuriken", "");
+  check_printf("%i %i %i %i", 0, 7, -42, 2147483647);
+  check_printf("%u %u %u", 0u, 10u, 4294967295u);
+  check_printf("%x %x %x", 0u, 0xbeefu, 0xffffffffu);
+  check_printf("%X %X", 0, 0x7ABCDEF0);
+  check_printf("  task %i: %s 0x%x %u%%\n", 3, "a", 0x1f, 99u);
+}
+
+// ## Run queue
+//
+// the tasks never run, the tests drive the scheduler the way the interrupt
+// and syscall paths do
+
+static void
+task_entry (void)
+{ }
+
+static void
+start_tasks (unsigned int n)
+{
+  while (n--)
+    add_task(&task_entry);
+  start_scheduler();
+}
+
+static void
+test_run_queue_order (void)
+{
+  start_tasks(4);
+  CHECK(task_count == 4);
+  CHECK(current_task == &tasks[0]);
+  CHECK(tasks[0].state == TASK_RUNNING);
+
+  // round robin in the order the tasks were added
+  unsigned int i;
+  for (i = 1; i <= 8; ++i)
+    {
+      schedule();
+      CHECK(current_task == &tasks[i % 4]);
+      CHECK(tasks[(i - 1) % 4].state == TASK_READY);
+    }
+}
+
+static void
+test_run_queue_exit (void)
+{
+  start_tasks(3);
+
+  exit_current_task();
+  schedule();
+  CHECK(task_count == 2);
+  CHECK(tasks[0].state == TASK_UNUSED);
+  CHECK(current_task == &tasks[1]);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+  schedule();
+  CHECK(current_task == &tasks[1]);
+
+  // the free slot is reused and the task goes to the end of the queue
+  add_task(&task_entry);
+  CHECK(tasks[0].state == TASK_READY);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+  schedule();
+  CHECK(current_task == &tasks[0]);
+
+  // the idle task runs once no task is left
+  while (task_count)
+    {
+      exit_current_task();
+      schedule();
+    }
+  CHECK(current_task < tasks || current_task >= tasks + MAX_TASK_NUMBER);
+}
+
+static void
+test_run_queue_full (void)
+{
+  start_tasks(MAX_TASK_NUMBER + 1);
+  CHECK(task_count == MAX_TASK_NUMBER);
+
+  unsigned int i;
+  for (i = 1; i <= MAX_TASK_NUMBER; ++i)
+    {
+      schedule();
+      CHECK(current_task == &tasks[i % MAX_TASK_NUMBER]);
+    }
+}
+
+// ## Sleeping and waiting
+
+static void
+test_sleep_wake (void)
+{
+  start_tasks(3);
+
+  // the sleepers wake in the order of their wakeup tick
+  sleep_current_task(3);
+  schedule();
+  CHECK(current_task == &tasks[1]);
+  sleep_current_task(1);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+
+  scheduler_tick();
+  CHECK(tasks[1].state != TASK_SLEEPING);
+  CHECK(tasks[0].state == TASK_SLEEPING);
+  CHECK(current_task == &tasks[1]);
+
+  scheduler_tick();
+  CHECK(tasks[0].state == TASK_SLEEPING);
+  CHECK(current_task == &tasks[2]);
+  scheduler_tick();
+  CHECK(tasks[0].state != TASK_SLEEPING);
+
+  // a woken task is queued behind the ready ones, ahead of the preempted
+  CHECK(current_task == &tasks[1]);
+  schedule();
+  CHECK(current_task == &tasks[0]);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+}
+
+static void
+test_block_wake (void)
+{
+  start_tasks(3);
+  wait_queue_t queue = { 0 };
+
+  block_current_task(&queue, 0);
+  schedule();
+  CHECK(tasks[0].state == TASK_BLOCKED);
+  CHECK(current_task == &tasks[1]);
+  block_current_task(&queue, 0);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+
+  // blocked tasks are skipped by the round robin
+  schedule();
+  CHECK(current_task == &tasks[2]);
+
+  need_resched = 0;
+  wake_up(&queue);
+  CHECK(need_resched);
+  CHECK(queue.head == 0);
+  CHECK(tasks[0].state == TASK_READY && tasks[1].state == TASK_READY);
+  CHECK(tasks[0].waiting == 0 && tasks[1].waiting == 0);
+
+  schedule();
+  CHECK(current_task == &tasks[1] || current_task == &tasks[0]);
+  schedule();
+  CHECK(current_task == &tasks[1] || current_task == &tasks[0]);
+  schedule();
+  CHECK(current_task == &tasks[2]);
+}
+
+static void
+test_block_timeout (void)
+{
+  start_tasks(2);
+  wait_queue_t queue = { 0 };
+
+  block_current_task(&queue, 2);
+  schedule();
+  CHECK(queue.head == &tasks[0]);
+
+  scheduler_tick();
+  CHECK(tasks[0].state == TASK_BLOCKED);
+  scheduler_tick();
+  CHECK(tasks[0].state != TASK_BLOCKED);
+  CHECK(queue.head == 0);
+  CHECK(tasks[0].waiting == 0);
+
+  // a wakeup after the timeout finds nothing to do
+  wake_up(&queue);
+  CHECK(tasks[0].state != TASK_BLOCKED);
+}
+
+// ## Timeouts
+
+static unsigned int fired[4];
+static unsigned int fire_count;
+
+static void
+timeout_record (void *arg)
+{
+  fired[fire_count++] = (unsigned int) (unsigned long) arg;
+}
+
+static void
+test_timeout_expiry (void)
+{
+  struct timeout t[3];
+  unsigned int i;
+  for (i = 0; i < 3; ++i)
+    timeout_set(&t[i], &timeout_record, (void*) (unsigned long) i);
+
+  timeout_add(&t[0], 3);
+  timeout_add(&t[1], 1);
+  timeout_add(&t[2], 2);
+  CHECK(timeout_pending(&t[0]) && timeout_pending(&t[1]));
+
+  // a timeout that is moved runs at its new expiry only
+  timeout_add(&t[2], 3);
+  timeout_del(&t[0]);
+  CHECK(!timeout_pending(&t[0]));
+
+  unsigned int tick;
+  unsigned int count[4] = { 0 };
+  for (tick = 1; tick <= 4; ++tick)
+    {
+      tick_count++;
+      timeout_run();
+      count[tick - 1] = fire_count;
+    }
+
+  CHECK(count[0] == 1 && fired[0] == 1);
+  CHECK(count[1] == 1);
+  CHECK(count[2] == 2 && fired[1] == 2);
+  CHECK(count[3] == 2);
+  for (i = 0; i < 3; ++i)
+    CHECK(!timeout_pending(&t[i]));
+}
+
+static struct timeout rearm_timeout;
+static unsigned int rearm_runs;
+
+static void
+timeout_rearm (void *arg)
+{
+  if (++rearm_runs < 3)
+    timeout_add(&rearm_timeout, 2);
+}
+
+static void
+test_timeout_rearm (void)
+{
+  timeout_set(&rearm_timeout, &timeout_rearm, 0);
+  timeout_add(&rearm_timeout, 1);
+
+  unsigned int tick;
+  for (tick = 0; tick < 10; ++tick)
+    {
+      tick_count++;
+      timeout_run();
+      if (tick == 2)
+        CHECK(rearm_runs == 2);
+    }
+  CHECK(rearm_runs == 3);
+  CHECK(!timeout_pending(&rearm_timeout));
+}
+
+// ## Page allocator
+
+static void
+test_page_refcount (void)
+{
+  unsigned int free_pages = page_free_count();
+  unsigned int page = page_alloc();
+  CHECK(page);
+  CHECK(page % PAGE_SIZE == 0);
+  CHECK(page_refcount(page) == 1);
+  CHECK(page_free_count() == free_pages - 1);
+
+  page_get(page);
+  CHECK(page_refcount(page) == 2);
+  page_put(page);
+  CHECK(page_refcount(page) == 1);
+  CHECK(page_free_count() == free_pages - 1);
+
+  // the last reference frees the page, the next allocation reuses it
+  page_put(page);
+  CHECK(page_free_count() == free_pages);
+  CHECK(page_alloc() == page);
+}
+
+static void
+test_page_exhaustion (void)
+{
+  unsigned int count = page_free_count();
+  unsigned int first = page_alloc(), last = first, i;
+  for (i = 1; i < count; ++i)
+    {
+      unsigned int page = page_alloc();
+      CHECK(page && page != last);
+      last = page;
+    }
+  CHECK(page_free_count() == 0);
+  CHECK(page_alloc() == 0);
+
+  page_put(first);
+  CHECK(page_free_count() == 1);
+  CHECK(page_alloc() == first);
+  CHECK(page_alloc() == 0);
+}
+
+// ## Admission control
+
+static void
+test_periodic_admission (void)
+{
+  start_tasks(3);
+
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 0, 0) == -EINVAL);
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 200000, 0) == -EINVAL);
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 60000, 0) == 0);
+  CHECK(tasks[0].rt.policy == SCHED_EDF);
+
+  // the real-time tasks leave the round robin
+  schedule();
+  CHECK(current_task == &tasks[0]);
+  sys_task_wait_period();
+  schedule();
+  CHECK(current_task == &tasks[1]);
+
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 50000, 0) == -EBUSY);
+  CHECK(sys_task_periodic(SCHED_RM, 100000, 10000, 0) == -EBUSY);
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 30000, 0) == 0);
+
+  // leaving the class frees the share
+  CHECK(sys_task_periodic(SCHED_NORMAL, 0, 0, 0) == 0);
+  CHECK(tasks[1].rt.policy == SCHED_NORMAL);
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 35000, 0) == 0);
+}
+
+static void
+test_reserve_admission (void)
+{
+  start_tasks(2);
+
+  CHECK(sys_task_reserve(RESERVATION_GROUPS + 1, 1000, 10000) == -EINVAL);
+  CHECK(sys_task_reserve(1, 0, 0) == -EINVAL);
+  CHECK(sys_task_reserve(1, 20000, 10000) == -EINVAL);
+  CHECK(sys_task_reserve(1, 60000, 100000) == 0);
+  CHECK(sys_task_reserve(2, 50000, 100000) == -EBUSY);
+
+  // moving to another group frees the share of the last member
+  CHECK(sys_task_reserve(2, 30000, 100000) == 0);
+  CHECK(sys_task_reserve(1, 60000, 100000) == 0);
+
+  schedule();
+  CHECK(sys_task_reserve(1, 0, 0) == 0);
+  CHECK(tasks[1].reservation == tasks[0].reservation);
+  CHECK(sys_task_periodic(SCHED_EDF, 100000, 10000, 0) == -EBUSY);
+}
+
+// ## TCP
+
+#define PEER_IP   IP4(10, 0, 2, 2)
+#define PEER_PORT htons(7)
+
+// hand a segment without payload from the peer to tcp_input
+static void
+tcp_peer_send (struct tcp_pcb *pcb, unsigned int seq, unsigned int ack,
+               unsigned char flags)
+{
+  struct pbuf *p = pbuf_alloc(0, TCP_HLEN);
+  CHECK(p);
+  struct tcp_hdr *tcp = (struct tcp_hdr*) p->payload;
+  memset(tcp, 0, TCP_HLEN);
+  tcp->src = PEER_PORT;
+  tcp->dst = pcb->local_port;
+  tcp->seq = htonl(seq);
+  tcp->ack = htonl(ack);
+  tcp->off = (TCP_HLEN / 4) << 4;
+  tcp->flags = flags;
+  tcp->wnd = htons(TCP_WND);
+  tcp->chksum = chksum_fold(chksum_add(chksum_pseudo(PEER_IP, eth_netif.ip,
+                            IP_PROTO_TCP, TCP_HLEN), tcp, TCP_HLEN));
+
+  struct ip_hdr iph = { .src = PEER_IP, .dst = eth_netif.ip };
+  tcp_input(&eth_netif, p, &iph);
+}
+
+// take the segment the pcb sent last, 0 if it sent none
+static int
+tcp_peer_recv (struct tcp_hdr *out)
+{
+  struct pbuf *p, *last = 0;
+  while ((p = host_ip_take()))
+    {
+      if (last)
+        pbuf_free(last);
+      last = p;
+    }
+  if (!last)
+    return 0;
+
+  memcpy(out, last->payload, TCP_HLEN);
+  pbuf_free(last);
+  return 1;
+}
+
+static void
+test_tcp_lost_final_ack (void)
+{
+  eth_netif.ip = IP4(10, 0, 2, 15);
+  struct tcp_pcb *pcb = tcp_new();
+  struct tcp_hdr seg;
+  unsigned int peer_iss = 1000;
+
+  CHECK(tcp_connect(pcb, PEER_IP, PEER_PORT) == 0);
+  CHECK(tcp_peer_recv(&seg) && seg.flags == TCP_SYN);
+  unsigned int iss = ntohl(seg.seq);
+
+  tcp_peer_send(pcb, peer_iss, iss + 1, TCP_SYN | TCP_ACK);
+  CHECK(pcb->state == TCP_ESTABLISHED);
+  tcp_peer_recv(&seg);
+
+  tcp_close(pcb);
+  CHECK(pcb->state == TCP_FIN_WAIT_1);
+  CHECK(tcp_peer_recv(&seg) && (seg.flags & TCP_FIN));
+
+  tcp_peer_send(pcb, peer_iss + 1, iss + 2, TCP_FIN | TCP_ACK);
+  CHECK(pcb->state == TCP_TIME_WAIT);
+  CHECK(tcp_peer_recv(&seg) && ntohl(seg.ack) == peer_iss + 2);
+
+  // the final ack is lost, the peer sends its fin again
+  tick_count += 10;
+  tcp_peer_send(pcb, peer_iss + 1, iss + 2, TCP_FIN | TCP_ACK);
+  CHECK(pcb->state == TCP_TIME_WAIT);
+  CHECK(tcp_peer_recv(&seg));
+  CHECK(seg.flags == TCP_ACK && ntohl(seg.ack) == peer_iss + 2);
+  CHECK(pcb->linger_timer.expires
+        == tick_count + MS_TO_TICKS(2 * TCP_MSL_MS));
+}
+
+struct test
+{
+  const char *name;
+  void (*fn) (void);
+};
+
+static const struct test tests[] =
+{
+  { "memcpy", &test_memcpy },
+  { "memset_memcmp", &test_memset_memcmp },
+  { "vprintf", &test_vprintf },
+  { "run_queue_order", &test_run_queue_order },
+  { "run_queue_exit", &test_run_queue_exit },
+  { "run_queue_full", &test_run_queue_full },
+  { "sleep_wake", &test_sleep_wake },
+  { "block_wake", &test_block_wake },
+  { "block_timeout", &test_block_timeout },
+  { "timeout_expiry", &test_timeout_expiry },
+  { "timeout_rearm", &test_timeout_rearm },
+  { "page_refcount", &test_page_refcount },
+  { "page_exhaustion", &test_page_exhaustion },
+  { "periodic_admission", &test_periodic_admission },
+  { "reserve_admission", &test_reserve_admission },
+  { "tcp_lost_final_ack", &test_tcp_lost_final_ack },
+};
+#define TESTS (sizeof(tests) / sizeof(tests[0]))
+
+// the kernel state is global, so every test runs in a process of its own
+static int
+run (const struct test *test)
+{
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+    {
+      test->fn();
+      exit(failed);
+    }
+
+  int status;
+  int ok = pid > 0 && waitpid(pid, &status, 0) == pid
+        && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  printf("test: %s %s\n", test->name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *filter = "";
+  int list = 0;
+  int i;
+  for (i = 1; i < argc; ++i)
+    if (!strcmp(argv[i], "-l"))
+      list = 1;
+    else
+      filter = argv[i];
+
+  unsigned int t, failures = 0;
+  for (t = 0; t < TESTS; ++t)
+    {
+      if (list)
+        puts(tests[t].name);
+      else if (strstr(tests[t].name, filter) && !run(&tests[t]))
+        failures++;
+    }
+
+  if (failures)
+    printf("test: %u failed\n", failures);
+  return failures != 0;
+}
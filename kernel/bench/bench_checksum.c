@@ -0,0 +1,144 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "bench_checksum.h"
+
+#include "kernel/memory.h"
+#include "kernel/drivers/timer.h"
+#include "kernel/net/checksum.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ITERATIONS 100
+#define ROUNDS     16
+#define LENGTH     1500
+
+// the straightforward C version the assembly routines replace
+static unsigned int
+__attribute__((noinline))
+chksum_add_c (unsigned int sum, const void *data, unsigned int length)
+{
+  const unsigned char *bytes = data;
+
+  if (!((unsigned int)bytes & 1))
+    {
+      const unsigned short *words = (const unsigned short*)bytes;
+      for (; length > 1; length -= 2)
+        sum += *words++;
+      bytes = (const unsigned char*)words;
+    }
+  else
+    for (; length > 1; length -= 2, bytes += 2)
+      sum += bytes[0] | (bytes[1] << 8);
+
+  if (length)
+    sum += bytes[0];
+
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return (sum & 0xFFFF) + (sum >> 16);
+}
+
+enum variant
+{
+  SUM_C,
+  SUM_ASM,
+  COPY,
+  COPY_C,
+  COPY_ASM
+};
+
+static unsigned int
+run (enum variant variant, unsigned char *dst, const unsigned char *src,
+     unsigned int length)
+{
+  switch (variant)
+    {
+    case SUM_C:
+      return chksum_add_c(0, src, length);
+    case SUM_ASM:
+      return chksum_add(0, src, length);
+    case COPY:
+      memcpy(dst, src, length);
+      return 0;
+    case COPY_C:
+      memcpy(dst, src, length);
+      return chksum_add_c(0, dst, length);
+    case COPY_ASM:
+      return chksum_copy(dst, src, length, 0);
+    }
+
+  return 0;
+}
+
+static void
+measure (const char *name, enum variant variant, unsigned char *dst,
+         const unsigned char *src, unsigned int length)
+{
+  unsigned int round, i;
+  unsigned int min = 0xFFFFFFFF;
+  unsigned int total = 0;
+
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      unsigned int start = timer_counter_read();
+      for (i = 0; i < ITERATIONS; ++i)
+        run(variant, dst, src, length);
+      unsigned int elapsed = timer_counter_read() - start;
+
+      total += elapsed;
+      if (elapsed < min)
+        min = elapsed;
+    }
+
+  printf("bench: %s bytes=%u iterations=%u min_ns=%u avg_ns=%u\n", name,
+         length, ITERATIONS,
+         min * 1000 / TIMER_COUNTER_MHZ / ITERATIONS,
+         total / ROUNDS * 1000 / TIMER_COUNTER_MHZ / ITERATIONS);
+}
+
+void
+bench_checksum (void)
+{
+  // task memory is only writable on the stack
+  unsigned int src_words[LENGTH / 4 + 1];
+  unsigned int dst_words[LENGTH / 4 + 1];
+  unsigned char *src = (unsigned char*)src_words;
+  unsigned char *dst = (unsigned char*)dst_words;
+
+  unsigned int i;
+  for (i = 0; i < LENGTH; ++i)
+    src[i] = i * 7 + 3;
+
+  // the routines must agree on every alignment before their speed matters
+  for (i = 0; i < 4; ++i)
+    {
+      unsigned int expect = chksum_add_c(0, src + i, LENGTH - 4);
+      if (chksum_add(0, src + i, LENGTH - 4) != expect
+          || chksum_copy(dst + i, src + i, LENGTH - 4, 0) != expect)
+        printf("bench: chksum mismatch at offset %u\n", i);
+    }
+
+  measure("chksum_c", SUM_C, dst, src, LENGTH);
+  measure("chksum_asm", SUM_ASM, dst, src, LENGTH);
+  measure("memcpy", COPY, dst, src, LENGTH);
+  measure("chksum_copy_c", COPY_C, dst, src, LENGTH);
+  measure("chksum_copy_asm", COPY_ASM, dst, src, LENGTH);
+}
@@ -0,0 +1,267 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "bench_latency.h"
+
+#include "kernel/memory.h"
+#include "kernel/interrupt.h"
+#include "kernel/mmu.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+#include "kernel/bench/bench_syscall.h"
+#include "kernel/net/net.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+// the scheduler timer, see kernel/board.h
+#define ELAPSED(V)     BOARD_TIMER_ELAPSED(V)
+#define TICKS_TO_NS(T) BOARD_TIMER_TICKS_TO_NS(T)
+
+// length of a scenario
+#define SCENARIO_MS 4000
+
+#define PORT_LOAD 7100
+
+// the timer value at the entry of irq_handler, written for interrupts of
+// tasks only
+unsigned int latency_entry __fastdata = 0;
+
+// the measurement of the last timer interrupt, the layout is known to
+// load_current_task_state, which fills in exit and clears armed
+struct latency_capture
+{
+  unsigned int armed;
+  unsigned int entry;
+  unsigned int exit;
+  unsigned int valid;
+};
+
+struct latency_capture latency_capture __fastdata = { 0 };
+
+unsigned int latency_hist[LATENCY_POINTS][LATENCY_BUCKETS] = { { 0 } };
+
+static inline void
+record (unsigned int point, unsigned int value)
+{
+  unsigned int ticks = ELAPSED(value);
+  if (ticks >= LATENCY_BUCKETS)
+    ticks = LATENCY_BUCKETS - 1;
+  latency_hist[point][ticks]++;
+}
+
+void
+__fasttext
+latency_tick (void)
+{
+  // an interrupt of a bottom half doesn't end in load_current_task_state
+  if (irq_kernel_pc)
+    return;
+
+  struct latency_capture *capture = &latency_capture;
+  if (capture->valid && !capture->armed)
+    {
+      record(LATENCY_ENTRY, capture->entry);
+      record(LATENCY_RESUME, capture->exit);
+    }
+
+  capture->entry = latency_entry;
+  capture->armed = 1;
+  capture->valid = 1;
+}
+
+int
+sys_latency_read (unsigned int point, unsigned int *hist)
+{
+  if (point >= LATENCY_POINTS)
+    return -EINVAL;
+  if (!mmu_user_range((unsigned int) hist, sizeof(latency_hist[point])))
+    return -EFAULT;
+
+  memcpy(hist, latency_hist[point], sizeof(latency_hist[point]));
+  return 0;
+}
+
+// ## Load generators
+//
+// the generators run as forked tasks until the scenario ends. like the rest
+// of the benchmark they run in user mode, so they read the tick count and
+// the histograms of the kernel through syscalls.
+
+static void
+load_cpu (unsigned int end)
+{
+  while ((int)(uptime() - end) < 0);
+}
+
+// syscalls run with interrupts disabled, and delay the timer interrupt
+static void
+load_syscall (unsigned int end)
+{
+  while ((int)(uptime() - end) < 0)
+    syscall_null();
+}
+
+// udp packets over the loopback interface keep the receive bottom half busy
+static void
+load_net (unsigned int end)
+{
+  unsigned char buf[512];
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd < 0)
+    return;
+
+  struct sockaddr_in addr = { AF_INET, htons(PORT_LOAD), IP4(127, 0, 0, 1) };
+  if (bind(fd, &addr) < 0)
+    return;
+
+  while ((int)(uptime() - end) < 0)
+    {
+      sendto(fd, buf, sizeof(buf), &addr);
+      while (recvfrom(fd, buf, sizeof(buf), 0) > 0);
+    }
+  close(fd);
+}
+
+struct scenario
+{
+  const char *name;
+  void (*load) (unsigned int end);
+  unsigned int tasks;
+};
+
+static const struct scenario scenarios[] =
+{
+  { "idle", 0, 0 },
+  { "cpu", &load_cpu, 2 },
+  { "syscall", &load_syscall, 2 },
+  { "net", &load_net, 1 },
+};
+#define SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// the latency below which the given share of the samples lies, in permille
+static unsigned int
+percentile (const unsigned int *hist, unsigned int samples, unsigned int permille)
+{
+  unsigned long long target = (unsigned long long) samples * permille / 1000;
+  unsigned int seen = 0;
+  unsigned int i;
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+      seen += hist[i];
+      if (seen > target)
+        return i;
+    }
+  return LATENCY_BUCKETS - 1;
+}
+
+static void
+report (const char *scenario, const char *point, const unsigned int *hist)
+{
+  unsigned int samples = 0, min = LATENCY_BUCKETS, max = 0;
+  unsigned long long sum = 0;
+  unsigned int i;
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    if (hist[i])
+      {
+        samples += hist[i];
+        sum += (unsigned long long) hist[i] * i;
+        if (i < min)
+          min = i;
+        max = i;
+      }
+
+  if (!samples)
+    {
+      printf("bench: irq_latency scenario=%s point=%s samples=0\n",
+             scenario, point);
+      return;
+    }
+
+  // the last bucket collects everything above, so its max is a lower bound
+  printf("bench: irq_latency scenario=%s point=%s samples=%u min_ns=%u"
+         " avg_ns=%u p50_ns=%u p90_ns=%u p99_ns=%u p999_ns=%u max_ns=%s%u\n",
+         scenario, point, samples, TICKS_TO_NS(min),
+         (unsigned int) TICKS_TO_NS(sum / samples),
+         TICKS_TO_NS(percentile(hist, samples, 500)),
+         TICKS_TO_NS(percentile(hist, samples, 900)),
+         TICKS_TO_NS(percentile(hist, samples, 990)),
+         TICKS_TO_NS(percentile(hist, samples, 999)),
+         max == LATENCY_BUCKETS - 1 ? ">" : "", TICKS_TO_NS(max));
+
+  printf("bench: irq_latency_hist scenario=%s point=%s", scenario, point);
+  for (i = 0; i < LATENCY_BUCKETS; ++i)
+    if (hist[i])
+      printf(" %u:%u", TICKS_TO_NS(i), hist[i]);
+  printf("\n");
+}
+
+static void
+run (const struct scenario *scenario)
+{
+  // the histograms are kernel data, so the task takes the difference of
+  // two snapshots on its stack
+  unsigned int before[LATENCY_POINTS][LATENCY_BUCKETS];
+  unsigned int after[LATENCY_BUCKETS];
+  unsigned int point, i;
+
+  unsigned int end = uptime() + MS_TO_TICKS(SCENARIO_MS);
+  for (i = 0; i < scenario->tasks; ++i)
+    if (task_fork() == 0)
+      {
+        scenario->load(end);
+        task_exit();
+      }
+
+  for (point = 0; point < LATENCY_POINTS; ++point)
+    latency_read(point, before[point]);
+
+  unsigned int now;
+  while ((int)((now = uptime()) - end) < 0)
+    task_sleep(end - now);
+
+  for (point = 0; point < LATENCY_POINTS; ++point)
+    {
+      latency_read(point, after);
+      for (i = 0; i < LATENCY_BUCKETS; ++i)
+        before[point][i] = after[i] - before[point][i];
+    }
+
+  report(scenario->name, "entry", before[LATENCY_ENTRY]);
+  report(scenario->name, "resume", before[LATENCY_RESUME]);
+
+  // let the generators run out
+  while (bench_tasks() > 1)
+    task_sleep(1);
+}
+
+void
+bench_latency (void)
+{
+  while (bench_tasks() > 1)
+    task_sleep(MS_TO_TICKS(100));
+
+  bench_task_switch();
+
+  unsigned int i;
+  for (i = 0; i < SCENARIOS; ++i)
+    run(&scenarios[i]);
+}
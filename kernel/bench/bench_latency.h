@@ -0,0 +1,72 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the interrupt latency harness measures the time from the assertion of the
+ * timer interrupt to the first instruction of irq_handler (entry) and to
+ * load_current_task_state, right before the next task runs (resume).
+ *
+ * the scheduler timer restarts its period when it asserts the interrupt, so
+ * its current value is the time since the assertion. irq_handler and
+ * load_current_task_state read it in benchmark builds, and latency_tick
+ * sorts the values of the previous tick into histograms with one bucket per
+ * timer tick.
+ */
+
+// buckets per histogram, the last one collects everything above
+#define LATENCY_BUCKETS 512
+
+enum latency_point
+{
+  LATENCY_ENTRY = 0,
+  LATENCY_RESUME,
+  LATENCY_POINTS
+};
+
+// timer ticks since the assertion, indexed by latency point and bucket.
+// the counts only ever grow, measurements take the difference of two
+// snapshots. tasks read them with latency_read.
+extern unsigned int latency_hist[LATENCY_POINTS][LATENCY_BUCKETS];
+
+/* called from the timer interrupt, only timer interrupts of tasks are
+ * measured
+ */
+void latency_tick (void);
+
+/* copy a histogram to the current task, see latency_read in
+ * kernel/syscall.h
+ *
+ * returns:
+ *   0 on success, -EINVAL for an unknown point or -EFAULT if hist is not
+ *   writable by the task
+ */
+int sys_latency_read (unsigned int point, unsigned int *hist);
+
+/* measure the latencies under several load scenarios and print the results
+ * to the console. waits for the other benchmarks to finish first, so they
+ * don't disturb the idle scenario, and runs bench_task_switch, which needs
+ * the cpu to itself. meant to be run as a task.
+ */
+void bench_latency (void);
@@ -0,0 +1,272 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "bench_net.h"
+
+#include "kernel/memory.h"
+#include "kernel/softirq.h"
+#include "kernel/syscall.h"
+#include "kernel/drivers/timer.h"
+#include "kernel/net/net.h"
+
+#include <stdio.h>
+
+#define UDP_PACKETS 2000
+#define UDP_BURST   16           // below the queue limit of a udp socket
+#define TCP_BYTES   (256 * 1024)
+#define RR_ROUNDS   200
+
+#define PORT_UDP_RX 7001
+#define PORT_UDP_TX 7002
+#define PORT_TCP    7003
+
+static const unsigned int sizes[] = { 64, 512, 1024, 1460 };
+#define SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+// all sockets are non blocking, so one task can play both sides. task
+// memory is only writable on the stack, so the buffers live there.
+struct buffers
+{
+  unsigned char tx[1500];
+  unsigned char rx[4096];
+};
+
+static unsigned int
+elapsed_us (unsigned int start)
+{
+  return (timer_counter_read() - start) / TIMER_COUNTER_MHZ;
+}
+
+static struct sockaddr_in
+loopback_addr (unsigned short port)
+{
+  struct sockaddr_in addr = { AF_INET, htons(port), IP4(127, 0, 0, 1) };
+  return addr;
+}
+
+// receive exactly len bytes from a stream, waiting for the timers if the
+// data is not there yet
+static int
+recv_all (int fd, unsigned char *buf, unsigned int size, unsigned int len)
+{
+  unsigned int got = 0;
+  while (got < len)
+    {
+      unsigned int n = len - got;
+      if (n > size)
+        n = size;
+
+      int res = recv(fd, buf, n);
+      if (res > 0)
+        got += res;
+      else if (res != -EAGAIN)
+        return res ? res : -ECONNRESET;
+    }
+
+  return got;
+}
+
+static void
+bench_udp (struct buffers *b)
+{
+  int rx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  int tx = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_in rx_addr = loopback_addr(PORT_UDP_RX);
+  struct sockaddr_in tx_addr = loopback_addr(PORT_UDP_TX);
+  if (rx < 0 || tx < 0 || bind(rx, &rx_addr) < 0 || bind(tx, &tx_addr) < 0)
+    {
+      printf("bench: udp setup failed\n");
+      return;
+    }
+
+  unsigned int i;
+  for (i = 0; i < SIZES; ++i)
+    {
+      unsigned int size = sizes[i];
+      unsigned int sent = 0, received = 0;
+      unsigned int start = timer_counter_read();
+
+      while (sent < UDP_PACKETS)
+        {
+          unsigned int burst;
+          for (burst = 0; burst < UDP_BURST && sent < UDP_PACKETS; ++burst)
+            if (sendto(tx, b->tx, size, &rx_addr) == (int) size)
+              ++sent;
+
+          while (recvfrom(rx, b->rx, sizeof(b->rx), 0) > 0)
+            ++received;
+        }
+      while (recvfrom(rx, b->rx, sizeof(b->rx), 0) > 0)
+        ++received;
+
+      unsigned int ms = elapsed_us(start) / 1000 + 1;
+      printf("bench: udp_stream bytes=%u packets=%u received=%u elapsed_ms=%u pps=%u kbps=%u\n",
+             size, sent, received, ms, received * 1000 / ms,
+             received * size * 8 / ms);
+    }
+
+  for (i = 0; i < SIZES; ++i)
+    {
+      unsigned int size = sizes[i];
+      unsigned int min = 0xFFFFFFFF, total = 0;
+      unsigned int round;
+
+      for (round = 0; round < RR_ROUNDS; ++round)
+        {
+          unsigned int start = timer_counter_read();
+          sendto(tx, b->tx, size, &rx_addr);
+          while (recvfrom(rx, b->rx, sizeof(b->rx), 0) < 0);
+          sendto(rx, b->rx, size, &tx_addr);
+          while (recvfrom(tx, b->rx, sizeof(b->rx), 0) < 0);
+
+          unsigned int us = elapsed_us(start);
+          total += us;
+          if (us < min)
+            min = us;
+        }
+
+      printf("bench: udp_rr bytes=%u iterations=%u min_us=%u avg_us=%u\n",
+             size, RR_ROUNDS, min, total / RR_ROUNDS);
+    }
+
+  close(rx);
+  close(tx);
+}
+
+static void
+bench_tcp (struct buffers *b)
+{
+  int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int client = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  struct sockaddr_in addr = loopback_addr(PORT_TCP);
+  if (listener < 0 || client < 0 || bind(listener, &addr) < 0
+      || listen(listener, 1) < 0)
+    {
+      printf("bench: tcp setup failed\n");
+      return;
+    }
+
+  // the handshake completes while the timers run
+  int res, server;
+  while ((res = connect(client, &addr)) == -EAGAIN);
+  while ((server = accept(listener, 0)) == -EAGAIN);
+  if (res < 0 || server < 0)
+    {
+      printf("bench: tcp connect failed\n");
+      return;
+    }
+
+  unsigned int i;
+  for (i = 0; i < SIZES; ++i)
+    {
+      unsigned int size = sizes[i];
+      unsigned int sent = 0, received = 0;
+      unsigned int start = timer_counter_read();
+
+      while (received < TCP_BYTES)
+        {
+          while (sent < TCP_BYTES)
+            {
+              unsigned int n = TCP_BYTES - sent;
+              res = send(client, b->tx, n < size ? n : size);
+              if (res <= 0)
+                break;
+              sent += res;
+            }
+          if (res < 0 && res != -EAGAIN)
+            {
+              printf("bench: tcp stream failed with %i\n", res);
+              return;
+            }
+
+          while ((res = recv(server, b->rx, sizeof(b->rx))) > 0)
+            received += res;
+          if (res != -EAGAIN)
+            {
+              printf("bench: tcp stream failed with %i\n", res);
+              return;
+            }
+        }
+
+      unsigned int ms = elapsed_us(start) / 1000 + 1;
+      printf("bench: tcp_stream bytes=%u total=%u elapsed_ms=%u kbps=%u\n",
+             size, received, ms, received / ms * 8);
+    }
+
+  // latency without coalescing
+  setsockopt(client, IPPROTO_TCP, TCP_NODELAY, 1);
+  setsockopt(server, IPPROTO_TCP, TCP_NODELAY, 1);
+
+  for (i = 0; i < SIZES; ++i)
+    {
+      unsigned int size = sizes[i];
+      unsigned int min = 0xFFFFFFFF, total = 0;
+      unsigned int round;
+
+      for (round = 0; round < RR_ROUNDS; ++round)
+        {
+          unsigned int start = timer_counter_read();
+          if (send(client, b->tx, size) != (int) size
+              || recv_all(server, b->rx, sizeof(b->rx), size) < 0
+              || send(server, b->rx, size) != (int) size
+              || recv_all(client, b->rx, sizeof(b->rx), size) < 0)
+            {
+              printf("bench: tcp_rr failed\n");
+              return;
+            }
+
+          unsigned int us = elapsed_us(start);
+          total += us;
+          if (us < min)
+            min = us;
+        }
+
+      printf("bench: tcp_rr bytes=%u iterations=%u min_us=%u avg_us=%u\n",
+             size, RR_ROUNDS, min, total / RR_ROUNDS);
+    }
+
+  close(client);
+  close(server);
+  close(listener);
+}
+
+void
+bench_net (void)
+{
+  struct buffers b;
+
+  unsigned int i;
+  for (i = 0; i < sizeof(b.tx); ++i)
+    b.tx[i] = i * 7 + 3;
+
+  bench_udp(&b);
+  bench_tcp(&b);
+
+  // the share of the bottom halves in the runs above
+  for (i = 0; i < SOFTIRQ_COUNT; ++i)
+    {
+      struct softirq_stats stats;
+      if (softirq_read(i, &stats) < 0)
+        continue;
+      printf("bench: softirq name=%s runs=%u work=%u exhausted=%u deferred=%u time_us=%u max_us=%u\n",
+             stats.name, stats.runs, stats.work, stats.exhausted,
+             stats.deferred, stats.time_us, stats.max_us);
+    }
+}
@@ -0,0 +1,134 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "bench_syscall.h"
+
+#include "kernel/memory.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+#include "kernel/drivers/timer.h"
+
+#include <stdio.h>
+
+#define ITERATIONS 1000
+#define ROUNDS     16
+
+static int
+__attribute__((noinline))
+null_function (void)
+{
+  asm volatile ("" ::: "memory");
+  return 0;
+}
+
+static void
+report (const char *name, unsigned int min, unsigned int total)
+{
+  printf("bench: %s iterations=%u min_ns=%u avg_ns=%u\n", name, ITERATIONS,
+         min * 1000 / TIMER_COUNTER_MHZ / ITERATIONS,
+         total / ROUNDS * 1000 / TIMER_COUNTER_MHZ / ITERATIONS);
+}
+
+/* run ROUNDS rounds of ITERATIONS calls each and report the fastest and the
+ * average round. the fastest round is the one least disturbed by the timer
+ * interrupt.
+ */
+void
+bench_syscall (void)
+{
+  unsigned int round, i;
+  unsigned int min, total;
+
+  min = 0xFFFFFFFF;
+  total = 0;
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      unsigned int start = timer_counter_read();
+      for (i = 0; i < ITERATIONS; ++i)
+        null_function();
+      unsigned int elapsed = timer_counter_read() - start;
+
+      total += elapsed;
+      if (elapsed < min)
+        min = elapsed;
+    }
+  report("function_call", min, total);
+
+  min = 0xFFFFFFFF;
+  total = 0;
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      unsigned int start = timer_counter_read();
+      for (i = 0; i < ITERATIONS; ++i)
+        syscall_null();
+      unsigned int elapsed = timer_counter_read() - start;
+
+      total += elapsed;
+      if (elapsed < min)
+        min = elapsed;
+    }
+  report("syscall_null", min, total);
+}
+
+void
+bench_task_switch (void)
+{
+  unsigned int round, i;
+  unsigned int min = 0xFFFFFFFF;
+  unsigned int total = 0;
+
+  // every yield of the parent runs the child until its next yield, the
+  // child is done once the parent made its last yield
+  if (task_fork() == 0)
+    {
+      for (i = 0; i < ROUNDS * ITERATIONS; ++i)
+        task_yield();
+      task_exit();
+    }
+
+  for (round = 0; round < ROUNDS; ++round)
+    {
+      unsigned int start = timer_counter_read();
+      for (i = 0; i < ITERATIONS; ++i)
+        task_yield();
+      unsigned int elapsed = timer_counter_read() - start;
+
+      total += elapsed;
+      if (elapsed < min)
+        min = elapsed;
+    }
+
+  // two switches per iteration
+  report("task_switch", min / 2, total / 2);
+
+  while (bench_tasks() > 1)
+    task_sleep(1);
+}
+
+unsigned int
+bench_tasks (void)
+{
+  struct task_stats stats;
+  unsigned int id, count = 0;
+  for (id = 1; id <= MAX_TASK_NUMBER; ++id)
+    if (task_stats(id, &stats) == 0)
+      ++count;
+  return count;
+}
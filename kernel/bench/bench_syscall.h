@@ -0,0 +1,42 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* measure the round-trip cost of a null syscall, compared to a plain function
+ * call, and print the results to the console. meant to be run as a task.
+ */
+void bench_syscall (void);
+
+/* measure the cost of a switch between two tasks that yield to each other
+ * and print the result to the console. no other task may be ready, so this
+ * is run by bench_latency once the other benchmarks finished.
+ */
+void bench_task_switch (void);
+
+/* returns:
+ *   the number of tasks in the system, counted with task_stats since the
+ *   scheduler's data is not readable by tasks
+ */
+unsigned int bench_tasks (void);
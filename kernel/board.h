@@ -0,0 +1,98 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the board the kernel is configured for
+ *
+ * every board has a header in kernel/board/ that is selected at compile
+ * time, so the kernel reaches the hardware without any runtime indirection.
+ * a board header provides
+ *
+ *   - the memory layout: RAM_BASE, RAM_SIZE, BOARD_LOAD_ADDRESS,
+ *     KERNEL_STACK_TOP, IRQ_STACK_ADDRESS, PAGE_POOL_BASE, PAGE_POOL_SIZE,
+ *     BOARD_VECTOR_BASE and, if the board has on-chip memory, FASTMEM_BASE
+ *     and FASTMEM_SIZE. configure.ac reads BOARD_LOAD_ADDRESS and
+ *     FASTMEM_BASE from the header, so they have to be plain hex numbers
+ *   - BOARD_MAPPINGS, the device memory mapped by mmu_init as a list of
+ *     struct board_mapping initializers
+ *   - the interrupt lines IRQ_COUNT, TIMER_IRQ and RESCHED_IRQ, a line that
+ *     is raised by software only
+ *   - the scheduler timer: BOARD_TIMER_PERIOD, BOARD_TICK_US, the counter
+ *     frequency TIMER_COUNTER_MHZ, and BOARD_TIMER_VALUE_ASM,
+ *     BOARD_TIMER_ELAPSED and BOARD_TIMER_TICKS_TO_NS for the latency
+ *     benchmark
+ *   - static inline accessors for the timers, the interrupt controller, the
+ *     console and the reset, see below
+ *
+ * a new board needs a header here and an entry in configure.ac.
+ */
+
+// flags of struct board_mapping
+#define BOARD_MAP_KERNEL  0x0  // kernel read/write, user no access
+#define BOARD_MAP_USER_RO 0x1  // kernel read/write, user read only
+#define BOARD_MAP_USER_RW 0x2  // kernel and user read/write
+#define BOARD_MAP_ACCESS  0x3
+#define BOARD_MAP_CACHED  0x4  // memory instead of device registers
+#define BOARD_MAP_PAGES   0x8  // mapped with 4 KiB pages, all regions mapped
+                               // with pages must share one 1 MiB section
+
+#ifndef __ASSEMBLER__
+
+/* a region mapped 1:1 by mmu_init, later regions override earlier ones */
+struct board_mapping
+{
+  unsigned int base;
+  unsigned int size;
+  unsigned int flags;
+};
+
+#endif
+
+#if BOARD_VERSATILEPB
+#  include "kernel/board/versatilepb.h"
+#elif BOARD_EV3
+#  include "kernel/board/ev3.h"
+#else
+#  error "no board configured"
+#endif
+
+/* the accessors every board header implements:
+ *
+ *   board_timer_start (period)  start the periodic scheduler timer
+ *   board_timer_stop ()         stop the scheduler timer
+ *   board_timer_ack ()          clear the pending scheduler timer interrupt
+ *   board_counter_start ()      start the free running counter
+ *   board_counter_read ()       read the free running counter
+ *   board_irq_init ()           set up the interrupt controller
+ *   board_irq_enable (irq)      unmask an interrupt line
+ *   board_irq_dispatch (handle) call handle for every pending line, handle
+ *                               should be an inline function, so the
+ *                               dispatch loop compiles to direct calls
+ *   board_irq_soft_raise (irq)  assert an interrupt line from software
+ *   board_irq_soft_clear (irq)  deassert a line raised by software
+ *   board_vectors_init ()       make the cpu use BOARD_VECTOR_BASE
+ *   board_uart_putc (c)         write a character to the console
+ *   board_reset ()              reset the board, returns if it can't
+ */
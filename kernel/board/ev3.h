@@ -0,0 +1,268 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* Lego Mindstorms EV3, a TI AM1808 system on chip
+ *
+ * included by kernel/board.h, see there for what a board header provides
+ */
+
+// ## Memory Layout
+
+#define RAM_BASE 0xC0000000
+#define RAM_SIZE 0x4000000
+
+// where u-boot loads the kernel image, see configure.ac
+#define BOARD_LOAD_ADDRESS 0xC1000000
+
+// 128 KiB shared ram holding the hot path
+#define FASTMEM_BASE 0x80000000
+#define FASTMEM_SIZE 0x20000
+
+#define KERNEL_STACK_TOP 0xC5000000
+// top of the 8 KiB ARM local ram, the vector table sits at its bottom
+#define IRQ_STACK_ADDRESS 0xFFFF2000
+
+#define PAGE_POOL_BASE 0xC2000000
+#define PAGE_POOL_SIZE 0x2000000
+
+#define BOARD_VECTOR_BASE 0xFFFF0000
+
+// ## Hardware Memory Mappings
+
+// Timer Adresses
+#define TIMER0_BASE 0x01C20000
+#define TIMER0_INTCTLSTAT_ASM 0x01C20044
+#define TIMER0_TIM34_ASM      0x01C20014
+#define TIMER0_TIM12      (volatile unsigned int*)(TIMER0_BASE+0x10)
+#define TIMER0_TIM34      (volatile unsigned int*)(TIMER0_BASE+0x14)
+#define TIMER0_PRD12      (volatile unsigned int*)(TIMER0_BASE+0x18)
+#define TIMER0_PRD34      (volatile unsigned int*)(TIMER0_BASE+0x1C)
+#define TIMER0_TCR        (volatile unsigned int*)(TIMER0_BASE+0x20)
+#define TIMER0_TGCR       (volatile unsigned int*)(TIMER0_BASE+0x24)
+#define TIMER0_INTCTLSTAT (volatile unsigned int*)(TIMER0_BASE+0x44)
+
+// TCR bits
+#define ENAMODE34        (0b11 << 22)
+#define ENAMODE34_CONTIN (0b10 << 22)
+#define ENAMODE12        (0b11 << 6)
+#define ENAMODE12_CONTIN (0b10 << 6)
+#define CLKSRC12 (1 << 8)
+
+// the timer is clocked from the 24 MHz oscillator, TIM12 runs unscaled
+#define TIMER_COUNTER_MHZ 24
+
+// TGRC bits
+#define PSC34             (0b1111 << 8)
+#define PSC34_VALUE       (0b1111 << 8)
+#define TIMMODE           (0b11 << 2)
+#define TIMMODE_UNCHAINED (0b01 << 2)
+#define PLUSEN         (1 << 4)
+#define TIM34RS_REMOVE (1 << 1)
+#define TIM12RS_REMOVE (1 << 0)
+
+// INTCTLSTAT bits
+#define CLEARTIMER34_ASM #0x30000
+#define PRDINTSTAT34 (1 << 17)
+#define PRDINTEN34   (1 << 16)
+#define PRDINTSTAT12 (1 <<  1)
+#define PRDINTEN12   (1 <<  0)
+
+// ARM interrupt controller (AINTC)
+#define AINTC_BASE      0xFFFEE000
+#define AINTC_SECR1_ASM 0xFFFEE280
+#define AINTC_GER    (volatile unsigned int*)(AINTC_BASE+0x0010)
+#define AINTC_SISR   (volatile unsigned int*)(AINTC_BASE+0x0020)
+#define AINTC_SICR   (volatile unsigned int*)(AINTC_BASE+0x0024)
+#define AINTC_EISR   (volatile unsigned int*)(AINTC_BASE+0x0028)
+#define AINTC_EICR   (volatile unsigned int*)(AINTC_BASE+0x002C)
+#define AINTC_SECR1  (volatile unsigned int*)(AINTC_BASE+0x0280)
+#define AINTC_SECR2  (volatile unsigned int*)(AINTC_BASE+0x0284)
+#define AINTC_SECR3  (volatile unsigned int*)(AINTC_BASE+0x0288)
+#define AINTC_SECR4  (volatile unsigned int*)(AINTC_BASE+0x038C)
+#define AINTC_ESR1   (volatile unsigned int*)(AINTC_BASE+0x0300)
+#define AINTC_ESR2   (volatile unsigned int*)(AINTC_BASE+0x0304)
+#define AINTC_ESR3   (volatile unsigned int*)(AINTC_BASE+0x0308)
+#define AINTC_ESR4   (volatile unsigned int*)(AINTC_BASE+0x030C)
+#define AINTC_CMR0   (volatile unsigned int*)(AINTC_BASE+0x0400)
+#define AINTC_CMR5   (volatile unsigned int*)(AINTC_BASE+0x0414)
+#define AINTC_HIPIR2 (volatile unsigned int*)(AINTC_BASE+0x0904)
+#define AINTC_HIER   (volatile unsigned int*)(AINTC_BASE+0x1500)
+
+// AINTEC bits
+#define GER_ENABLE 1
+#define T64P0_TINT34 (1 << 22)
+#define T64P0_TINT34_ASM #0x400000
+#define HIER_IRQ (1 << 1)
+#define HIPIR_NONE (1 << 31)
+
+// system interrupt numbers
+#define IRQ_COUNT 101
+#define TIMER_IRQ 22
+#define RESCHED_IRQ 10  // PRU_EVTOUT7, the PRU is not used
+
+// UART1, the console
+#define UART_THR (volatile char*)(0x01D0C000)
+#define UART_LSR (volatile char*)(0x01D0C014)
+
+// peripherals, the drivers are still called from task context. the arm local
+// ram holds the vector table, the irq stack and the interrupt controller.
+#define BOARD_MAPPINGS \
+  { 0x01C00000,   0x400000, BOARD_MAP_USER_RW }, \
+  { 0xFFF00000,   0x100000, BOARD_MAP_KERNEL }, \
+  { FASTMEM_BASE, 0x100000, BOARD_MAP_KERNEL | BOARD_MAP_CACHED },
+
+// ## Scheduler Timer
+
+#define BOARD_TIMER_PERIOD 0x10000
+#define BOARD_TICK_US      43691  // 0x10000 at 24 MHz / 16
+
+// the scheduler timer counts up to its period at 24 MHz / 16, it is read
+// from assembly by the latency benchmark
+#define BOARD_TIMER_VALUE_ASM TIMER0_TIM34_ASM
+#define BOARD_TIMER_ELAPSED(V)     (V)
+#define BOARD_TIMER_TICKS_TO_NS(T) ((T) * 2000 / 3)
+
+#ifndef __ASSEMBLER__
+
+static inline void
+board_timer_start (unsigned int period)
+{
+  *TIMER0_TCR  &= ~ENAMODE34;          // disable timer
+  *TIMER0_TGCR &= ~TIM34RS_REMOVE;     // reset timer
+  *TIMER0_TGCR &= ~TIMMODE;            // reset mode bits
+  *TIMER0_TGCR |= TIMMODE_UNCHAINED;   // set dual 32 bit unchained mode
+  *TIMER0_TGCR |= TIM34RS_REMOVE;      // remove timer from reset
+  *TIMER0_PRD34 = period;              // set timer period
+  *TIMER0_TGCR &= ~PSC34;              // reset prescaler
+  *TIMER0_TGCR |= PSC34_VALUE;         // set prescaler
+  *TIMER0_INTCTLSTAT |= PRDINTSTAT34;  // clear interrupts
+  *TIMER0_INTCTLSTAT |= PRDINTEN34;    // enable interrupts
+  *TIMER0_TCR  |= ENAMODE34_CONTIN;    // set continuously-mode, start timer
+}
+
+static inline void
+board_timer_stop (void)
+{
+  *TIMER0_TCR  &= ~ENAMODE34;          // disable timer
+  *TIMER0_INTCTLSTAT |= PRDINTSTAT34;  // clear interrupts
+}
+
+static inline void
+board_timer_ack (void)
+{
+  *TIMER0_INTCTLSTAT |= PRDINTSTAT34;
+}
+
+static inline void
+board_counter_start (void)
+{
+  *TIMER0_TCR  &= ~ENAMODE12;          // disable timer
+  *TIMER0_TGCR &= ~TIM12RS_REMOVE;     // reset timer
+  *TIMER0_TGCR &= ~TIMMODE;            // reset mode bits
+  *TIMER0_TGCR |= TIMMODE_UNCHAINED;   // set dual 32 bit unchained mode
+  *TIMER0_TGCR |= TIM12RS_REMOVE;      // remove timer from reset
+  *TIMER0_TIM12 = 0;                   // reset counter
+  *TIMER0_PRD12 = 0xFFFFFFFF;          // wrap around at 2^32
+  *TIMER0_TCR  |= ENAMODE12_CONTIN;    // set continuously-mode, start timer
+}
+
+static inline unsigned int
+board_counter_read (void)
+{
+  return *TIMER0_TIM12;
+}
+
+// ## Interrupt Controller
+
+static inline void
+board_irq_init (void)
+{
+  *AINTC_SECR1 = 0xFFFFFFFF;   // clear current interrupts
+  *AINTC_GER   = GER_ENABLE;   // enable global interrupts
+  *AINTC_HIER |= HIER_IRQ;     // enable IRQ interrupt line
+}
+
+static inline void
+board_irq_enable (unsigned int irq)
+{
+  // 0-1 are FIQ channels, 2-31 are IRQ channels, lower channels have higher priority
+  volatile unsigned int *cmr = AINTC_CMR0 + irq / 4;
+  *cmr = (*cmr & ~(0xFFu << (irq % 4 * 8))) | (2 << (irq % 4 * 8));
+  *AINTC_EISR = irq;
+}
+
+static inline void
+__attribute__((always_inline))
+board_irq_dispatch (void (*handle) (unsigned int irq))
+{
+  unsigned int irq;
+  while (!((irq = *AINTC_HIPIR2) & HIPIR_NONE))
+    {
+      *AINTC_SICR = irq;  // clear before handling, the source re-asserts
+      handle(irq);
+    }
+}
+
+static inline void
+board_irq_soft_raise (unsigned int irq)
+{
+  *AINTC_SISR = irq;
+}
+
+static inline void
+board_irq_soft_clear (unsigned int irq)
+{
+  *AINTC_SICR = irq;
+}
+
+static inline void
+board_vectors_init (void)
+{
+  // set V bit in c1 register in cp15 to
+  // locate interrupt vector table to 0xFFFF0000
+  asm (
+    "mrc  p15, 0, r0, c1, c0, 0\n"
+    "orr  r0, #0x2000\n"
+    "mcr  p15, 0, r0, c1, c0, 0\n"
+    : : : "r0"
+  );
+}
+
+// ## Console and Reset
+
+static inline void
+board_uart_putc (char c)
+{
+  while (!(*UART_LSR & (1 << 5)));
+  *UART_THR = c;
+}
+
+// the board can't be reset by software
+static inline void
+board_reset (void)
+{ }
+
+#endif
@@ -0,0 +1,247 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* ARM Versatile/PB926EJ-S, as emulated by qemu -M versatilepb
+ *
+ * included by kernel/board.h, see there for what a board header provides
+ */
+
+// ## Memory Layout
+
+#define RAM_BASE 0x00000000
+#define RAM_SIZE 0x8000000
+
+// where qemu -kernel loads the kernel image, see configure.ac
+#define BOARD_LOAD_ADDRESS 0x00010000
+
+#define KERNEL_STACK_TOP 0x4000000
+#define IRQ_STACK_ADDRESS KERNEL_STACK_TOP
+
+#define PAGE_POOL_BASE 0x4000000
+#define PAGE_POOL_SIZE 0x4000000
+
+// the vector table sits at the bottom of ram
+#define BOARD_VECTOR_BASE 0x0
+
+// ## Hardware Memory Mappings
+
+// Timer Adresses
+#define TIMER1_BASE 0x101E2000
+#define TIMER1_INTCLR_ASM 0x101E200C
+#define TIMER1_VALUE_ASM  0x101E2004
+#define TIMER1_LOAD   (volatile unsigned int*)(TIMER1_BASE+0x0)
+#define TIMER1_VALUE  (volatile unsigned int*)(TIMER1_BASE+0x4)
+#define TIMER1_CTRL   (volatile char*)(TIMER1_BASE+0x08)
+#define TIMER1_INTCLR (volatile char*)(TIMER1_BASE+0x0C)
+#define TIMER1_RIS    (volatile char*)(TIMER1_BASE+0x10)
+#define TIMER1_MIS    (volatile char*)(TIMER1_BASE+0x14)
+
+// Second half of the dual timer, used as free running counter
+#define TIMER2_BASE 0x101E2020
+#define TIMER2_LOAD   (volatile unsigned int*)(TIMER2_BASE+0x0)
+#define TIMER2_VALUE  (volatile unsigned int*)(TIMER2_BASE+0x4)
+#define TIMER2_CTRL   (volatile unsigned int*)(TIMER2_BASE+0x08)
+
+// the dual timer is clocked at 1 MHz
+#define TIMER_COUNTER_MHZ 1
+
+
+
+// Primary Interrupt Controller (PL190)
+#define PIC_BASE 0x10140000
+#define PIC_IRQSTATUS    (volatile unsigned int*)(PIC_BASE+0x00)
+#define PIC_INTENABLE    (volatile unsigned int*)(PIC_BASE+0x10)
+#define PIC_INTENCLEAR   (volatile unsigned int*)(PIC_BASE+0x14)
+#define PIC_SOFTINT      (volatile unsigned int*)(PIC_BASE+0x18)
+#define PIC_SOFTINTCLEAR (volatile unsigned int*)(PIC_BASE+0x1C)
+#define PIC_DEFVECTADDR  (volatile unsigned int*)(PIC_BASE+0x34)
+#define TIMER1_INTBIT (1 << 4)
+#define SIC_INTBIT    (1 << 31)
+
+// Secondary Interrupt Controller, cascaded into PIC line 31
+#define SIC_BASE 0x10003000
+#define SIC_STATUS (volatile unsigned int*)(SIC_BASE+0x00)
+#define SIC_ENSET  (volatile unsigned int*)(SIC_BASE+0x08)
+#define SIC_ENCLR  (volatile unsigned int*)(SIC_BASE+0x0C)
+
+// interrupt numbers, 0-31 are PIC lines and 32-63 are SIC lines
+#define IRQ_COUNT    64
+#define IRQ_SIC_BASE 32
+#define TIMER_IRQ    4
+#define RESCHED_IRQ  1   // the software interrupt line of the PIC
+#define ETH_IRQ      (IRQ_SIC_BASE + 25)
+
+// SMSC LAN91C111 ethernet controller
+#define ETH_BASE 0x10010000
+
+// System controller, the reset register is guarded by the lock register
+#define SYSCTL_BASE 0x10000000
+#define SYSCTL_LOCK     (volatile unsigned int*)(SYSCTL_BASE+0x20)
+#define SYSCTL_RESETCTL (volatile unsigned int*)(SYSCTL_BASE+0x40)
+#define SYSCTL_UNLOCK   0xA05F
+#define SYSCTL_RESET    0x100
+// UART0 (PL011), the console
+#define UART_THR (volatile char*)(0x101f1000)
+
+#define BOARD_HAS_SMC91C111 1
+
+// device memory, the interrupt controller stays private to the kernel, the
+// tasks may read the free running counter and write to the uart
+#define BOARD_MAPPINGS \
+  { SYSCTL_BASE, 0x100000, BOARD_MAP_KERNEL }, \
+  { 0x10100000,  0x100000, BOARD_MAP_KERNEL | BOARD_MAP_PAGES }, \
+  { TIMER1_BASE, 0x1000,   BOARD_MAP_USER_RO | BOARD_MAP_PAGES }, \
+  { 0x101F1000,  0x1000,   BOARD_MAP_USER_RW | BOARD_MAP_PAGES },
+
+// ## Scheduler Timer
+
+#define BOARD_TIMER_PERIOD 0x2000
+#define BOARD_TICK_US      8192   // 0x2000 at 1 MHz
+
+// the scheduler timer counts down from its period at 1 MHz, it is read from
+// assembly by the latency benchmark
+#define BOARD_TIMER_VALUE_ASM TIMER1_VALUE_ASM
+#define BOARD_TIMER_ELAPSED(V)     (*TIMER1_LOAD - (V))
+#define BOARD_TIMER_TICKS_TO_NS(T) ((T) * 1000)
+
+#ifndef __ASSEMBLER__
+
+static inline void
+board_timer_start (unsigned int period)
+{
+  *TIMER1_CTRL &= ~(1 << 7);   // disable timer
+  *TIMER1_CTRL |= 1 << 6;      // set periodic-mode
+  *TIMER1_INTCLR = (char)0x1;  // clear interrupts
+  *TIMER1_CTRL |= 1 << 5;      // set IntEnable
+  *TIMER1_CTRL |= 1 << 1;      // set 32-bit mode
+  *TIMER1_CTRL &= ~(1 << 0);   // set Wrapping-Mode
+  *TIMER1_LOAD  = period;      // set timer period
+  *TIMER1_CTRL |= 1 << 7;      // start timer
+}
+
+static inline void
+board_timer_stop (void)
+{
+  *TIMER1_CTRL &= ~(1 << 7);        // disable timer
+  *TIMER1_INTCLR = (char)0x1;       // clear interrupts
+}
+
+static inline void
+board_timer_ack (void)
+{
+  *TIMER1_INTCLR = (char)0x1;
+}
+
+static inline void
+board_counter_start (void)
+{
+  *TIMER2_CTRL  = 0;             // disable timer
+  *TIMER2_LOAD  = 0xFFFFFFFF;    // count down from the top
+  *TIMER2_CTRL  = 1 << 1;        // 32-bit, free-running, no interrupt
+  *TIMER2_CTRL |= 1 << 7;        // start timer
+}
+
+static inline unsigned int
+board_counter_read (void)
+{
+  return ~*TIMER2_VALUE;  // the sp804 counts down
+}
+
+// ## Interrupt Controller
+
+static inline void
+board_irq_init (void)
+{ }
+
+static inline void
+board_irq_enable (unsigned int irq)
+{
+  if (irq >= IRQ_SIC_BASE)
+    {
+      *SIC_ENSET = 1 << (irq - IRQ_SIC_BASE);
+      *PIC_INTENABLE = SIC_INTBIT;
+    }
+  else
+    *PIC_INTENABLE = 1 << irq;
+}
+
+// run handle for all pending lines in status, highest line first
+static inline void
+__attribute__((always_inline))
+board_irq_dispatch_lines (unsigned int status, unsigned int base,
+                          void (*handle) (unsigned int irq))
+{
+  while (status)
+    {
+      unsigned int line = 31 - __builtin_clz(status);
+      status &= ~(1 << line);
+      handle(base + line);
+    }
+}
+
+static inline void
+__attribute__((always_inline))
+board_irq_dispatch (void (*handle) (unsigned int irq))
+{
+  unsigned int status = *PIC_IRQSTATUS;
+  board_irq_dispatch_lines(status & ~SIC_INTBIT, 0, handle);
+  if (status & SIC_INTBIT)
+    board_irq_dispatch_lines(*SIC_STATUS, IRQ_SIC_BASE, handle);
+}
+
+// only PIC lines can be raised by software
+static inline void
+board_irq_soft_raise (unsigned int irq)
+{
+  *PIC_SOFTINT = 1 << irq;
+}
+
+static inline void
+board_irq_soft_clear (unsigned int irq)
+{
+  *PIC_SOFTINTCLEAR = 1 << irq;
+}
+
+static inline void
+board_vectors_init (void)
+{ }
+
+// ## Console and Reset
+
+static inline void
+board_uart_putc (char c)
+{
+  *UART_THR = c;
+}
+
+static inline void
+board_reset (void)
+{
+  *SYSCTL_LOCK = SYSCTL_UNLOCK;
+  *SYSCTL_RESETCTL = SYSCTL_RESET;
+}
+
+#endif
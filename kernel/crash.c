@@ -0,0 +1,175 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "crash.h"
+
+#include "kernel/memory.h"
+#include "kernel/mmu.h"
+#include "kernel/scheduler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CRASH_MAGIC 0x5348524B
+
+#define CPSR_MODE_MASK 0x1f
+#define CPSR_MODE_USER 0x10
+#define CPSR_MODE_SVC  0x13
+#define CPSR_IRQ_DISABLE 0x80
+
+crash_log crash_log_buffer __attribute__((section(".noinit")));
+
+static const char *crash_names[] =
+{
+  [CRASH_UNDEFINED]      = "undefined instruction",
+  [CRASH_PREFETCH_ABORT] = "prefetch abort",
+  [CRASH_DATA_ABORT]     = "data abort",
+};
+
+static void
+crash_print (crash_record *record)
+{
+  printf("crash: %s in task %u, mode 0x%x, tick %u\n",
+         crash_names[record->type], record->task_id, record->mode, record->tick);
+  printf("crash: pc 0x%x, fsr 0x%x, far 0x%x\n",
+         record->task.pc, record->fsr, record->far);
+
+  unsigned int i;
+  for (i = 0; i < 13; ++i)
+    printf("crash: r%u 0x%x\n", i, record->task.reg[i]);
+  printf("crash: sp 0x%x, lr 0x%x, cpsr 0x%x\n",
+         record->task.sp, record->task.lr, record->task.cpsr);
+
+  for (i = 0; i < record->stack_words; ++i)
+    printf("crash: [sp+0x%x] 0x%x\n", i * 4, record->stack[i]);
+}
+
+// the crashed task owned the cpu, so it is the task running in user mode or
+// the task whose syscall was interrupted. syscalls run with interrupts
+// disabled, bottom halves run in svc mode too but with interrupts enabled
+// on top of an interrupt frame, their faults belong to the kernel.
+static int
+crashed_in_task (unsigned int spsr)
+{
+  unsigned int mode = spsr & CPSR_MODE_MASK;
+  if (mode != CPSR_MODE_USER
+      && (mode != CPSR_MODE_SVC || !(spsr & CPSR_IRQ_DISABLE)))
+    return 0;
+
+  return current_task >= tasks && current_task < tasks + MAX_TASK_NUMBER
+      && current_task->state == TASK_RUNNING;
+}
+
+void
+crash_handler (unsigned int type, unsigned int *frame)
+{
+  unsigned int spsr, fsr = 0, far = 0;
+  asm volatile ("mrs  %0, spsr\n" : "=r" (spsr));
+
+  if (type == CRASH_DATA_ABORT)
+    {
+      asm volatile ("mrc  p15, 0, %0, c5, c0, 0\n" : "=r" (fsr));
+      asm volatile ("mrc  p15, 0, %0, c6, c0, 0\n" : "=r" (far));
+    }
+  if (type == CRASH_PREFETCH_ABORT)
+    asm volatile ("mrc  p15, 0, %0, c5, c0, 1\n" : "=r" (fsr));
+
+  unsigned int mode = spsr & CPSR_MODE_MASK;
+  int in_task = crashed_in_task(spsr);
+
+  if (crash_log_buffer.magic != CRASH_MAGIC)
+    {
+      crash_log_buffer.magic = CRASH_MAGIC;
+      crash_log_buffer.count = 0;
+    }
+  crash_record *record = &crash_log_buffer.records[crash_log_buffer.count % CRASH_RECORDS];
+  crash_log_buffer.count++;
+
+  memset(record, 0, sizeof(*record));
+  record->type = type;
+  record->task_id = in_task ? current_task - tasks + 1 : 0;
+  record->mode = mode;
+  record->fsr = fsr;
+  record->far = far;
+  record->tick = tick_count;
+  if (in_task)
+    record->task = *current_task;
+
+  // the registers of the crashed context, sp and lr are taken from user mode
+  memcpy(record->task.reg, frame, sizeof(record->task.reg));
+  asm volatile ("stm  %0, {sp, lr}^\n" : : "r" (&record->task.sp) : "memory");
+  record->task.pc = frame[13];
+  record->task.cpsr = spsr;
+
+  if (in_task)
+    {
+      unsigned int sp = record->task.sp;
+      while (record->stack_words < CRASH_STACK_WORDS && !(sp & 3)
+             && mmu_task_mapped(sp))
+        {
+          record->stack[record->stack_words++] = *(unsigned int*) sp;
+          sp += 4;
+        }
+    }
+
+  // write the log back to memory, a warm reset does not preserve the cache
+  dcache_clean_range((unsigned int) &crash_log_buffer, sizeof(crash_log_buffer));
+
+  crash_print(record);
+
+  if (!in_task)
+    {
+      puts("crash: not caused by a task, halting");
+      while (1);
+    }
+
+  exit_current_task();
+  schedule();
+}
+
+void
+system_reset (void)
+{
+  board_reset();
+  while (1);
+}
+
+/* report the crashes recorded before the last reset
+ * this is done automatically on startup
+ */
+static void
+__attribute((constructor))
+crash_init (void)
+{
+  if (crash_log_buffer.magic != CRASH_MAGIC)
+    return;
+
+  printf("crash: %u crashes recorded before reset\n", crash_log_buffer.count);
+
+  unsigned int first = 0;
+  if (crash_log_buffer.count > CRASH_RECORDS)
+    first = crash_log_buffer.count - CRASH_RECORDS;
+
+  unsigned int i;
+  for (i = first; i < crash_log_buffer.count; ++i)
+    crash_print(&crash_log_buffer.records[i % CRASH_RECORDS]);
+
+  crash_log_buffer.magic = 0;
+}
@@ -0,0 +1,83 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+// crash types, passed to crash_handler in r0
+#define CRASH_UNDEFINED      1
+#define CRASH_PREFETCH_ABORT 2
+#define CRASH_DATA_ABORT     3
+
+#ifndef __ASSEMBLER__
+
+#include "kernel/scheduler.h"
+
+#define CRASH_STACK_WORDS 16
+#define CRASH_RECORDS     4
+
+/* everything that is known about a crash */
+struct crash_record
+{
+  unsigned int type;
+  unsigned int task_id;        // 0 if the crash was not caused by a task
+  unsigned int mode;           // processor mode at the time of the crash
+  unsigned int fsr;            // fault status, if type is an abort
+  unsigned int far;            // fault address, if type is a data abort
+  unsigned int tick;
+  task_t task;                 // registers at the time of the crash
+  unsigned int stack[CRASH_STACK_WORDS];
+  unsigned int stack_words;    // number of valid words in stack
+};
+typedef struct crash_record crash_record;
+
+/* the crash log is not cleared on startup, so it survives a warm reset */
+struct crash_log
+{
+  unsigned int magic;
+  unsigned int count;          // number of crashes since the log was cleared
+  crash_record records[CRASH_RECORDS];
+};
+typedef struct crash_log crash_log;
+
+extern crash_log crash_log_buffer;
+
+/* called from the undefined instruction and abort handlers
+ *
+ * the crash is recorded in the crash log and dumped to the console. if the
+ * crash was caused by a task, the task is killed and the next task is
+ * selected, otherwise the system is halted.
+ *
+ * params:
+ *   type - one of the CRASH_ constants
+ *   frame - r0-r12 and the address of the faulting instruction, as saved by
+ *   the handler
+ */
+void crash_handler (unsigned int type, unsigned int *frame);
+
+/* reset the board, qemu exits instead if it was started with -no-reboot.
+ * halts on boards that can't be reset by software. does not return.
+ */
+void system_reset (void);
+
+#endif
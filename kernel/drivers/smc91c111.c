@@ -0,0 +1,461 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "smc91c111.h"
+
+#include "kernel/memory.h"
+#include "kernel/interrupt.h"
+#include "kernel/softirq.h"
+#include "kernel/trace.h"
+#include "kernel/drivers/timer.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+
+static int present = 0;
+static unsigned char station_address[ETH_ALEN];
+static eth_rx_handler_t rx_handler = 0;
+static struct smc91c111_stats stats = { 0 };
+
+static struct smc91c111_coalesce coalesce =
+{
+  .rx_frames = SMC91C111_RX_FRAMES,
+  .rx_usecs = SMC91C111_RX_USECS,
+  .tx_frames = SMC91C111_TX_FRAMES,
+};
+
+#if BOARD_HAS_SMC91C111
+
+// all registers are banked, the bank select register is visible in every bank
+#define REG8(O)  (volatile unsigned char*)(ETH_BASE + (O))
+#define REG16(O) (volatile unsigned short*)(ETH_BASE + (O))
+#define REG32(O) (volatile unsigned int*)(ETH_BASE + (O))
+
+#define BANK_SELECT REG16(0xE)
+#define BANK_ID     REG8(0xF)
+#define BANK_ID_VALUE 0x33
+
+// bank 0
+#define TCR REG16(0x0)
+#define RCR REG16(0x4)
+#define TCR_TXENA    0x0001
+#define TCR_PAD_EN   0x0080
+#define RCR_RXEN     0x0100
+#define RCR_STRIP_CRC 0x0200
+#define RCR_SOFT_RST 0x8000
+
+// bank 1
+#define IA(N)   REG8(0x4 + (N))
+#define CONTROL REG16(0xC)
+#define CONTROL_AUTO_RELEASE 0x0800
+
+// bank 2
+#define MMU_CMD   REG16(0x0)
+#define PNR       REG8(0x2)
+#define ARR       REG8(0x3)
+#define TX_FIFO   REG8(0x4)
+#define RX_FIFO   REG8(0x5)
+#define POINTER   REG16(0x6)
+#define DATA16    REG16(0x8)
+#define DATA32    REG32(0x8)
+#define INT_STAT  REG8(0xC)
+#define INT_MASK  REG8(0xD)
+
+#define MMU_BUSY           0x0001
+#define MMU_ALLOC          (1 << 5)
+#define MMU_RESET          (2 << 5)
+#define MMU_RX_RELEASE     (4 << 5)
+#define MMU_RELEASE_PACKET (5 << 5)
+#define MMU_TX_ENQUEUE     (6 << 5)
+
+#define ARR_FAILED 0x80
+#define FIFO_EMPTY 0x80
+
+#define PTR_RCV      0x8000
+#define PTR_AUTOINCR 0x4000
+#define PTR_READ     0x2000
+
+#define INT_RCV     0x01
+#define INT_TX      0x02
+#define INT_ALLOC   0x08
+#define INT_RX_OVRN 0x10
+
+// packet memory layout: status word, byte count, data, control word
+#define PACKET_OVERHEAD 6
+#define CTL_ODD         0x2000
+#define RX_ODDFRM       0x1000
+#define RX_ERRORS       0xAC00  // alignment, bad crc, too long, too short
+#define TX_SUC          0x0001
+
+// frames waiting for packet memory, linked through their link pointer, and
+// the number of frames queued since the transmitter was last kicked
+static struct pbuf *tx_pending = 0;
+static struct pbuf **tx_pending_tail = &tx_pending;
+static unsigned int tx_batched = 0;
+static int alloc_outstanding = 0;
+
+// the interrupts the driver waits for. while the bottom half polls the
+// controller, all of them are masked in the controller.
+static unsigned char int_mask = 0;
+static int polling = 0;
+
+static inline void
+mmu_command (unsigned short command)
+{
+  while (*MMU_CMD & MMU_BUSY);
+  *MMU_CMD = command;
+}
+
+static void
+int_enable (unsigned char bits)
+{
+  unsigned int flags = irq_save();
+  int_mask |= bits;
+  if (!polling)
+    *INT_MASK = int_mask;
+  irq_restore(flags);
+}
+
+// copy the frame at the head of the pending queue into the allocated packet
+// and hand it to the transmitter
+static void
+tx_load (unsigned int packet)
+{
+  struct pbuf *p = tx_pending;
+  tx_pending = p->link;
+  if (!tx_pending)
+    tx_pending_tail = &tx_pending;
+  p->link = 0;
+
+  *PNR = packet;
+  *POINTER = PTR_AUTOINCR;
+  *DATA32 = ((p->tot_len & ~1) + PACKET_OVERHEAD) << 16;
+
+  // buffers of a chain may end on odd lengths, a left over byte is carried
+  // into the next data register write
+  unsigned int carry = 0;
+  int carrying = 0;
+  struct pbuf *q;
+  for (q = p; q; q = q->next)
+    {
+      const unsigned char *data = q->payload;
+      unsigned int length = q->len;
+      unsigned int i = 0;
+
+      if (carrying && length)
+        {
+          *DATA16 = carry | (data[i++] << 8);
+          carrying = 0;
+        }
+      if (!((unsigned int)(data + i) & 3))
+        for (; i + 4 <= length; i += 4)
+          *DATA32 = *(const unsigned int*)(data + i);
+      for (; i + 2 <= length; i += 2)
+        *DATA16 = data[i] | (data[i + 1] << 8);
+      if (i < length)
+        {
+          carry = data[i];
+          carrying = 1;
+        }
+    }
+  *DATA16 = carrying ? CTL_ODD | carry : 0;
+
+  mmu_command(MMU_TX_ENQUEUE);
+
+  // the frame lives in packet memory now, which the controller releases by
+  // itself once the frame is sent
+  stats.tx_frames++;
+  stats.tx_bytes += p->tot_len;
+  pbuf_free(p);
+}
+
+// request packet memory for the pending frames until the controller runs out
+static void
+tx_start (void)
+{
+  while (tx_pending && !alloc_outstanding)
+    {
+      mmu_command(MMU_ALLOC);
+      unsigned char result = *ARR;
+      if (result & ARR_FAILED)
+        {
+          // completes once a transmitted packet is released
+          alloc_outstanding = 1;
+          int_enable(INT_ALLOC);
+          stats.tx_deferred++;
+          return;
+        }
+      tx_load(result);
+    }
+}
+
+// hand the frames queued since the last kick to the controller in one go
+static void
+tx_kick (void)
+{
+  trace(TRACE_NET_TX, tx_batched, 0);
+  tx_batched = 0;
+  stats.tx_kicks++;
+  tx_start();
+}
+
+// with auto release, only failed frames are reported in the completion fifo
+static void
+tx_complete (void)
+{
+  unsigned char packet;
+  while (!((packet = *TX_FIFO) & FIFO_EMPTY))
+    {
+      *PNR = packet;
+      *POINTER = PTR_AUTOINCR | PTR_READ;
+      unsigned short status = *DATA16;
+      mmu_command(MMU_RELEASE_PACKET);
+      *INT_STAT = INT_TX;  // acknowledging pops the completion fifo
+
+      if (!(status & TX_SUC))
+        {
+          // the transmitter disables itself on errors
+          stats.tx_errors++;
+          *BANK_SELECT = 0;
+          *TCR |= TCR_TXENA;
+          *BANK_SELECT = 2;
+        }
+    }
+}
+
+static unsigned int
+rx_batch (unsigned int budget)
+{
+  unsigned int done = 0;
+  while (done < budget && !(*RX_FIFO & FIFO_EMPTY))
+    {
+      ++done;
+      *POINTER = PTR_RCV | PTR_AUTOINCR | PTR_READ;
+      unsigned int header = *DATA32;
+      unsigned int status = header & 0xFFFF;
+      unsigned int length = ((header >> 16) & 0x7FF) - PACKET_OVERHEAD;
+      if (status & RX_ODDFRM)
+        ++length;
+
+      struct pbuf *p = 0;
+      if ((status & RX_ERRORS) || length < 14 || length > ETH_FRAME_MAX)
+        stats.rx_errors++;
+      else if (!rx_handler || !(p = pbuf_alloc(PBUF_LINK_HEADROOM, length)))
+        stats.rx_dropped++;
+      else
+        {
+          // the payload is two bytes off word alignment, so that the ip
+          // header behind the ethernet header is aligned
+          *(unsigned short*)p->payload = *DATA16;
+          unsigned int *data = (unsigned int*)(p->payload + 2);
+          unsigned int i;
+          for (i = 0; i < (length + 1) / 4; ++i)
+            data[i] = *DATA32;
+        }
+
+      mmu_command(MMU_RX_RELEASE);
+
+      if (p)
+        {
+          stats.rx_frames++;
+          stats.rx_bytes += length;
+          rx_handler(p);
+        }
+    }
+
+  return done;
+}
+
+// wait up to the coalescing time for another frame to arrive. on a busy
+// link, picking it up here is cheaper than taking the next interrupt.
+static int
+rx_wait (void)
+{
+  unsigned int start = timer_counter_read();
+  unsigned int limit = coalesce.rx_usecs * TIMER_COUNTER_MHZ;
+  while (*RX_FIFO & FIFO_EMPTY)
+    if (timer_counter_read() - start >= limit)
+      return 0;
+  return 1;
+}
+
+// the controller is processed by the receive bottom half, which unmasks
+// the interrupts again once it caught up
+static void
+smc91c111_interrupt (void)
+{
+  unsigned char status = *INT_STAT & *INT_MASK;
+  stats.interrupts++;
+  if (status & INT_RCV)
+    stats.rx_interrupts++;
+  if (status & INT_TX)
+    stats.tx_interrupts++;
+
+  *INT_MASK = 0;
+  polling = 1;
+  softirq_raise(SOFTIRQ_NET_RX);
+}
+
+static void
+__attribute((constructor))
+smc91c111_init (void)
+{
+  if (*BANK_ID != BANK_ID_VALUE)
+    return;
+
+  *BANK_SELECT = 0;
+  *RCR = RCR_SOFT_RST;
+  *RCR = 0;
+
+  *BANK_SELECT = 1;
+  *CONTROL |= CONTROL_AUTO_RELEASE;
+  unsigned int i;
+  for (i = 0; i < ETH_ALEN; ++i)
+    station_address[i] = *IA(i);
+
+  *BANK_SELECT = 0;
+  *TCR = TCR_TXENA | TCR_PAD_EN;
+  *RCR = RCR_RXEN | RCR_STRIP_CRC;
+
+  // the driver keeps bank 2 selected from here on
+  *BANK_SELECT = 2;
+  mmu_command(MMU_RESET);
+  int_mask = INT_RCV | INT_TX | INT_RX_OVRN;
+  *INT_MASK = int_mask;
+
+  interrupt_register(ETH_IRQ, &smc91c111_interrupt);
+  present = 1;
+}
+
+#endif
+
+int
+smc91c111_present (void)
+{
+  return present;
+}
+
+void
+smc91c111_mac (unsigned char *mac)
+{
+  unsigned int i;
+  for (i = 0; i < ETH_ALEN; ++i)
+    mac[i] = station_address[i];
+}
+
+void
+smc91c111_set_rx_handler (eth_rx_handler_t handler)
+{
+  rx_handler = handler;
+}
+
+unsigned int
+smc91c111_poll (unsigned int budget)
+{
+#if BOARD_HAS_SMC91C111
+  if (!polling)
+    return 0;
+
+  unsigned char status = *INT_STAT & int_mask;
+
+  if (status & INT_RX_OVRN)
+    {
+      stats.rx_overruns++;
+      *INT_STAT = INT_RX_OVRN;
+    }
+
+  if (status & INT_TX)
+    tx_complete();
+
+  if (status & INT_ALLOC)
+    {
+      int_mask &= ~INT_ALLOC;
+      alloc_outstanding = 0;
+      tx_load(*ARR);
+    }
+
+  tx_start();
+
+  unsigned int done = rx_batch(budget);
+  trace(TRACE_NET_RX, done, 0);
+  if (done == budget)
+    {
+      // more frames may be waiting, keep polling
+      softirq_raise(SOFTIRQ_NET_RX);
+      return done;
+    }
+
+  if (coalesce.rx_usecs && done >= coalesce.rx_frames && rx_wait())
+    {
+      // keep the interrupts masked and poll again
+      stats.rx_coalesced++;
+      softirq_raise(SOFTIRQ_NET_RX);
+      return done;
+    }
+
+  polling = 0;
+  *INT_MASK = int_mask;
+  return done;
+#else
+  return 0;
+#endif
+}
+
+int
+smc91c111_transmit (struct pbuf *p)
+{
+  if (!present)
+    return -ENODEV;
+  if (p->tot_len < 14 || p->tot_len > ETH_FRAME_MAX)
+    return -EINVAL;
+
+#if BOARD_HAS_SMC91C111
+  p->link = 0;
+  *tx_pending_tail = p;
+  tx_pending_tail = &p->link;
+
+  if (++tx_batched >= coalesce.tx_frames)
+    tx_kick();
+#endif
+  return 0;
+}
+
+void
+smc91c111_flush (void)
+{
+#if BOARD_HAS_SMC91C111
+  if (tx_batched)
+    tx_kick();
+#endif
+}
+
+struct smc91c111_coalesce*
+smc91c111_coalesce (void)
+{
+  return &coalesce;
+}
+
+const struct smc91c111_stats*
+smc91c111_stats (void)
+{
+  unsigned int frames = stats.rx_frames + stats.tx_frames;
+  stats.irq_per_kframe = frames ? stats.interrupts * 1000ULL / frames : 0;
+  return &stats;
+}
@@ -0,0 +1,140 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/net/ethernet.h"
+
+struct pbuf;
+
+/* receive hook, called from smc91c111_poll for every received frame.
+ * the hook takes over the reference to the packet, its payload starts with
+ * the ethernet header.
+ */
+typedef void (*eth_rx_handler_t) (struct pbuf *p);
+
+// default interrupt coalescing parameters, see struct smc91c111_coalesce
+#define SMC91C111_RX_FRAMES 2
+#define SMC91C111_RX_USECS  50
+#define SMC91C111_TX_FRAMES 4
+
+/* interrupt coalescing parameters, may be changed at runtime
+ *
+ * the controller has no interrupt moderation of its own. instead, a poll of
+ * the receive bottom half that handled at least rx_frames frames keeps the
+ * interrupts masked for up to rx_usecs microseconds while it waits for the
+ * next frame. an rx_usecs of 0 unmasks the interrupts as soon as the receive
+ * fifo is empty.
+ *
+ * frames are queued for transmission until tx_frames of them are pending or
+ * the network stack flushes the queue, see smc91c111_flush.
+ */
+struct smc91c111_coalesce
+{
+  unsigned int rx_frames;
+  unsigned int rx_usecs;
+  unsigned int tx_frames;
+};
+
+struct smc91c111_stats
+{
+  unsigned int rx_frames;
+  unsigned int rx_bytes;
+  unsigned int rx_errors;
+  unsigned int rx_dropped;
+  unsigned int rx_overruns;
+  unsigned int rx_interrupts;
+  unsigned int rx_coalesced;  // interrupts saved by waiting for frames
+  unsigned int tx_frames;
+  unsigned int tx_bytes;
+  unsigned int tx_errors;
+  unsigned int tx_deferred;
+  unsigned int tx_interrupts;
+  unsigned int tx_kicks;      // batches handed to the controller
+  unsigned int interrupts;
+  unsigned int irq_per_kframe;  // interrupts per 1000 frames sent or received
+};
+
+/* check whether a controller was found during initialization
+ *
+ * returns:
+ *   1 if the controller is present and initialized, 0 otherwise
+ */
+int smc91c111_present (void);
+
+/* copy the station address of the controller
+ *
+ * params:
+ *   mac - a buffer of ETH_ALEN bytes
+ */
+void smc91c111_mac (unsigned char *mac);
+
+/* install the receive hook, received frames are dropped while it is unset
+ */
+void smc91c111_set_rx_handler (eth_rx_handler_t handler);
+
+/* process the controller after an interrupt, called from the receive
+ * bottom half
+ *
+ * the interrupt handler masks the interrupts of the controller and raises
+ * SOFTIRQ_NET_RX. the bottom half handles transmission errors and hands up
+ * to budget received frames to the receive hook. if frames remain, or arrive
+ * within the coalescing time, the softirq is raised again, otherwise the
+ * interrupts are unmasked.
+ *
+ * returns:
+ *   the number of received frames processed
+ */
+unsigned int smc91c111_poll (unsigned int budget);
+
+/* queue an ethernet frame for transmission
+ *
+ * the frame is copied into the packet memory of the controller once a batch
+ * of tx_frames frames is queued or the queue is flushed, and as soon as
+ * memory is available. the driver takes over the reference to the packet and
+ * drops it once the frame is copied.
+ *
+ * params:
+ *   p - the frame including the ethernet header but not the crc, which is
+ *       appended by the controller. may be a chain.
+ *
+ * returns:
+ *   0 on success, -EINVAL for bad frame lengths and -ENODEV if no controller
+ *   is present. on failure the reference stays with the caller.
+ */
+int smc91c111_transmit (struct pbuf *p);
+
+/* hand the frames queued for transmission to the controller, called by
+ * the network stack when it is done sending for now
+ */
+void smc91c111_flush (void);
+
+/* returns the interrupt coalescing parameters, which take effect with the
+ * next frame
+ */
+struct smc91c111_coalesce* smc91c111_coalesce (void);
+
+/* returns the driver statistics
+ */
+const struct smc91c111_stats* smc91c111_stats (void);
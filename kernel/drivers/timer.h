@@ -27,3 +27,22 @@
 void timer_start (unsigned int period);
 
 void timer_stop (void);
+
+/* clear the pending period interrupt of the timer started by timer_start
+ */
+void timer_ack (void);
+
+/* start the free running counter used for time measurements
+ *
+ * the counter is independent of the scheduler timer and is not reset by
+ * timer_start or timer_stop
+ */
+void timer_counter_start (void);
+
+/* read the free running counter
+ *
+ * returns:
+ *   a monotonically increasing value that wraps around at 2^32, counting at
+ *   TIMER_COUNTER_MHZ (see kernel/board.h) ticks per microsecond
+ */
+unsigned int timer_counter_read (void);
@@ -22,14 +22,9 @@
 
 #include "kernel/memory.h"
 #include "kernel/interrupt_handler.h"
+#include "kernel/trace.h"
 
-#if BOARD_EV3
-#  define IVT_OFFSET (unsigned int) 0xFFFF0000
-#endif
-
-#if BOARD_VERSATILEPB
-#  define IVT_OFFSET (unsigned int) 0x0
-#endif
+#define IVT_OFFSET (unsigned int) BOARD_VECTOR_BASE
 
 // builds the interrupt vector table
 void
@@ -44,57 +39,100 @@ setup_ivt (void)
   *(unsigned int*) (IVT_OFFSET + 0x18) = 0xe59ff014;  //ldr pc, [pc, #20] ; 0x34 IRQ
   *(unsigned int*) (IVT_OFFSET + 0x1c) = 0xe59ff014;  //ldr pc, [pc, #20] ; 0x38 FIQ
 
-  *(unsigned int*) (IVT_OFFSET + 0x20) = (unsigned int) 0;
+  *(unsigned int*) (IVT_OFFSET + 0x20) = (unsigned int) &undef_handler;
   //ATTENTION: don't use software interrupts in supervisor mode
-  *(unsigned int*) (IVT_OFFSET + 0x24) = (unsigned int) 0;
-  *(unsigned int*) (IVT_OFFSET + 0x28) = (unsigned int) 0;
-  *(unsigned int*) (IVT_OFFSET + 0x2c) = (unsigned int) 0;
+  *(unsigned int*) (IVT_OFFSET + 0x24) = (unsigned int) &swi_handler;
+  *(unsigned int*) (IVT_OFFSET + 0x28) = (unsigned int) &pabort_handler;
+  *(unsigned int*) (IVT_OFFSET + 0x2c) = (unsigned int) &dabort_handler;
   *(unsigned int*) (IVT_OFFSET + 0x30) = (unsigned int) 0;
   *(unsigned int*) (IVT_OFFSET + 0x34) = (unsigned int) &irq_handler;
   *(unsigned int*) (IVT_OFFSET + 0x38) = (unsigned int) 0;
 
-#if BOARD_EV3
-  // set V bit in c1 register in cp15 to
-  // locate interrupt vector table to 0xFFFF0000
-  asm (
-    "mrc  p15, 0, r0, c1, c0, 0\n"
-    "orr  r0, #0x2000\n"
-    "mcr  p15, 0, r0, c1, c0, 0\n"
-  );
-#endif
+  board_vectors_init();
 }
 
-void
-setup_irq_stack (void)
+#define CPSR_MODE_IRQ 0x12
+#define CPSR_MODE_ABT 0x17
+#define CPSR_MODE_UND 0x1b
+
+// set the stack pointer of the given exception mode
+static void
+setup_stack (unsigned int mode, unsigned int address)
 {
   asm volatile (
     "mrs  r0, cpsr\n"
     "bic  r0, #0x1f\n" // Clear mode bits
-    "orr  r0, #0x12\n" // Select IRQ mode
-    "msr  cpsr, r0\n"  // Enter IRQ mode
-    "mov  sp, %0\n"    // set stack pointer
+    "orr  r0, %0\n"    // Select exception mode
+    "msr  cpsr, r0\n"  // Enter exception mode
+    "mov  sp, %1\n"    // set stack pointer
     "bic  r0, #0x1f\n" // Clear mode bits
     "orr  r0, #0x13\n" // Select SVC mode
     "msr  cpsr, r0\n"  // Enter SVC mode
-    : : "r" (IRQ_STACK_ADDRESS)
+    : : "r" (mode), "r" (address) : "r0"
   );
 }
 
+void
+setup_stacks (void)
+{
+  setup_stack(CPSR_MODE_IRQ, IRQ_STACK_ADDRESS);
+  setup_stack(CPSR_MODE_ABT, ABT_STACK_ADDRESS);
+  setup_stack(CPSR_MODE_UND, UND_STACK_ADDRESS);
+}
+
+static interrupt_handler_t interrupt_handlers[IRQ_COUNT] __fastdata = { 0 };
+
+unsigned int irq_kernel_pc __fastdata = 0;
+
+void
+interrupt_register (unsigned int irq, interrupt_handler_t handler)
+{
+  interrupt_handlers[irq] = handler;
+  board_irq_enable(irq);
+}
+
+// run the handler of a pending line, inlined into the dispatch loop of the
+// board
+static inline void
+__attribute__((always_inline))
+handle_irq (unsigned int irq)
+{
+  interrupt_handler_t handler = interrupt_handlers[irq];
+  if (handler)
+    {
+      trace(TRACE_IRQ_ENTRY, irq, 0);
+      handler();
+      trace(TRACE_IRQ_EXIT, irq, 0);
+    }
+}
+
+void
+__fasttext
+interrupt_dispatch (void)
+{
+  board_irq_dispatch(&handle_irq);
+}
+
 void
 init_interrupt_controller (void)
 {
-#if BOARD_VERSATILEPB
-  *PIC_INTENABLE |= TIMER1_INTBIT;  // unmask interrupt bit for timer1
-#endif
-
-#if BOARD_EV3
-  *AINTC_SECR1 = 0xFFFFFFFF;   // clear current interrupts
-  *AINTC_GER   = GER_ENABLE;   // enable global interrupts
-  *AINTC_HIER |= HIER_IRQ;     // enable IRQ interrupt line
-  *AINTC_ESR1 |= T64P0_TINT34; // enable timer interrupt
-  *AINTC_CMR5 |= 2 << (2*8);   // set channel of timer interrupt to 2
-  // 0-1 are FIQ channels, 2-31 are IRQ channels, lower channels have higher priority
-#endif
+  board_irq_init();
+}
+
+void
+__fasttext
+interrupt_resched (void)
+{
+  board_irq_soft_raise(RESCHED_IRQ);
+}
+
+// the work is done by irq_handler after the dispatch, which runs the
+// pending softirqs and the scheduler
+static void
+__fasttext
+resched_interrupt (void)
+{
+  board_irq_soft_clear(RESCHED_IRQ);
 }
 
 void
@@ -111,8 +149,9 @@ void
 init_interrupt_handling (void)
 {
   setup_ivt();
-  setup_irq_stack();
+  setup_stacks();
   init_interrupt_controller();
+  interrupt_register(RESCHED_IRQ, &resched_interrupt);
   enable_irq();
 }
 
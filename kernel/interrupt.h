@@ -24,4 +24,75 @@
 #  include <config.h>
 #endif
 
+typedef void (*interrupt_handler_t) (void);
+
 void init_interrupt_handling(void);
+
+/* install the handler for an interrupt line and unmask the line
+ *
+ * handlers run in irq mode on the irq stack with interrupts disabled. they
+ * must clear or mask the interrupt condition at the source. since handlers
+ * may also interrupt a bottom half, they leave everything beyond the
+ * hardware to a bottom half, see kernel/softirq.h.
+ *
+ * params:
+ *   irq     - the interrupt number, see IRQ_COUNT in kernel/memory.h
+ *   handler - the function to call while the line is pending
+ */
+void interrupt_register (unsigned int irq, interrupt_handler_t handler);
+
+/* run the handlers of all pending interrupt lines, called by irq_handler
+ */
+void interrupt_dispatch (void);
+
+/* the address of the interrupted instruction while the handlers run for an
+ * interrupt of the kernel, e.g. of a bottom half. 0 while they run for an
+ * interrupt of a task, whose address is saved in current_task->pc.
+ */
+extern unsigned int irq_kernel_pc;
+
+/* raise the reschedule interrupt, which is taken as soon as interrupts are
+ * enabled again. a syscall that raised a softirq uses it, so the softirq and
+ * the tasks it wakes run right when the syscall returns instead of at the
+ * next timer tick.
+ */
+void interrupt_resched (void);
+
+/* returns:
+ *   whether the kernel runs a syscall, i.e. runs in svc mode with interrupts
+ *   disabled. bottom halves run in svc mode with interrupts enabled.
+ */
+static inline int
+in_syscall (void)
+{
+  unsigned int cpsr;
+  asm volatile ("mrs  %0, cpsr\n" : "=r" (cpsr));
+  return (cpsr & 0x9F) == 0x93;
+}
+
+/* disable interrupts, for data shared between bottom halves and interrupt
+ * handlers
+ *
+ * returns:
+ *   the previous state, to be passed to irq_restore
+ */
+static inline unsigned int
+irq_save (void)
+{
+  unsigned int cpsr, tmp;
+  asm volatile (
+    "mrs  %0, cpsr\n"
+    "orr  %1, %0, #0x80\n"
+    "msr  cpsr_c, %1\n"
+    : "=r" (cpsr), "=r" (tmp) : : "memory"
+  );
+  return cpsr;
+}
+
+/* restore the interrupt state returned by irq_save
+ */
+static inline void
+irq_restore (unsigned int cpsr)
+{
+  asm volatile ("msr  cpsr_c, %0\n" : : "r" (cpsr) : "memory");
+}
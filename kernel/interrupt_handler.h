@@ -26,4 +26,22 @@
 
 void irq_handler (void);
 
+void swi_handler (void);
+
+void undef_handler (void);
+
+void pabort_handler (void);
+
+void dabort_handler (void);
+
 void load_current_task_state (void);
+
+/* leave the boot stack for the svc stack, which is also used by the syscall
+ * handler, and run current_task. does not return.
+ */
+void start_first_task (void);
+
+/* the code of the idle task, which has no stack of its own, so it must not
+ * touch memory
+ */
+void idle_loop (void);
@@ -22,12 +22,29 @@
 
 #include "kernel/drivers/button.h"
 #include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+#include "kernel/top.h"
+#include "kernel/net/net.h"
+
+#if ENABLE_BENCHMARK
+#  include "kernel/bench/bench_checksum.h"
+#  include "kernel/bench/bench_latency.h"
+#  include "kernel/bench/bench_net.h"
+#  include "kernel/bench/bench_syscall.h"
+#endif
 
 #include <stdio.h>
 
+// the printing demo tasks share a fifth of the cpu, so they can't starve
+// the others
+#define LOG_GROUP     1
+#define LOG_BUDGET_US 20000
+#define LOG_WINDOW_US 100000
+
 static void
 task_a (void)
 {
+  task_reserve(LOG_GROUP, LOG_BUDGET_US, LOG_WINDOW_US);
   unsigned int n = 0;
 
   while (1)
@@ -41,6 +58,7 @@ task_a (void)
 static void
 task_b (void)
 {
+  task_reserve(LOG_GROUP, LOG_BUDGET_US, LOG_WINDOW_US);
   unsigned int n = 0;
 
   while (1)
@@ -54,6 +72,7 @@ task_b (void)
 static void
 task_c (void)
 {
+  task_reserve(LOG_GROUP, LOG_BUDGET_US, LOG_WINDOW_US);
   unsigned int n = 0;
 
   while (1)
@@ -67,6 +86,7 @@ task_c (void)
 static void
 task_d (void)
 {
+  task_reserve(LOG_GROUP, LOG_BUDGET_US, LOG_WINDOW_US);
   unsigned int n = 0;
 
   while (1)
@@ -92,10 +112,20 @@ kernel_main (void)
   puts("  shuriken ready");
   puts(shuriken);
 
+  net_init();
+
+#if ENABLE_BENCHMARK
+  add_task(&bench_syscall);
+  add_task(&bench_checksum);
+  add_task(&bench_net);
+  add_task(&bench_latency);
+#else
   add_task(&task_a);
   add_task(&task_b);
   add_task(&task_c);
   add_task(&task_d);
+  add_task(&top_task);
+#endif
 
   start_scheduler();
 
@@ -24,105 +24,47 @@
 #  include <config.h>
 #endif
 
+// the board specific memory layout and hardware registers
+#include "kernel/board.h"
+
 // ## Memory Layout
 
+// Fast on-chip memory
+// the .fasttext and .fastdata sections hold the interrupt and scheduler hot
+// path. they are copied to on-chip memory by the boot code, see start.S.
+// boards without on-chip memory, see FASTMEM_BASE, link them in place.
+#define __fasttext __attribute__((section(".fasttext")))
+#define __fastdata __attribute__((section(".fastdata")))
+
 // Stacks
+// the board places KERNEL_STACK_TOP and IRQ_STACK_ADDRESS
 #define STACK_SIZE 0x10000
 
-#if BOARD_VERSATILEPB
-#  define IRQ_STACK_ADDRESS 0x4000000
-#endif
-
-#if BOARD_EV3
-#  define IRQ_STACK_ADDRESS 0xC5000000
-#endif
-
-#define SVC_STACK_ADDRESS (IRQ_STACK_ADDRESS - STACK_SIZE)
-#define TASK_STACK_BASE_ADDRESS (SVC_STACK_ADDRESS - STACK_SIZE)
-
-// ## Hardware Memory Mappings
-
-#if BOARD_VERSATILEPB
-
-// Timer Adresses
-#  define TIMER1_BASE 0x101E2000
-#  define TIMER1_INTCLR_ASM 0x101E200C
-#  define TIMER1_LOAD   (volatile unsigned int*)(TIMER1_BASE+0x0)
-#  define TIMER1_VALUE  (volatile unsigned int*)(TIMER1_BASE+0x4)
-#  define TIMER1_CTRL   (volatile char*)(TIMER1_BASE+0x08)
-#  define TIMER1_INTCLR (volatile char*)(TIMER1_BASE+0x0C)
-#  define TIMER1_RIS    (volatile char*)(TIMER1_BASE+0x10)
-#  define TIMER1_MIS    (volatile char*)(TIMER1_BASE+0x14)
-
-
+#define SVC_STACK_ADDRESS (KERNEL_STACK_TOP - STACK_SIZE)
+#define ABT_STACK_ADDRESS (SVC_STACK_ADDRESS - STACK_SIZE)
+#define UND_STACK_ADDRESS (ABT_STACK_ADDRESS - STACK_SIZE)
+
+// Pages
+#define PAGE_SIZE 0x1000
+
+// physical memory handed out by the page allocator, backs the task
+// regions, is placed by the board at PAGE_POOL_BASE
+
+// Task regions
+// every task owns a 1 MiB region of virtual memory below the kernel stacks,
+// with its heap at the bottom and its stack at the top of the region. the
+// region is covered by a single first level descriptor, so it can be placed
+// in its own domain. pages are only backed by memory from the page pool once
+// they are touched.
+#define TASK_REGION_SIZE 0x100000
+#define TASK_REGION_TOP (KERNEL_STACK_TOP - TASK_REGION_SIZE)
+#define TASK_REGION_BASE(N) (TASK_REGION_TOP - ((N) + 1) * TASK_REGION_SIZE)
+#define TASK_STACK_BASE_ADDRESS(N) (TASK_REGION_BASE(N) + TASK_REGION_SIZE)
+
+// the window below the stack guard page holds packet buffers that are lent
+// to the task by the zero-copy socket calls, the heap ends below it
+#define TASK_WINDOW_PAGES 16
+#define TASK_WINDOW_OFFSET \
+  (TASK_REGION_SIZE - STACK_SIZE - PAGE_SIZE - TASK_WINDOW_PAGES * PAGE_SIZE)
+#define TASK_HEAP_LIMIT TASK_WINDOW_OFFSET
 
-// Primary Interrupt Controller (PL190)
-#  define PIC_BASE 0x10140000
-#  define PIC_INTENABLE    (volatile char*)(PIC_BASE+0x10)
-#  define PIC_SOFTINTCLEAR (volatile unsigned int*)(PIC_BASE+0x14)
-#  define PIC_SOFTINT      (volatile unsigned int*)(PIC_BASE+0x18)
-#  define PIC_DEFVECTADDR  (volatile unsigned int*)(PIC_BASE+0x34)
-#  define TIMER1_INTBIT (1 << 4)
-
-#endif
-
-#if BOARD_EV3
-
-// Timer Adresses
-#  define TIMER0_BASE 0x01C20000
-#  define TIMER0_INTCTLSTAT_ASM 0x01C20044
-#  define TIMER0_TIM12      (volatile unsigned int*)(TIMER0_BASE+0x10)
-#  define TIMER0_TIM34      (volatile unsigned int*)(TIMER0_BASE+0x14)
-#  define TIMER0_PRD12      (volatile unsigned int*)(TIMER0_BASE+0x18)
-#  define TIMER0_PRD34      (volatile unsigned int*)(TIMER0_BASE+0x1C)
-#  define TIMER0_TCR        (volatile unsigned int*)(TIMER0_BASE+0x20)
-#  define TIMER0_TGCR       (volatile unsigned int*)(TIMER0_BASE+0x24)
-#  define TIMER0_INTCTLSTAT (volatile unsigned int*)(TIMER0_BASE+0x44)
-
-// TCR bits
-#  define ENAMODE34        (0b11 << 22)
-#  define ENAMODE34_CONTIN (0b10 << 22)
-#  define ENAMODE12        (0b11 << 6)
-#  define ENAMODE12_CONTIN (0b10 << 6)
-#  define CLKSRC12 (1 << 8)
-
-// TGRC bits
-#  define PSC34             (0b1111 << 8)
-#  define PSC34_VALUE       (0b1111 << 8)
-#  define TIMMODE           (0b11 << 2)
-#  define TIMMODE_UNCHAINED (0b01 << 2)
-#  define PLUSEN         (1 << 4)
-#  define TIM34RS_REMOVE (1 << 1)
-#  define TIM12RS_REMOVE (1 << 0)
-
-// INTCTLSTAT bits
-#  define CLEARTIMER34_ASM #0x30000
-#  define PRDINTSTAT34 (1 << 17)
-#  define PRDINTEN34   (1 << 16)
-#  define PRDINTSTAT12 (1 <<  1)
-#  define PRDINTEN12   (1 <<  0)
-
-// ARM interrupt controller (AINTC)
-#  define AINTC_BASE      0xFFFEE000
-#  define AINTC_SECR1_ASM 0xFFFEE280
-#  define AINTC_GER    (volatile unsigned int*)(AINTC_BASE+0x0010)
-#  define AINTC_SECR1  (volatile unsigned int*)(AINTC_BASE+0x0280)
-#  define AINTC_SECR2  (volatile unsigned int*)(AINTC_BASE+0x0284)
-#  define AINTC_SECR3  (volatile unsigned int*)(AINTC_BASE+0x0288)
-#  define AINTC_SECR4  (volatile unsigned int*)(AINTC_BASE+0x038C)
-#  define AINTC_ESR1   (volatile unsigned int*)(AINTC_BASE+0x0300)
-#  define AINTC_ESR2   (volatile unsigned int*)(AINTC_BASE+0x0304)
-#  define AINTC_ESR3   (volatile unsigned int*)(AINTC_BASE+0x0308)
-#  define AINTC_ESR4   (volatile unsigned int*)(AINTC_BASE+0x030C)
-#  define AINTC_CMR0   (volatile unsigned int*)(AINTC_BASE+0x0400)
-#  define AINTC_CMR5   (volatile unsigned int*)(AINTC_BASE+0x0414)
-#  define AINTC_HIPIR2 (volatile unsigned int*)(AINTC_BASE+0x0904)
-#  define AINTC_HIER   (volatile unsigned int*)(AINTC_BASE+0x1500)
-
-// AINTEC bits
-#  define GER_ENABLE 1
-#  define T64P0_TINT34 (1 << 22)
-#  define T64P0_TINT34_ASM #0x400000
-#  define HIER_IRQ (1 << 1)
-
-#endif
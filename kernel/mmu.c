@@ -0,0 +1,426 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "mmu.h"
+
+#include "kernel/memory.h"
+#include "kernel/page_alloc.h"
+#include "kernel/scheduler.h"
+
+#include <string.h>
+#include <errno.h>
+
+/* ARM926EJ-S memory management
+ *
+ * kernel memory is mapped 1:1 and tasks are isolated by placing every task
+ * region in its own domain: a context switch only loads the domain access
+ * control register, the tlb and the caches stay valid. the pages of a task
+ * region are allocated from the page pool on first touch. since every task
+ * region has its own virtual addresses, the virtually indexed caches never
+ * need to be flushed on a context switch either.
+ */
+
+#define SECTION_SIZE 0x100000
+
+// first level descriptors
+#define L1_SECTION    0x12      // bit 4 must be set on the ARM926
+#define L1_COARSE     0x11
+#define L1_DOMAIN(D)  ((D) << 5)
+#define L1_AP(AP)     ((AP) << 10)
+
+// second level descriptors, small pages with all four subpages set alike
+#define L2_SMALL      0x2
+#define L2_AP(AP)     (((AP) << 4) | ((AP) << 6) | ((AP) << 8) | ((AP) << 10))
+#define L2_AP_MASK    0xFF0
+
+#define CACHED  0xC   // write-back
+#define DEVICE  0x0   // uncached, unbuffered
+
+// access permissions
+#define AP_RO        0x0   // kernel and user read only, with the R bit set
+#define AP_KERNEL    0x1   // kernel read/write, user no access
+#define AP_USER_RO   0x2   // kernel read/write, user read only
+#define AP_USER_RW   0x3   // kernel and user read/write
+
+// fault status
+#define FSR_STATUS(FSR)     ((FSR) & 0xF)
+#define FSR_PAGE_TRANSLATION 0x7
+#define FSR_PAGE_PERMISSION  0xF
+
+#define DOMAIN_KERNEL  0
+#define DOMAIN_TASK(N) ((N) + 1)
+
+#define DACR_CLIENT(D) (1 << (2 * (D)))
+
+#define CACHE_LINE 32
+
+// whether an offset into a task region lies in its packet buffer window
+#define IN_WINDOW(OFFSET) \
+  ((OFFSET) - TASK_WINDOW_OFFSET < TASK_WINDOW_PAGES * PAGE_SIZE)
+
+#if MAX_TASK_NUMBER > 15
+#  error "one domain is needed per task, at most 15 tasks are supported"
+#endif
+
+static unsigned int l1_table[4096] __attribute__((aligned(0x4000)));
+
+// the device memory of the board
+static const struct board_mapping board_mappings[] = { BOARD_MAPPINGS };
+#define BOARD_MAPPING_COUNT (sizeof(board_mappings) / sizeof(board_mappings[0]))
+
+// second level table for the board mappings that need pages
+static unsigned int l2_devices[256] __attribute__((aligned(0x400)));
+
+// second level tables for the task regions
+static unsigned int l2_tasks[MAX_TASK_NUMBER][256] __attribute__((aligned(0x400)));
+
+void
+dcache_clean_range (unsigned int addr, unsigned int size)
+{
+  unsigned int line;
+  for (line = addr & ~(CACHE_LINE - 1); line < addr + size; line += CACHE_LINE)
+    asm volatile ("mcr  p15, 0, %0, c7, c10, 1\n" : : "r" (line) : "memory");
+  asm volatile ("mcr  p15, 0, %0, c7, c10, 4\n" : : "r" (0) : "memory");  // drain write buffer
+}
+
+static void
+dcache_clean_invalidate_range (unsigned int addr, unsigned int size)
+{
+  unsigned int line;
+  for (line = addr & ~(CACHE_LINE - 1); line < addr + size; line += CACHE_LINE)
+    asm volatile ("mcr  p15, 0, %0, c7, c14, 1\n" : : "r" (line) : "memory");
+  asm volatile ("mcr  p15, 0, %0, c7, c10, 4\n" : : "r" (0) : "memory");  // drain write buffer
+}
+
+static void
+dcache_clean_all (void)
+{
+  asm volatile (
+    "1: mrc  p15, 0, APSR_nzcv, c7, c10, 3\n"  // test and clean
+    "   bne  1b\n"
+    "   mcr  p15, 0, %0, c7, c10, 4\n"   // drain write buffer
+    : : "r" (0) : "cc", "memory"
+  );
+}
+
+static void
+tlb_invalidate_page (unsigned int addr)
+{
+  asm volatile ("mcr  p15, 0, %0, c8, c7, 1\n" : : "r" (addr) : "memory");
+}
+
+static void
+tlb_invalidate_all (void)
+{
+  asm volatile ("mcr  p15, 0, %0, c8, c7, 0\n" : : "r" (0) : "memory");
+}
+
+// the table walk does not look into the data cache, so every descriptor has
+// to be written back to memory before it can be used
+static void
+set_descriptor (unsigned int *descriptor, unsigned int value)
+{
+  *descriptor = value;
+  dcache_clean_range((unsigned int) descriptor, sizeof(unsigned int));
+}
+
+static void
+map_section (unsigned int addr, unsigned int ap, unsigned int flags)
+{
+  l1_table[addr >> 20] = (addr & 0xFFF00000) | L1_SECTION | flags
+                       | L1_DOMAIN(DOMAIN_KERNEL) | L1_AP(ap);
+}
+
+static void
+map_coarse (unsigned int addr, unsigned int *l2_table, unsigned int domain)
+{
+  set_descriptor(&l1_table[addr >> 20], ((unsigned int) l2_table & 0xFFFFFC00)
+                 | L1_COARSE | L1_DOMAIN(domain));
+}
+
+static unsigned int
+small_page (unsigned int page, unsigned int ap, unsigned int flags)
+{
+  return (page & 0xFFFFF000) | L2_SMALL | flags | L2_AP(ap);
+}
+
+static void
+map_page (unsigned int *l2_table, unsigned int addr, unsigned int ap,
+          unsigned int flags)
+{
+  l2_table[(addr >> 12) & 0xFF] = small_page(addr, ap, flags);
+}
+
+static void
+map_board (const struct board_mapping *mapping)
+{
+  static const unsigned int ap[] = { AP_KERNEL, AP_USER_RO, AP_USER_RW };
+  unsigned int access = ap[mapping->flags & BOARD_MAP_ACCESS];
+  unsigned int flags = mapping->flags & BOARD_MAP_CACHED ? CACHED : DEVICE;
+
+  unsigned int addr;
+  if (!(mapping->flags & BOARD_MAP_PAGES))
+    {
+      for (addr = mapping->base; addr - mapping->base < mapping->size; addr += SECTION_SIZE)
+        map_section(addr, access, flags);
+      return;
+    }
+
+  for (addr = mapping->base; addr - mapping->base < mapping->size; addr += PAGE_SIZE)
+    map_page(l2_devices, addr, access, flags);
+  map_coarse(mapping->base, l2_devices, DOMAIN_KERNEL);
+}
+
+void
+mmu_init (void)
+{
+  unsigned int addr;
+
+  // kernel image and data, readable by the tasks. the task regions are
+  // left alone, add_task may already have installed their tables.
+  for (addr = RAM_BASE; addr - RAM_BASE < RAM_SIZE; addr += SECTION_SIZE)
+    if (addr - TASK_REGION_BASE(MAX_TASK_NUMBER - 1)
+        >= TASK_REGION_TOP - TASK_REGION_BASE(MAX_TASK_NUMBER - 1))
+      map_section(addr, AP_USER_RO, CACHED);
+
+  // the page pool is only reachable through the task regions
+  for (addr = PAGE_POOL_BASE; addr - PAGE_POOL_BASE < PAGE_POOL_SIZE; addr += SECTION_SIZE)
+    map_section(addr, AP_KERNEL, CACHED);
+
+  // irq, svc and abort stacks
+  map_section(TASK_REGION_TOP, AP_KERNEL, CACHED);
+
+  // device registers and on-chip memory
+  unsigned int i;
+  for (i = 0; i < BOARD_MAPPING_COUNT; ++i)
+    map_board(&board_mappings[i]);
+
+  asm volatile (
+    "mov  r0, #0\n"
+    "mcr  p15, 0, r0, c7, c7, 0\n"  // invalidate caches
+    "mcr  p15, 0, r0, c8, c7, 0\n"  // invalidate tlbs
+    "mcr  p15, 0, %0, c2, c0, 0\n"  // set translation table base
+    "mcr  p15, 0, %1, c3, c0, 0\n"  // set domain access control
+    "mrc  p15, 0, r0, c1, c0, 0\n"
+    "orr  r0, #0x1000\n"            // enable instruction cache
+    "orr  r0, #0x200\n"             // R bit, makes AP_RO read only for all modes
+    "orr  r0, #0x5\n"               // enable mmu and data cache
+    "mcr  p15, 0, r0, c1, c0, 0\n"
+    : : "r" (l1_table), "r" (MMU_DACR_KERNEL) : "r0", "memory"
+  );
+}
+
+unsigned int
+mmu_init_task (unsigned int slot)
+{
+  unsigned int *l2_table = l2_tasks[slot];
+
+  memset(l2_table, 0, sizeof(l2_tasks[slot]));
+  dcache_clean_range((unsigned int) l2_table, sizeof(l2_tasks[slot]));
+  map_coarse(TASK_REGION_BASE(slot), l2_table, DOMAIN_TASK(slot));
+
+  return DACR_CLIENT(DOMAIN_KERNEL) | DACR_CLIENT(DOMAIN_TASK(slot));
+}
+
+void
+mmu_release_task (unsigned int slot)
+{
+  unsigned int *l2_table = l2_tasks[slot];
+  unsigned int base = TASK_REGION_BASE(slot);
+  unsigned int i;
+
+  for (i = 0; i < 256; ++i)
+    if (l2_table[i])
+      {
+        unsigned int addr = base + i * PAGE_SIZE;
+
+        // the contents are dead, but dirty lines must not be written back
+        // once the page belongs to someone else
+        dcache_clean_invalidate_range(addr, PAGE_SIZE);
+        set_descriptor(&l2_table[i], 0);
+        tlb_invalidate_page(addr);
+        page_put(l2_table[i] & 0xFFFFF000);
+      }
+}
+
+void
+mmu_fork_task (unsigned int parent, unsigned int child)
+{
+  unsigned int *from = l2_tasks[parent];
+  unsigned int *to = l2_tasks[child];
+  unsigned int i;
+
+  // the child reads the shared pages through its own addresses, so the
+  // parent's view has to be in memory
+  dcache_clean_all();
+
+  // lent packet buffers stay with the parent
+  for (i = 0; i < 256; ++i)
+    if (from[i] && !IN_WINDOW(i * PAGE_SIZE))
+      {
+        unsigned int page = from[i] & 0xFFFFF000;
+        page_get(page);
+        from[i] = small_page(page, AP_RO, CACHED);
+        to[i] = from[i];
+      }
+
+  dcache_clean_range((unsigned int) from, sizeof(l2_tasks[parent]));
+  dcache_clean_range((unsigned int) to, sizeof(l2_tasks[child]));
+  tlb_invalidate_all();
+}
+
+int
+mmu_user_range (unsigned int addr, unsigned int size)
+{
+  if (current_task < tasks || current_task >= tasks + MAX_TASK_NUMBER)
+    return 0;
+
+  unsigned int slot = current_task - tasks;
+  unsigned int offset = addr - TASK_REGION_BASE(slot);
+  if (offset >= TASK_REGION_SIZE || size > TASK_REGION_SIZE - offset)
+    return 0;
+
+  if (offset + size <= current_task->brk)
+    return 1;
+  if (offset >= TASK_REGION_SIZE - STACK_SIZE)
+    return 1;
+
+  // window pages are checked one by one
+  if (!IN_WINDOW(offset) || !size || !IN_WINDOW(offset + size - 1))
+    return 0;
+
+  unsigned int i;
+  for (i = offset >> 12; i <= (offset + size - 1) >> 12; ++i)
+    if (!l2_tasks[slot][i])
+      return 0;
+
+  return 1;
+}
+
+void
+mmu_map_window (unsigned int addr, unsigned int page, int writable)
+{
+  unsigned int slot = current_task - tasks;
+  unsigned int *descriptor = &l2_tasks[slot][(addr >> 12) & 0xFF];
+
+  // the task sees the page through a different virtual address, anything
+  // the kernel wrote has to be in memory and must not linger in the cache
+  dcache_clean_invalidate_range(page, PAGE_SIZE);
+  page_get(page);
+  set_descriptor(descriptor, small_page(page, writable ? AP_USER_RW : AP_USER_RO, CACHED));
+  tlb_invalidate_page(addr);
+}
+
+void
+mmu_unmap_window (unsigned int addr)
+{
+  unsigned int slot = current_task - tasks;
+  unsigned int *descriptor = &l2_tasks[slot][(addr >> 12) & 0xFF];
+  unsigned int page = *descriptor & 0xFFFFF000;
+
+  dcache_clean_invalidate_range(addr, PAGE_SIZE);
+  set_descriptor(descriptor, 0);
+  tlb_invalidate_page(addr);
+  page_put(page);
+}
+
+int
+mmu_task_mapped (unsigned int addr)
+{
+  if (current_task < tasks || current_task >= tasks + MAX_TASK_NUMBER)
+    return 0;
+
+  unsigned int slot = current_task - tasks;
+  unsigned int base = TASK_REGION_BASE(slot);
+  if (addr < base || addr - base >= TASK_REGION_SIZE)
+    return 0;
+
+  return l2_tasks[slot][(addr >> 12) & 0xFF] != 0;
+}
+
+/* back a page of the current task region with a zeroed page */
+static int
+fault_in (unsigned int *descriptor, unsigned int addr)
+{
+  unsigned int page = page_alloc();
+  if (!page)
+    return -ENOMEM;
+
+  set_descriptor(descriptor, small_page(page, AP_USER_RW, CACHED));
+  tlb_invalidate_page(addr);
+  memset((void*) addr, 0, PAGE_SIZE);
+  return 0;
+}
+
+/* give the current task a private copy of a shared page */
+static int
+copy_on_write (unsigned int *descriptor, unsigned int addr)
+{
+  unsigned int shared = *descriptor & 0xFFFFF000;
+
+  if (page_refcount(shared) > 1)
+    {
+      unsigned int page = page_alloc();
+      if (!page)
+        return -ENOMEM;
+
+      // the shared page is still mapped read only, copy through the kernel
+      // mapping of the new page and write it back before it is mapped
+      memcpy((void*) page, (void*) addr, PAGE_SIZE);
+      dcache_clean_invalidate_range(page, PAGE_SIZE);
+      page_put(shared);
+      shared = page;
+    }
+
+  set_descriptor(descriptor, small_page(shared, AP_USER_RW, CACHED));
+  tlb_invalidate_page(addr);
+  return 0;
+}
+
+int
+mmu_page_fault (unsigned int addr, unsigned int fsr)
+{
+  if (current_task < tasks || current_task >= tasks + MAX_TASK_NUMBER)
+    return -EINVAL;
+
+  unsigned int slot = current_task - tasks;
+  unsigned int base = TASK_REGION_BASE(slot);
+  if (addr < base || addr - base >= TASK_REGION_SIZE)
+    return -EINVAL;
+
+  unsigned int offset = addr - base;
+  if (offset >= current_task->brk && offset < TASK_REGION_SIZE - STACK_SIZE)
+    return -EINVAL;
+
+  addr &= 0xFFFFF000;
+  unsigned int *descriptor = &l2_tasks[slot][(addr >> 12) & 0xFF];
+
+  switch (FSR_STATUS(fsr))
+    {
+    case FSR_PAGE_TRANSLATION:
+      return fault_in(descriptor, addr);
+    case FSR_PAGE_PERMISSION:
+      if ((*descriptor & L2_AP_MASK) == L2_AP(AP_RO))
+        return copy_on_write(descriptor, addr);
+      break;
+    }
+
+  return -EINVAL;
+}
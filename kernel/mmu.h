@@ -0,0 +1,107 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the domain access control value for code that only needs the kernel
+ * mappings, e.g. the idle task
+ */
+#define MMU_DACR_KERNEL 0x1
+
+/* build the first level page table for the kernel and the devices, and
+ * enable the mmu and the caches
+ *
+ * all kernel memory is mapped 1:1 in domain 0. user mode may read, but not
+ * write it, so tasks can run the code linked into the kernel image. the
+ * kernel stacks are not accessible from user mode at all.
+ */
+void mmu_init (void);
+
+/* set up the region of the given task slot, see TASK_REGION_BASE in
+ * kernel/memory.h
+ *
+ * the region is placed in a domain of its own and gets its own coarse page
+ * table. no memory is mapped yet, pages are backed on first touch.
+ *
+ * returns:
+ *   the domain access control value that has to be loaded when switching to
+ *   the task, it grants access to the kernel and to the task region only
+ */
+unsigned int mmu_init_task (unsigned int slot);
+
+/* unmap the region of the given task slot and release its pages */
+void mmu_release_task (unsigned int slot);
+
+/* share all pages of the parent region with the child region
+ *
+ * the pages are mapped read only in both regions and copied on the first
+ * write. the child region must have been set up with mmu_init_task.
+ */
+void mmu_fork_task (unsigned int parent, unsigned int child);
+
+/* resolve a data abort in the region of the current task, either by backing
+ * the page with memory or by copying a shared page
+ *
+ * params:
+ *   addr - the faulting address
+ *   fsr - the fault status
+ *
+ * returns:
+ *   0 if the faulting access can be restarted, or a negative error number
+ */
+int mmu_page_fault (unsigned int addr, unsigned int fsr);
+
+/* returns:
+ *   nonzero if the given address lies in the region of the current task and
+ *   is backed by memory, so reading it does not fault
+ */
+int mmu_task_mapped (unsigned int addr);
+
+/* check a buffer passed to a syscall by the current task
+ *
+ * returns:
+ *   nonzero if the range lies in the heap, the stack or a mapped window page
+ *   of the current task, so the kernel may access it without crashing
+ */
+int mmu_user_range (unsigned int addr, unsigned int size);
+
+/* lend a page of the page pool to the current task
+ *
+ * the page is mapped at addr, which must lie in the window of the task
+ * region, see TASK_WINDOW_OFFSET in kernel/memory.h. the mapping holds a
+ * reference to the page. the kernel must not write the page through its own
+ * mapping while it is lent.
+ *
+ * params:
+ *   addr     - the address in the window
+ *   page     - the physical address of the page
+ *   writable - nonzero to let the task write the page
+ */
+void mmu_map_window (unsigned int addr, unsigned int page, int writable);
+
+/* take back a page lent with mmu_map_window */
+void mmu_unmap_window (unsigned int addr);
+
+/* write the given range back from the data cache to memory */
+void dcache_clean_range (unsigned int addr, unsigned int size);
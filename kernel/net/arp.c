@@ -0,0 +1,302 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "arp.h"
+
+#include "kernel/scheduler.h"
+#include "kernel/net/ethernet.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define ARP_HW_ETHER 1
+#define ARP_REQUEST  1
+#define ARP_REPLY    2
+
+// the addresses are not aligned within the packet, so they are kept as
+// byte arrays and copied
+struct arp_hdr
+{
+  unsigned short hwtype;
+  unsigned short proto;
+  unsigned char hwlen;
+  unsigned char protolen;
+  unsigned short opcode;
+  unsigned char shwaddr[ETH_ALEN];
+  unsigned char sipaddr[4];
+  unsigned char dhwaddr[ETH_ALEN];
+  unsigned char dipaddr[4];
+} __attribute__((packed));
+
+enum arp_state
+{
+  ARP_FREE = 0,
+  ARP_PENDING,
+  ARP_RESOLVED
+};
+
+struct arp_entry
+{
+  unsigned int ip;
+  unsigned char mac[ETH_ALEN];
+  unsigned char state;
+  unsigned char retries;
+  unsigned int time;       // tick of the last update or request
+  struct netif *netif;
+  struct pbuf *queue;      // packets waiting for resolution, linked by link
+  unsigned int queued;
+};
+
+static const unsigned char eth_unknown[ETH_ALEN] = { 0 };
+
+static struct arp_entry table[ARP_TABLE_SIZE] = { { 0 } };
+static struct arp_stats stats = { 0 };
+
+static inline unsigned int
+arp_hash (unsigned int ip)
+{
+  ip ^= ip >> 16;
+  ip ^= ip >> 8;
+  return ip & (ARP_TABLE_SIZE - 1);
+}
+
+static struct arp_entry*
+arp_find (unsigned int ip)
+{
+  unsigned int h = arp_hash(ip);
+  unsigned int i;
+  for (i = 0; i < ARP_PROBE; ++i)
+    {
+      struct arp_entry *e = &table[(h + i) & (ARP_TABLE_SIZE - 1)];
+      if (e->state != ARP_FREE && e->ip == ip)
+        return e;
+    }
+
+  return 0;
+}
+
+static void
+arp_flush_queue (struct arp_entry *e)
+{
+  while (e->queue)
+    {
+      struct pbuf *p = e->queue;
+      e->queue = p->link;
+      p->link = 0;
+      pbuf_free(p);
+      stats.drop_queue++;
+    }
+  e->queued = 0;
+}
+
+// take a free slot within the probe window, or evict the oldest entry
+static struct arp_entry*
+arp_new (unsigned int ip)
+{
+  unsigned int h = arp_hash(ip);
+  struct arp_entry *victim = 0;
+  unsigned int i;
+  for (i = 0; i < ARP_PROBE; ++i)
+    {
+      struct arp_entry *e = &table[(h + i) & (ARP_TABLE_SIZE - 1)];
+      if (e->state == ARP_FREE)
+        {
+          victim = e;
+          break;
+        }
+      if (!victim || (int)(e->time - victim->time) < 0)
+        victim = e;
+    }
+
+  arp_flush_queue(victim);
+  victim->ip = ip;
+  victim->state = ARP_PENDING;
+  victim->retries = 0;
+  victim->time = tick_count;
+  return victim;
+}
+
+static int
+arp_send (struct netif *netif, unsigned short opcode, const unsigned char *dhw,
+          unsigned int dip)
+{
+  struct pbuf *p = pbuf_alloc_small(PBUF_IP_HEADROOM, sizeof(struct arp_hdr));
+  if (!p)
+    return -ENOMEM;
+
+  struct arp_hdr *arp = (struct arp_hdr*)p->payload;
+  arp->hwtype = htons(ARP_HW_ETHER);
+  arp->proto = htons(ETHTYPE_IP);
+  arp->hwlen = ETH_ALEN;
+  arp->protolen = 4;
+  arp->opcode = htons(opcode);
+  memcpy(arp->shwaddr, netif->mac, ETH_ALEN);
+  memcpy(arp->sipaddr, &netif->ip, 4);
+  memcpy(arp->dhwaddr, opcode == ARP_REQUEST ? eth_unknown : dhw, ETH_ALEN);
+  memcpy(arp->dipaddr, &dip, 4);
+
+  if (opcode == ARP_REQUEST)
+    stats.tx_requests++;
+  else
+    stats.tx_replies++;
+
+  return ethernet_output(netif, p, dhw, ETHTYPE_ARP);
+}
+
+static void
+arp_update (struct arp_entry *e, const unsigned char *mac)
+{
+  memcpy(e->mac, mac, ETH_ALEN);
+  e->state = ARP_RESOLVED;
+  e->time = tick_count;
+
+  // the entry is complete before the queue is sent, so packets that are
+  // generated while sending go out directly
+  struct pbuf *queue = e->queue;
+  e->queue = 0;
+  e->queued = 0;
+  while (queue)
+    {
+      struct pbuf *p = queue;
+      queue = p->link;
+      p->link = 0;
+      ethernet_output(e->netif, p, e->mac, ETHTYPE_IP);
+    }
+}
+
+void
+arp_input (struct netif *netif, struct pbuf *p)
+{
+  stats.rx++;
+
+  struct arp_hdr *arp = (struct arp_hdr*)p->payload;
+  if (p->len < sizeof(struct arp_hdr) || arp->hwtype != htons(ARP_HW_ETHER)
+      || arp->proto != htons(ETHTYPE_IP) || arp->hwlen != ETH_ALEN
+      || arp->protolen != 4)
+    {
+      stats.drop++;
+      pbuf_free(p);
+      return;
+    }
+
+  unsigned int sip, dip;
+  memcpy(&sip, arp->sipaddr, 4);
+  memcpy(&dip, arp->dipaddr, 4);
+  int for_us = netif->ip && dip == netif->ip;
+
+  // refresh known senders, and learn senders that talk to us since we are
+  // likely to answer them
+  struct arp_entry *e = arp_find(sip);
+  if (!e && for_us && sip)
+    {
+      e = arp_new(sip);
+      e->netif = netif;
+    }
+  if (e)
+    arp_update(e, arp->shwaddr);
+
+  unsigned short opcode = ntohs(arp->opcode);
+  if (opcode == ARP_REQUEST)
+    {
+      stats.rx_requests++;
+      if (for_us)
+        arp_send(netif, ARP_REPLY, arp->shwaddr, sip);
+    }
+  else if (opcode == ARP_REPLY)
+    stats.rx_replies++;
+
+  pbuf_free(p);
+}
+
+int
+arp_output (struct netif *netif, struct pbuf *p, unsigned int nexthop)
+{
+  if (nexthop == IP4_BROADCAST || nexthop == (netif->ip | ~netif->netmask))
+    return ethernet_output(netif, p, eth_broadcast, ETHTYPE_IP);
+
+  struct arp_entry *e = arp_find(nexthop);
+  if (e && e->state == ARP_RESOLVED)
+    {
+      stats.hits++;
+      return ethernet_output(netif, p, e->mac, ETHTYPE_IP);
+    }
+
+  stats.misses++;
+  if (!e)
+    {
+      e = arp_new(nexthop);
+      e->netif = netif;
+      arp_send(netif, ARP_REQUEST, eth_broadcast, nexthop);
+    }
+
+  if (e->queued == ARP_QUEUE_MAX)
+    {
+      stats.drop_queue++;
+      pbuf_free(p);
+      return -ENOMEM;
+    }
+
+  struct pbuf **tail = &e->queue;
+  while (*tail)
+    tail = &(*tail)->link;
+  p->link = 0;
+  *tail = p;
+  e->queued++;
+  stats.queued++;
+  return 0;
+}
+
+void
+arp_timer (void)
+{
+  unsigned int i;
+  for (i = 0; i < ARP_TABLE_SIZE; ++i)
+    {
+      struct arp_entry *e = &table[i];
+      unsigned int age = tick_count - e->time;
+
+      if (e->state == ARP_RESOLVED && age >= MS_TO_TICKS(ARP_MAX_AGE_MS))
+        {
+          e->state = ARP_FREE;
+          stats.expired++;
+        }
+      else if (e->state == ARP_PENDING && age >= MS_TO_TICKS(ARP_RETRY_MS))
+        {
+          if (e->retries++ == ARP_MAX_RETRIES)
+            {
+              arp_flush_queue(e);
+              e->state = ARP_FREE;
+              stats.expired++;
+              continue;
+            }
+          e->time = tick_count;
+          arp_send(e->netif, ARP_REQUEST, eth_broadcast, e->ip);
+        }
+    }
+}
+
+const struct arp_stats*
+arp_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,73 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct pbuf;
+struct netif;
+
+#define ARP_TABLE_SIZE  32    // power of two
+#define ARP_PROBE       4     // slots searched from the hash position
+#define ARP_QUEUE_MAX   4     // packets held per unresolved entry
+#define ARP_MAX_AGE_MS  120000
+#define ARP_RETRY_MS    1000
+#define ARP_MAX_RETRIES 3
+
+struct arp_stats
+{
+  unsigned int rx;
+  unsigned int rx_requests;
+  unsigned int rx_replies;
+  unsigned int tx_requests;
+  unsigned int tx_replies;
+  unsigned int drop;
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int queued;
+  unsigned int drop_queue;
+  unsigned int expired;
+};
+
+/* handle a received arp packet, takes over the reference to p
+ */
+void arp_input (struct netif *netif, struct pbuf *p);
+
+/* the output function of ethernet interfaces
+ *
+ * resolves the hardware address of the next hop and sends the ip packet p.
+ * while a resolution is in progress, packets are queued on the cache entry
+ * and sent as soon as the reply arrives.
+ *
+ * returns:
+ *   0 if the packet was sent or queued, a negative error code otherwise
+ */
+int arp_output (struct netif *netif, struct pbuf *p, unsigned int nexthop);
+
+/* age the cache and retry pending requests, called every NET_TIMER_MS
+ */
+void arp_timer (void);
+
+/* returns the arp counters
+ */
+const struct arp_stats* arp_stats (void);
@@ -0,0 +1,82 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "checksum.h"
+
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+unsigned short
+chksum_fold (unsigned int sum)
+{
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  return ~sum & 0xFFFF;
+}
+
+unsigned short
+inet_chksum (const void *data, unsigned int length)
+{
+  return chksum_fold(chksum_add(0, data, length));
+}
+
+unsigned int
+chksum_pseudo (unsigned int src, unsigned int dst, unsigned char proto,
+               unsigned short length)
+{
+  // the zero byte and the protocol form the third word
+  return (src & 0xFFFF) + (src >> 16) + (dst & 0xFFFF) + (dst >> 16)
+       + (proto << 8) + htons(length);
+}
+
+unsigned int
+chksum_add_pbuf (unsigned int sum, const struct pbuf *p)
+{
+  int odd = 0;
+  for (; p; p = p->next)
+    {
+      sum += chksum_shift(chksum_add(0, p->payload, p->len), odd);
+      odd ^= p->len & 1;
+    }
+
+  return sum;
+}
+
+unsigned int
+chksum_take_pbuf (struct pbuf *p, const void *src, unsigned int length,
+                  unsigned int sum)
+{
+  const unsigned char *in = src;
+  int odd = 0;
+
+  for (; p && length; p = p->next)
+    {
+      unsigned int n = p->len;
+      if (n > length)
+        n = length;
+
+      sum += chksum_shift(chksum_copy(p->payload, in, n, 0), odd);
+      odd ^= n & 1;
+      in += n;
+      length -= n;
+    }
+
+  return sum;
+}
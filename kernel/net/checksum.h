@@ -0,0 +1,103 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct pbuf;
+
+/* the internet checksum is the ones complement of the ones complement sum
+ * of all 16 bit words. the sum does not depend on the byte order, so the
+ * words are summed as they are laid out in memory and the result can be
+ * stored into a header field without conversion.
+ */
+
+/* add data to a partial checksum, implemented in checksum_arm.S
+ *
+ * params:
+ *   sum    - the partial sum of the preceding data, starts at 0
+ *   data   - the data, must start at an even offset into the checksummed
+ *            region but may have any alignment in memory
+ *   length - the number of bytes
+ *
+ * returns:
+ *   the partial sum folded to 16 bits, so partial sums can be added up
+ */
+unsigned int chksum_add (unsigned int sum, const void *data, unsigned int length);
+
+/* copy data and add it to a partial checksum in a single pass, implemented
+ * in checksum_arm.S. the copy is fused if dst and src have the same
+ * alignment within a word.
+ *
+ * returns:
+ *   the partial sum of the copied data folded to 16 bits
+ */
+unsigned int chksum_copy (void *dst, const void *src, unsigned int length,
+                          unsigned int sum);
+
+/* adjust the folded partial sum of data that starts at an odd offset into
+ * the checksummed region, its bytes contribute in swapped word positions
+ */
+static inline unsigned int
+chksum_shift (unsigned int part, int odd)
+{
+  return odd ? ((part & 0xFF) << 8) | (part >> 8) : part;
+}
+
+/* fold a partial sum into the final checksum
+ */
+unsigned short chksum_fold (unsigned int sum);
+
+/* returns:
+ *   the checksum of a contiguous block, 0 if the block carries a valid
+ *   checksum
+ */
+unsigned short inet_chksum (const void *data, unsigned int length);
+
+/* returns:
+ *   the partial sum of the ip pseudo header used by udp and tcp, addresses
+ *   in network byte order and length in host byte order
+ */
+unsigned int chksum_pseudo (unsigned int src, unsigned int dst,
+                            unsigned char proto, unsigned short length);
+
+/* add all buffers of a packet to a partial checksum
+ *
+ * returns:
+ *   the partial sum
+ */
+unsigned int chksum_add_pbuf (unsigned int sum, const struct pbuf *p);
+
+/* copy data into a packet like pbuf_take and add it to a partial checksum
+ *
+ * params:
+ *   p      - the packet
+ *   src    - the data
+ *   length - the number of bytes, at most p->tot_len
+ *   sum    - the partial sum of the data in front of the packet payload
+ *
+ * returns:
+ *   the partial sum
+ */
+unsigned int chksum_take_pbuf (struct pbuf *p, const void *src,
+                               unsigned int length, unsigned int sum);
@@ -0,0 +1,419 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "dhcp.h"
+
+#include "kernel/scheduler.h"
+#include "kernel/timeout.h"
+#include "kernel/drivers/timer.h"
+#include "kernel/net/dns.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+#include "kernel/net/udp.h"
+
+#include <string.h>
+
+#define BOOTREQUEST    1
+#define BOOTREPLY      2
+#define HTYPE_ETHER    1
+#define FLAG_BROADCAST 0x8000
+#define MAGIC_COOKIE   0x63825363
+
+#define DHCPDISCOVER 1
+#define DHCPOFFER    2
+#define DHCPREQUEST  3
+#define DHCPACK      5
+#define DHCPNAK      6
+
+#define OPT_PAD          0
+#define OPT_NETMASK      1
+#define OPT_ROUTER       3
+#define OPT_DNS          6
+#define OPT_REQUESTED_IP 50
+#define OPT_LEASE_TIME   51
+#define OPT_MSG_TYPE     53
+#define OPT_SERVER_ID    54
+#define OPT_PARAM_LIST   55
+#define OPT_T1           58
+#define OPT_T2           59
+#define OPT_END          255
+
+// the fixed part of a message, followed by the options
+struct dhcp_msg
+{
+  unsigned char op;
+  unsigned char htype;
+  unsigned char hlen;
+  unsigned char hops;
+  unsigned int xid;
+  unsigned short secs;
+  unsigned short flags;
+  unsigned int ciaddr;
+  unsigned int yiaddr;
+  unsigned int siaddr;
+  unsigned int giaddr;
+  unsigned char chaddr[16];
+  unsigned char sname[64];
+  unsigned char file[128];
+  unsigned int cookie;
+  unsigned char options[];
+};
+
+// sent messages are padded to the minimum length of bootp messages
+#define DHCP_MSG_LEN 300
+
+// the options of a reply the client cares about, in network byte order
+// except for the times, which are in seconds
+struct dhcp_reply
+{
+  unsigned char type;
+  unsigned int server;
+  unsigned int netmask;
+  unsigned int router;
+  unsigned int dns;
+  unsigned int lease;
+  unsigned int t1;
+  unsigned int t2;
+};
+
+struct dhcp_client
+{
+  struct netif *netif;
+  struct udp_pcb *pcb;
+  struct timeout timer;
+  unsigned int xid;
+  unsigned int tries;
+  unsigned int offered;   // the address of the offer or lease
+  unsigned int bound;     // tick the lease was acknowledged
+  unsigned int t1;        // renewal, rebinding and expiry in ticks since bound
+  unsigned int t2;
+  unsigned int lease;
+};
+
+static struct dhcp_client client = { 0 };
+static struct dhcp_stats stats = { 0 };
+
+static void dhcp_discover (void);
+
+// rounded down, so lease timers fire early rather than late
+static unsigned int
+secs_to_ticks (unsigned int secs)
+{
+  if (secs > DHCP_LEASE_MAX)
+    secs = DHCP_LEASE_MAX;
+  return secs * (1000000 / TICK_US);
+}
+
+static unsigned int
+retry_ticks (unsigned int tries)
+{
+  unsigned int ms = DHCP_RETRY_MS << tries;
+  return MS_TO_TICKS(ms < DHCP_RETRY_MAX_MS ? ms : DHCP_RETRY_MAX_MS);
+}
+
+static unsigned char*
+put_option (unsigned char *opt, unsigned char code, const void *data,
+            unsigned char len)
+{
+  *opt++ = code;
+  *opt++ = len;
+  memcpy(opt, data, len);
+  return opt + len;
+}
+
+static void
+dhcp_send (unsigned char type)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_APP_HEADROOM, DHCP_MSG_LEN);
+  if (!p)
+    return;
+
+  struct dhcp_msg *msg = (struct dhcp_msg*)p->payload;
+  memset(msg, 0, DHCP_MSG_LEN);
+  msg->op = BOOTREQUEST;
+  msg->htype = HTYPE_ETHER;
+  msg->hlen = ETH_ALEN;
+  msg->xid = client.xid;
+  memcpy(msg->chaddr, client.netif->mac, ETH_ALEN);
+  msg->cookie = htonl(MAGIC_COOKIE);
+
+  // replies are broadcast as long as we can't take unicasts
+  int renewing = stats.state == DHCP_RENEWING
+              || stats.state == DHCP_REBINDING;
+  if (renewing)
+    msg->ciaddr = client.netif->ip;
+  else
+    msg->flags = htons(FLAG_BROADCAST);
+
+  static const unsigned char params[] =
+    { OPT_NETMASK, OPT_ROUTER, OPT_DNS, OPT_LEASE_TIME, OPT_T1, OPT_T2 };
+  unsigned char *opt = put_option(msg->options, OPT_MSG_TYPE, &type, 1);
+  if (stats.state == DHCP_REQUESTING)
+    {
+      opt = put_option(opt, OPT_REQUESTED_IP, &client.offered, 4);
+      opt = put_option(opt, OPT_SERVER_ID, &stats.server, 4);
+    }
+  opt = put_option(opt, OPT_PARAM_LIST, params, sizeof(params));
+  *opt = OPT_END;
+
+  // a renewal goes to the server of the lease along the routes
+  unsigned int dst = IP4_BROADCAST;
+  client.pcb->netif = client.netif;
+  if (stats.state == DHCP_RENEWING)
+    {
+      dst = stats.server;
+      client.pcb->netif = 0;
+    }
+
+  if (type == DHCPDISCOVER)
+    stats.discovers++;
+  else
+    stats.requests++;
+
+  udp_sendto(client.pcb, p, dst, htons(DHCP_SERVER_PORT));
+}
+
+static inline unsigned int
+get_u32 (const unsigned char *data)
+{
+  unsigned int value;
+  memcpy(&value, data, 4);
+  return value;
+}
+
+// returns 0 if the options are malformed
+static int
+parse_options (const unsigned char *opt, unsigned int len,
+               struct dhcp_reply *reply)
+{
+  unsigned int i = 0;
+  while (i < len && opt[i] != OPT_END)
+    {
+      unsigned char code = opt[i++];
+      if (code == OPT_PAD)
+        continue;
+      if (i >= len || i + 1 + opt[i] > len)
+        return 0;
+
+      unsigned int n = opt[i++];
+      const unsigned char *data = opt + i;
+      i += n;
+
+      if (code == OPT_MSG_TYPE && n == 1)
+        reply->type = data[0];
+      else if (n < 4)
+        continue;
+
+      // lists of addresses start with the preferred one
+      switch (code)
+        {
+        case OPT_NETMASK:    reply->netmask = get_u32(data); break;
+        case OPT_ROUTER:     reply->router = get_u32(data); break;
+        case OPT_DNS:        reply->dns = get_u32(data); break;
+        case OPT_SERVER_ID:  reply->server = get_u32(data); break;
+        case OPT_LEASE_TIME: reply->lease = ntohl(get_u32(data)); break;
+        case OPT_T1:         reply->t1 = ntohl(get_u32(data)); break;
+        case OPT_T2:         reply->t2 = ntohl(get_u32(data)); break;
+        }
+    }
+
+  return 1;
+}
+
+static void
+dhcp_bind (const struct dhcp_msg *msg, const struct dhcp_reply *reply)
+{
+  unsigned int lease = reply->lease ? reply->lease : DHCP_LEASE_MAX;
+  if (lease > DHCP_LEASE_MAX)
+    lease = DHCP_LEASE_MAX;
+  unsigned int t2 = reply->t2 && reply->t2 < lease ? reply->t2 : lease / 8 * 7;
+  unsigned int t1 = reply->t1 && reply->t1 < t2 ? reply->t1 : lease / 2;
+
+  stats.acks++;
+  if (stats.state != DHCP_REQUESTING && msg->yiaddr == client.netif->ip)
+    stats.renewals++;
+  else
+    netif_configure(client.netif, msg->yiaddr,
+                    reply->netmask ? reply->netmask : NET_DEFAULT_NETMASK,
+                    reply->router);
+
+  if (reply->dns)
+    dns_set_server(reply->dns);
+
+  client.offered = msg->yiaddr;
+  client.bound = tick_count;
+  client.t1 = secs_to_ticks(t1);
+  client.t2 = secs_to_ticks(t2);
+  client.lease = secs_to_ticks(lease);
+  if (reply->server)
+    stats.server = reply->server;
+  stats.lease = lease;
+  stats.state = DHCP_BOUND;
+
+  timeout_add(&client.timer, client.t1 ? client.t1 : 1);
+}
+
+static void
+dhcp_recv (struct udp_pcb *pcb, struct pbuf *p)
+{
+  const struct dhcp_msg *msg = (const struct dhcp_msg*)p->payload;
+  struct dhcp_reply reply = { 0 };
+
+  if (p->len < sizeof(struct dhcp_msg) || msg->op != BOOTREPLY
+      || msg->xid != client.xid || msg->cookie != htonl(MAGIC_COOKIE)
+      || memcmp(msg->chaddr, client.netif->mac, ETH_ALEN)
+      || !parse_options(msg->options, p->len - sizeof(struct dhcp_msg), &reply))
+    {
+      stats.drop++;
+      pbuf_free(p);
+      return;
+    }
+
+  int waiting = stats.state == DHCP_REQUESTING
+             || stats.state == DHCP_RENEWING
+             || stats.state == DHCP_REBINDING;
+
+  if (reply.type == DHCPOFFER && stats.state == DHCP_SELECTING)
+    {
+      // take the first offer
+      stats.offers++;
+      stats.server = reply.server ? reply.server : p->addr;
+      client.offered = msg->yiaddr;
+      client.tries = 0;
+      stats.state = DHCP_REQUESTING;
+      dhcp_send(DHCPREQUEST);
+      timeout_add(&client.timer, retry_ticks(0));
+    }
+  else if (reply.type == DHCPACK && waiting)
+    dhcp_bind(msg, &reply);
+  else if (reply.type == DHCPNAK && waiting)
+    {
+      stats.naks++;
+      netif_configure(client.netif, IP4_ANY, IP4_ANY, IP4_ANY);
+      dhcp_discover();
+    }
+  else
+    stats.drop++;
+
+  pbuf_free(p);
+}
+
+static void
+dhcp_discover (void)
+{
+  client.xid = timer_counter_read() ^ tick_count
+             ^ get_u32(client.netif->mac + ETH_ALEN - 4);
+  client.tries = 0;
+  stats.state = DHCP_SELECTING;
+  dhcp_send(DHCPDISCOVER);
+  timeout_add(&client.timer, retry_ticks(0));
+}
+
+// retransmit at half the time to the deadline, but not too often
+static void
+dhcp_retransmit (unsigned int deadline)
+{
+  unsigned int left = deadline - (tick_count - client.bound);
+  unsigned int wait = left / 2;
+  if (wait < MS_TO_TICKS(DHCP_RENEW_MIN_MS))
+    wait = MS_TO_TICKS(DHCP_RENEW_MIN_MS);
+  if (wait > left)
+    wait = left;
+
+  dhcp_send(DHCPREQUEST);
+  timeout_add(&client.timer, wait ? wait : 1);
+}
+
+static void
+dhcp_timeout (void *arg)
+{
+  unsigned int elapsed = tick_count - client.bound;
+
+  switch (stats.state)
+    {
+    case DHCP_SELECTING:
+      if (++client.tries == DHCP_TRIES)
+        {
+          netif_configure(client.netif, NET_DEFAULT_IP, NET_DEFAULT_NETMASK,
+                          NET_DEFAULT_GATEWAY);
+          dns_set_server(NET_DEFAULT_DNS);
+          stats.state = DHCP_STATIC;
+          return;
+        }
+      dhcp_send(DHCPDISCOVER);
+      timeout_add(&client.timer, retry_ticks(client.tries));
+      return;
+
+    case DHCP_REQUESTING:
+      if (++client.tries == DHCP_TRIES)
+        {
+          dhcp_discover();
+          return;
+        }
+      dhcp_send(DHCPREQUEST);
+      timeout_add(&client.timer, retry_ticks(client.tries));
+      return;
+
+    case DHCP_BOUND:
+    case DHCP_RENEWING:
+      if (elapsed < client.t2)
+        {
+          stats.state = DHCP_RENEWING;
+          dhcp_retransmit(client.t2);
+          return;
+        }
+      // the server of the lease is gone, ask any server
+      stats.state = DHCP_REBINDING;
+      // fall through
+
+    case DHCP_REBINDING:
+      if (elapsed < client.lease)
+        {
+          dhcp_retransmit(client.lease);
+          return;
+        }
+      stats.expired++;
+      netif_configure(client.netif, IP4_ANY, IP4_ANY, IP4_ANY);
+      dhcp_discover();
+      return;
+
+    default:
+      return;
+    }
+}
+
+void
+dhcp_start (struct netif *netif)
+{
+  client.pcb = udp_new();
+  if (!client.pcb || udp_bind(client.pcb, IP4_ANY, htons(DHCP_CLIENT_PORT)) < 0)
+    return;
+
+  client.pcb->recv = &dhcp_recv;
+  client.netif = netif;
+  timeout_set(&client.timer, &dhcp_timeout, 0);
+  dhcp_discover();
+}
+
+const struct dhcp_stats*
+dhcp_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,83 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct netif;
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+
+#define DHCP_RETRY_MS      2000    // first retransmission, doubled per try
+#define DHCP_RETRY_MAX_MS  16000
+#define DHCP_TRIES         4       // before giving up on a server
+#define DHCP_RENEW_MIN_MS  60000   // shortest retransmission while renewing
+#define DHCP_LEASE_MAX     2592000 // seconds, longer leases are shortened
+
+/* the client states of RFC 2131, without INIT-REBOOT
+ *
+ * DHCP_STATIC means that no server answered, the interface then uses the
+ * default address plan of kernel/net/net.h
+ */
+enum dhcp_state
+{
+  DHCP_OFF = 0,
+  DHCP_SELECTING,
+  DHCP_REQUESTING,
+  DHCP_BOUND,
+  DHCP_RENEWING,
+  DHCP_REBINDING,
+  DHCP_STATIC
+};
+
+struct dhcp_stats
+{
+  enum dhcp_state state;
+  unsigned int server;         // the server of the current lease
+  unsigned int lease;          // lease time in seconds
+  unsigned int discovers;
+  unsigned int offers;
+  unsigned int requests;
+  unsigned int acks;
+  unsigned int naks;
+  unsigned int renewals;       // leases extended by the server
+  unsigned int expired;        // leases that ran out
+  unsigned int drop;           // replies that were not for us
+};
+
+/* configure an interface by dhcp
+ *
+ * the client runs inside the kernel, driven by received replies and by
+ * timeouts, see kernel/timeout.h. the interface is configured as soon as
+ * the server acknowledges a lease, and the lease is renewed at half its
+ * time. the dns server offered with the lease is passed to the resolver.
+ *
+ * if no server answers after DHCP_TRIES discovers, the interface falls back
+ * to the default address plan. only one interface is supported.
+ */
+void dhcp_start (struct netif *netif);
+
+/* returns the state and counters of the client
+ */
+const struct dhcp_stats* dhcp_stats (void);
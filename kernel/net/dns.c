@@ -0,0 +1,448 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "dns.h"
+
+#include "kernel/mmu.h"
+#include "kernel/scheduler.h"
+#include "kernel/timeout.h"
+#include "kernel/drivers/timer.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+#include "kernel/net/udp.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define DNS_HLEN     12
+#define DNS_FLAG_QR  0x8000
+#define DNS_FLAG_RD  0x0100
+#define DNS_RCODE    0x000F
+#define DNS_NXDOMAIN 3
+#define DNS_TYPE_A   1
+#define DNS_CLASS_IN 1
+
+struct dns_hdr
+{
+  unsigned short id;
+  unsigned short flags;
+  unsigned short qdcount;
+  unsigned short ancount;
+  unsigned short nscount;
+  unsigned short arcount;
+};
+
+enum dns_entry_state
+{
+  DNS_FREE = 0,
+  DNS_PENDING,
+  DNS_RESOLVED,
+  DNS_FAILED
+};
+
+struct dns_entry
+{
+  char name[DNS_NAME_MAX];     // lower case, without a trailing dot
+  unsigned int len;
+  enum dns_entry_state state;
+  unsigned int addr;
+  int error;                   // of failed lookups
+  unsigned int expires;        // tick the answer becomes stale
+  unsigned int used;           // tick of the last lookup, for eviction
+  unsigned short id;
+  unsigned short tries;
+  struct timeout timer;
+  wait_queue_t waiters;
+};
+
+static struct dns_entry cache[DNS_CACHE_SIZE];
+static struct udp_pcb *dns_pcb = 0;
+static unsigned int server = 0;
+static unsigned short next_id = 0;
+static struct dns_stats stats = { 0 };
+
+static void dns_retry (void *arg);
+
+static void
+__attribute((constructor))
+dns_init (void)
+{
+  unsigned int i;
+  for (i = 0; i < DNS_CACHE_SIZE; ++i)
+    timeout_set(&cache[i].timer, &dns_retry, &cache[i]);
+}
+
+// rounded down, the cache errs on the side of asking again
+static unsigned int
+secs_to_ticks (unsigned int secs)
+{
+  return secs * (1000000 / TICK_US);
+}
+
+static inline int
+expired (const struct dns_entry *e)
+{
+  return (int)(tick_count - e->expires) >= 0;
+}
+
+// copy a name in lower case and check that its labels are well-formed
+static int
+normalize (char *dst, const char *src, unsigned int len)
+{
+  if (len && src[len - 1] == '.')
+    --len;
+  if (!len || len >= DNS_NAME_MAX)
+    return -EINVAL;
+
+  unsigned int i, label = 0;
+  for (i = 0; i < len; ++i)
+    {
+      char c = src[i];
+      if (c == '.')
+        {
+          if (!label)
+            return -EINVAL;
+          label = 0;
+        }
+      else if (++label > 63 || c == 0)
+        return -EINVAL;
+      dst[i] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+  if (!label)
+    return -EINVAL;
+
+  dst[len] = 0;
+  return len;
+}
+
+// names that are addresses in dotted decimal notation need no lookup
+static int
+parse_address (const char *name, unsigned int *addr)
+{
+  unsigned int octets = 0, value = 0, digits = 0, result = 0;
+  for (;; ++name)
+    {
+      if (*name >= '0' && *name <= '9')
+        {
+          value = value * 10 + *name - '0';
+          if (++digits > 3 || value > 255)
+            return 0;
+        }
+      else if ((*name == '.' || !*name) && digits)
+        {
+          result = result << 8 | value;
+          ++octets;
+          value = digits = 0;
+          if (!*name)
+            break;
+        }
+      else
+        return 0;
+    }
+
+  if (octets != 4)
+    return 0;
+  *addr = htonl(result);
+  return 1;
+}
+
+static struct dns_entry*
+dns_find (const char *name, unsigned int len)
+{
+  unsigned int i;
+  for (i = 0; i < DNS_CACHE_SIZE; ++i)
+    if (cache[i].state != DNS_FREE && cache[i].len == len
+        && !memcmp(cache[i].name, name, len))
+      return &cache[i];
+
+  return 0;
+}
+
+// take a free or stale entry, or evict the least recently used answer
+static struct dns_entry*
+dns_new (void)
+{
+  struct dns_entry *victim = 0;
+  unsigned int i;
+  for (i = 0; i < DNS_CACHE_SIZE; ++i)
+    {
+      struct dns_entry *e = &cache[i];
+      if (e->state == DNS_FREE || (e->state != DNS_PENDING && expired(e)))
+        return e;
+      if (e->state != DNS_PENDING
+          && (!victim || (int)(e->used - victim->used) < 0))
+        victim = e;
+    }
+
+  return victim;
+}
+
+static void
+dns_send (struct dns_entry *e)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_APP_HEADROOM, DNS_HLEN + e->len + 2 + 4);
+  if (!p)
+    return;
+
+  struct dns_hdr *hdr = (struct dns_hdr*)p->payload;
+  hdr->id = e->id;
+  hdr->flags = htons(DNS_FLAG_RD);
+  hdr->qdcount = htons(1);
+  hdr->ancount = hdr->nscount = hdr->arcount = 0;
+
+  // the dots become the lengths of the labels that follow them
+  unsigned char *q = p->payload + DNS_HLEN;
+  unsigned char *label = q;
+  unsigned int i;
+  for (i = 0; i < e->len; ++i)
+    if (e->name[i] == '.')
+      {
+        *label = q + i - label;
+        label = q + i + 1;
+      }
+    else
+      q[i + 1] = e->name[i];
+  *label = q + i - label;
+  q[i + 1] = 0;
+
+  q += e->len + 2;
+  q[0] = 0;
+  q[1] = DNS_TYPE_A;
+  q[2] = 0;
+  q[3] = DNS_CLASS_IN;
+
+  stats.queries++;
+  udp_sendto(dns_pcb, p, server, htons(DNS_SERVER_PORT));
+}
+
+static void
+dns_finish (struct dns_entry *e, int error, unsigned int addr,
+            unsigned int ttl)
+{
+  timeout_del(&e->timer);
+  e->state = error ? DNS_FAILED : DNS_RESOLVED;
+  e->error = error;
+  e->addr = addr;
+  e->expires = tick_count + secs_to_ticks(ttl);
+  wake_up(&e->waiters);
+}
+
+static void
+dns_retry (void *arg)
+{
+  struct dns_entry *e = arg;
+  if (++e->tries == DNS_TRIES)
+    {
+      stats.timeouts++;
+      dns_finish(e, -ETIMEDOUT, 0, DNS_NEGATIVE_TTL);
+      return;
+    }
+
+  dns_send(e);
+  timeout_add(&e->timer, MS_TO_TICKS(DNS_RETRY_MS));
+}
+
+// returns the offset behind the name at off, or 0 if it is malformed
+static unsigned int
+skip_name (const unsigned char *data, unsigned int len, unsigned int off)
+{
+  while (off < len)
+    {
+      unsigned char c = data[off];
+      if ((c & 0xC0) == 0xC0)
+        return off + 2 <= len ? off + 2 : 0;
+      if (!c)
+        return off + 1;
+      off += c + 1;
+    }
+
+  return 0;
+}
+
+// compare the uncompressed name of the question with the name of an entry
+static int
+match_name (const unsigned char *data, unsigned int len, unsigned int off,
+            const struct dns_entry *e)
+{
+  unsigned int i = 0;
+  while (off < len && data[off])
+    {
+      unsigned int n = data[off++];
+      if (n > 63 || off + n > len)
+        return 0;
+      if (i && (i >= e->len || e->name[i++] != '.'))
+        return 0;
+      if (i + n > e->len)
+        return 0;
+
+      for (; n; --n, ++i, ++off)
+        {
+          char c = data[off];
+          if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+          if (c != e->name[i])
+            return 0;
+        }
+    }
+
+  return off < len && i == e->len;
+}
+
+static void
+dns_recv (struct udp_pcb *pcb, struct pbuf *p)
+{
+  const unsigned char *data = p->payload;
+  const struct dns_hdr *hdr = (const struct dns_hdr*)data;
+  unsigned int len = p->len;
+
+  struct dns_entry *e = 0;
+  unsigned int i;
+  if (len >= DNS_HLEN && p->addr == server
+      && p->port == htons(DNS_SERVER_PORT)
+      && (ntohs(hdr->flags) & DNS_FLAG_QR) && hdr->qdcount == htons(1))
+    for (i = 0; i < DNS_CACHE_SIZE; ++i)
+      if (cache[i].state == DNS_PENDING && cache[i].id == hdr->id
+          && match_name(data, len, DNS_HLEN, &cache[i]))
+        e = &cache[i];
+
+  unsigned int off;
+  if (!e || !(off = skip_name(data, len, DNS_HLEN)) || off + 4 > len)
+    {
+      stats.drop++;
+      pbuf_free(p);
+      return;
+    }
+  off += 4;
+
+  if ((ntohs(hdr->flags) & DNS_RCODE) == DNS_NXDOMAIN)
+    {
+      stats.nxdomain++;
+      dns_finish(e, -ENOENT, 0, DNS_NEGATIVE_TTL);
+      pbuf_free(p);
+      return;
+    }
+
+  // the first address in the answer section, any cnames lead up to it
+  unsigned int count = ntohs(hdr->ancount);
+  while (count-- && (off = skip_name(data, len, off)) && off + 10 <= len)
+    {
+      unsigned int type = data[off] << 8 | data[off + 1];
+      unsigned int class = data[off + 2] << 8 | data[off + 3];
+      unsigned int ttl = (unsigned int) data[off + 4] << 24
+                       | data[off + 5] << 16 | data[off + 6] << 8 | data[off + 7];
+      unsigned int rdlen = data[off + 8] << 8 | data[off + 9];
+      off += 10;
+      if (off + rdlen > len)
+        break;
+
+      if (type == DNS_TYPE_A && class == DNS_CLASS_IN && rdlen == 4)
+        {
+          unsigned int addr;
+          memcpy(&addr, data + off, 4);
+          if (ttl < DNS_TTL_MIN)
+            ttl = DNS_TTL_MIN;
+          if (ttl > DNS_TTL_MAX)
+            ttl = DNS_TTL_MAX;
+
+          stats.answers++;
+          dns_finish(e, 0, addr, ttl);
+          pbuf_free(p);
+          return;
+        }
+      off += rdlen;
+    }
+
+  // the name exists, but has no address
+  dns_finish(e, -ENOENT, 0, DNS_NEGATIVE_TTL);
+  pbuf_free(p);
+}
+
+void
+dns_set_server (unsigned int ip)
+{
+  server = ip;
+}
+
+int
+sys_resolve (const char *name, unsigned int len, unsigned int *addr)
+{
+  if (!mmu_user_range((unsigned int) name, len)
+      || !mmu_user_range((unsigned int) addr, sizeof(*addr)))
+    return -EFAULT;
+
+  char key[DNS_NAME_MAX];
+  int res = normalize(key, name, len);
+  if (res < 0)
+    return res;
+  len = res;
+
+  if (parse_address(key, addr))
+    return 0;
+
+  stats.lookups++;
+  struct dns_entry *e = dns_find(key, len);
+  if (e && e->state != DNS_PENDING && !expired(e))
+    {
+      stats.hits++;
+      e->used = tick_count;
+      if (e->state == DNS_FAILED)
+        return e->error;
+      *addr = e->addr;
+      return 0;
+    }
+
+  if (!e || e->state != DNS_PENDING)
+    {
+      if (!server)
+        return -ENETUNREACH;
+      if (!dns_pcb)
+        {
+          dns_pcb = udp_new();
+          if (!dns_pcb)
+            return -ENOBUFS;
+          dns_pcb->recv = &dns_recv;
+        }
+
+      if (!e && !(e = dns_new()))
+        return -ENOBUFS;
+
+      memcpy(e->name, key, len + 1);
+      e->len = len;
+      e->state = DNS_PENDING;
+      e->used = tick_count;
+      e->id = ++next_id ^ timer_counter_read();
+      e->tries = 0;
+
+      stats.misses++;
+      dns_send(e);
+      timeout_add(&e->timer, MS_TO_TICKS(DNS_RETRY_MS));
+      net_poll();
+    }
+
+  block_current_task(&e->waiters, 0);
+  need_resched = 1;
+  return -ERESTART;
+}
+
+const struct dns_stats*
+dns_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,63 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#define DNS_SERVER_PORT  53
+#define DNS_CACHE_SIZE   16
+#define DNS_NAME_MAX     64     // including the terminating zero
+#define DNS_RETRY_MS     1000
+#define DNS_TRIES        3
+#define DNS_TTL_MIN      1      // seconds, answers are kept at least this long
+#define DNS_TTL_MAX      3600
+#define DNS_NEGATIVE_TTL 10     // seconds failed lookups are remembered
+
+struct dns_stats
+{
+  unsigned int lookups;
+  unsigned int hits;           // lookups answered from the cache
+  unsigned int misses;         // lookups that started a query
+  unsigned int queries;        // sent queries, including retransmissions
+  unsigned int answers;
+  unsigned int nxdomain;
+  unsigned int timeouts;
+  unsigned int drop;           // replies that matched no query
+};
+
+/* set the server queries are sent to, the cache is kept
+ */
+void dns_set_server (unsigned int ip);
+
+/* the kernel side of resolve, see kernel/syscall.h
+ *
+ * the stub resolver keeps a cache of DNS_CACHE_SIZE names shared by all
+ * tasks. answers are cached for their time to live, failed lookups for
+ * DNS_NEGATIVE_TTL seconds. tasks that look up a name while a query for it
+ * is in flight wait for the same query.
+ */
+int sys_resolve (const char *name, unsigned int len, unsigned int *addr);
+
+/* returns the resolver counters
+ */
+const struct dns_stats* dns_stats (void);
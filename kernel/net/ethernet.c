@@ -0,0 +1,105 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "ethernet.h"
+
+#include "kernel/net/arp.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+#include <string.h>
+
+const unsigned char eth_broadcast[ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static struct ethernet_stats stats = { 0 };
+
+void
+ethernet_input (struct netif *netif, struct pbuf *p)
+{
+  stats.rx++;
+
+  if (p->len < ETH_HLEN)
+    {
+      stats.drop_short++;
+      pbuf_free(p);
+      return;
+    }
+
+  struct eth_hdr *eth = (struct eth_hdr*)p->payload;
+
+  // group addresses have the lowest bit of the first byte set
+  if (!(eth->dst[0] & 1) && memcmp(eth->dst, netif->mac, ETH_ALEN))
+    {
+      stats.drop_addr++;
+      pbuf_free(p);
+      return;
+    }
+
+  unsigned short type = ntohs(eth->type);
+  pbuf_header(p, -ETH_HLEN);
+
+  switch (type)
+    {
+    case ETHTYPE_IP:
+      ip_input(netif, p);
+      break;
+    case ETHTYPE_ARP:
+      arp_input(netif, p);
+      break;
+    default:
+      stats.drop_type++;
+      pbuf_free(p);
+      break;
+    }
+}
+
+int
+ethernet_output (struct netif *netif, struct pbuf *p,
+                 const unsigned char *dst, unsigned short type)
+{
+  if (pbuf_header(p, ETH_HLEN))
+    {
+      struct pbuf *h = pbuf_alloc_small(PBUF_LINK_HEADROOM, ETH_HLEN);
+      if (!h)
+        {
+          stats.drop_tx++;
+          pbuf_free(p);
+          return -ENOMEM;
+        }
+      pbuf_cat(h, p);
+      p = h;
+    }
+
+  struct eth_hdr *eth = (struct eth_hdr*)p->payload;
+  memcpy(eth->dst, dst, ETH_ALEN);
+  memcpy(eth->src, netif->mac, ETH_ALEN);
+  eth->type = htons(type);
+
+  stats.tx++;
+  return netif->linkoutput(netif, p);
+}
+
+const struct ethernet_stats*
+ethernet_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,76 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#define ETH_ALEN 6
+#define ETH_HLEN 14
+#define ETH_FRAME_MAX 1514
+
+#define ETHTYPE_IP  0x0800
+#define ETHTYPE_ARP 0x0806
+
+struct pbuf;
+struct netif;
+
+struct eth_hdr
+{
+  unsigned char dst[ETH_ALEN];
+  unsigned char src[ETH_ALEN];
+  unsigned short type;
+};
+
+struct ethernet_stats
+{
+  unsigned int rx;
+  unsigned int tx;
+  unsigned int drop_short;
+  unsigned int drop_addr;
+  unsigned int drop_type;
+  unsigned int drop_tx;
+};
+
+extern const unsigned char eth_broadcast[ETH_ALEN];
+
+/* handle a received frame, takes over the reference to p
+ */
+void ethernet_input (struct netif *netif, struct pbuf *p);
+
+/* prepend the ethernet header and send the frame
+ *
+ * params:
+ *   netif - the sending interface
+ *   p     - the payload, the reference is taken over
+ *   dst   - the destination hardware address
+ *   type  - the ethertype, in host byte order
+ *
+ * returns:
+ *   0 on success or a negative error code
+ */
+int ethernet_output (struct netif *netif, struct pbuf *p,
+                     const unsigned char *dst, unsigned short type);
+
+/* returns the ethernet layer counters
+ */
+const struct ethernet_stats* ethernet_stats (void);
@@ -0,0 +1,50 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "icmp.h"
+
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+void
+icmp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph)
+{
+  struct icmp_hdr *icmp = (struct icmp_hdr*)p->payload;
+
+  // echo requests to broadcast addresses are not answered
+  if (p->len < sizeof(struct icmp_hdr) || icmp->type != ICMP_ECHO_REQUEST
+      || iph->dst != netif->ip || chksum_fold(chksum_add_pbuf(0, p)))
+    {
+      pbuf_free(p);
+      return;
+    }
+
+  // answer in place, the request buffer has room for the headers
+  unsigned int src = iph->dst;
+  unsigned int dst = iph->src;
+
+  icmp->type = ICMP_ECHO_REPLY;
+  icmp->chksum = 0;
+  icmp->chksum = chksum_fold(chksum_add_pbuf(0, p));
+
+  ip_output(p, src, dst, IP_PROTO_ICMP);
+}
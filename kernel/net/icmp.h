@@ -0,0 +1,46 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct pbuf;
+struct netif;
+struct ip_hdr;
+
+#define ICMP_ECHO_REPLY   0
+#define ICMP_ECHO_REQUEST 8
+
+struct icmp_hdr
+{
+  unsigned char type;
+  unsigned char code;
+  unsigned short chksum;
+  unsigned short id;
+  unsigned short seq;
+};
+
+/* handle a received icmp message, answers echo requests. takes over the
+ * reference to p.
+ */
+void icmp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph);
@@ -0,0 +1,222 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "ip.h"
+
+#include "kernel/net/checksum.h"
+#include "kernel/net/icmp.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+#include "kernel/net/tcp.h"
+#include "kernel/net/udp.h"
+
+#include <errno.h>
+
+struct route
+{
+  unsigned int dest;
+  unsigned int netmask;
+  unsigned int gateway;
+  struct netif *netif;
+};
+
+static struct route routes[ROUTE_MAX] = { { 0 } };
+static unsigned short ip_id = 0;
+static struct ip_stats stats = { 0 };
+
+int
+ip_is_local (const struct netif *netif, unsigned int addr)
+{
+  return addr == netif->ip || addr == IP4_BROADCAST
+      || addr == (netif->ip | ~netif->netmask);
+}
+
+void
+ip_input (struct netif *netif, struct pbuf *p)
+{
+  stats.rx++;
+
+  struct ip_hdr *iph = (struct ip_hdr*)p->payload;
+  unsigned int hlen = (iph->vhl & 0xF) * 4;
+  unsigned int len;
+
+  if (p->len < IP_HLEN || (iph->vhl >> 4) != 4 || hlen < IP_HLEN
+      || hlen > p->len || (len = ntohs(iph->len)) < hlen || len > p->tot_len)
+    {
+      stats.drop_header++;
+      goto drop;
+    }
+
+  if (inet_chksum(iph, hlen))
+    {
+      stats.drop_checksum++;
+      goto drop;
+    }
+
+  // reassembly is not supported
+  if (iph->offset & htons(IP_MF | IP_OFFMASK))
+    {
+      stats.drop_fragment++;
+      goto drop;
+    }
+
+  if (!ip_is_local(netif, iph->dst))
+    {
+      stats.drop_addr++;
+      goto drop;
+    }
+
+  // strip the link layer padding of short frames
+  pbuf_trim(p, len);
+  pbuf_header(p, -hlen);
+
+  switch (iph->proto)
+    {
+    case IP_PROTO_ICMP:
+      stats.rx_delivered++;
+      icmp_input(netif, p, iph);
+      return;
+    case IP_PROTO_TCP:
+      stats.rx_delivered++;
+      tcp_input(netif, p, iph);
+      return;
+    case IP_PROTO_UDP:
+      stats.rx_delivered++;
+      udp_input(netif, p, iph);
+      return;
+    default:
+      stats.drop_proto++;
+      goto drop;
+    }
+
+drop:
+  pbuf_free(p);
+}
+
+int
+ip_output (struct pbuf *p, unsigned int src, unsigned int dst,
+           unsigned char proto)
+{
+  unsigned int nexthop;
+  struct netif *netif = route_lookup(dst, &nexthop);
+  if (!netif)
+    {
+      stats.drop_noroute++;
+      pbuf_free(p);
+      return -ENETUNREACH;
+    }
+
+  return ip_output_if(p, netif, src, dst, nexthop, proto);
+}
+
+int
+ip_output_if (struct pbuf *p, struct netif *netif, unsigned int src,
+              unsigned int dst, unsigned int nexthop, unsigned char proto)
+{
+  if (p->tot_len + IP_HLEN > netif->mtu)
+    {
+      stats.drop_size++;
+      pbuf_free(p);
+      return -EMSGSIZE;
+    }
+
+  if (pbuf_header(p, IP_HLEN))
+    {
+      struct pbuf *h = pbuf_alloc_small(PBUF_IP_HEADROOM, IP_HLEN);
+      if (!h)
+        {
+          pbuf_free(p);
+          return -ENOMEM;
+        }
+      pbuf_cat(h, p);
+      p = h;
+    }
+
+  struct ip_hdr *iph = (struct ip_hdr*)p->payload;
+  iph->vhl = 0x45;
+  iph->tos = 0;
+  iph->len = htons(p->tot_len);
+  iph->id = htons(ip_id++);
+  iph->offset = htons(IP_DF);
+  iph->ttl = IP_TTL;
+  iph->proto = proto;
+  iph->chksum = 0;
+  iph->src = src ? src : netif->ip;
+  iph->dst = dst;
+  iph->chksum = inet_chksum(iph, IP_HLEN);
+
+  stats.tx++;
+  return netif->output(netif, p, nexthop);
+}
+
+int
+route_add (unsigned int dest, unsigned int netmask, unsigned int gateway,
+           struct netif *netif)
+{
+  unsigned int i;
+  for (i = 0; i < ROUTE_MAX; ++i)
+    if (!routes[i].netif)
+      {
+        routes[i].dest = dest & netmask;
+        routes[i].netmask = netmask;
+        routes[i].gateway = gateway;
+        routes[i].netif = netif;
+        return 0;
+      }
+
+  return -ENOMEM;
+}
+
+void
+route_flush (struct netif *netif)
+{
+  unsigned int i;
+  for (i = 0; i < ROUTE_MAX; ++i)
+    if (routes[i].netif == netif)
+      routes[i].netif = 0;
+}
+
+struct netif*
+route_lookup (unsigned int dst, unsigned int *nexthop)
+{
+  // masks are contiguous, so the longest prefix has the largest mask in
+  // host byte order
+  struct route *best = 0;
+  unsigned int i;
+  for (i = 0; i < ROUTE_MAX; ++i)
+    {
+      struct route *r = &routes[i];
+      if (r->netif && (dst & r->netmask) == r->dest
+          && (!best || ntohl(r->netmask) > ntohl(best->netmask)))
+        best = r;
+    }
+
+  if (!best)
+    return 0;
+
+  *nexthop = best->gateway ? best->gateway : dst;
+  return best->netif;
+}
+
+const struct ip_stats*
+ip_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,137 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct pbuf;
+struct netif;
+
+#define IP_HLEN 20
+#define IP_TTL  64
+
+#define IP_PROTO_ICMP 1
+#define IP_PROTO_TCP  6
+#define IP_PROTO_UDP  17
+
+#define IP_DF      0x4000
+#define IP_MF      0x2000
+#define IP_OFFMASK 0x1FFF
+
+#define ROUTE_MAX 8
+
+struct ip_hdr
+{
+  unsigned char vhl;
+  unsigned char tos;
+  unsigned short len;
+  unsigned short id;
+  unsigned short offset;
+  unsigned char ttl;
+  unsigned char proto;
+  unsigned short chksum;
+  unsigned int src;
+  unsigned int dst;
+};
+
+struct ip_stats
+{
+  unsigned int rx;
+  unsigned int rx_delivered;
+  unsigned int drop_header;
+  unsigned int drop_checksum;
+  unsigned int drop_fragment;
+  unsigned int drop_addr;
+  unsigned int drop_proto;
+  unsigned int tx;
+  unsigned int drop_noroute;
+  unsigned int drop_size;
+};
+
+/* handle a received ip packet, takes over the reference to p
+ *
+ * the header is validated in a single pass over its fields. the transport
+ * handlers get p with the payload at the transport header and a pointer to
+ * the ip header in front of it.
+ */
+void ip_input (struct netif *netif, struct pbuf *p);
+
+/* prepend the ip header and send the packet along the matching route
+ *
+ * params:
+ *   p     - the transport header and payload, the reference is taken over
+ *   src   - the source address, or IP4_ANY for the address of the interface
+ *   dst   - the destination address
+ *   proto - the transport protocol
+ *
+ * returns:
+ *   0 on success or a negative error code
+ */
+int ip_output (struct pbuf *p, unsigned int src, unsigned int dst,
+               unsigned char proto);
+
+/* like ip_output, for a route that is already known
+ *
+ * params:
+ *   netif   - the outgoing interface
+ *   nexthop - the address to resolve on the link
+ */
+int ip_output_if (struct pbuf *p, struct netif *netif, unsigned int src,
+                  unsigned int dst, unsigned int nexthop, unsigned char proto);
+
+/* check whether an address is local to or a broadcast on the interface
+ */
+int ip_is_local (const struct netif *netif, unsigned int addr);
+
+/* add a route, all addresses in network byte order
+ *
+ * params:
+ *   dest    - the destination network
+ *   netmask - the prefix of the destination network
+ *   gateway - the next hop, or IP4_ANY for directly attached networks
+ *   netif   - the outgoing interface
+ *
+ * returns:
+ *   0 on success or -ENOMEM if the table is full
+ */
+int route_add (unsigned int dest, unsigned int netmask, unsigned int gateway,
+               struct netif *netif);
+
+/* remove all routes through an interface
+ */
+void route_flush (struct netif *netif);
+
+/* find the route with the longest prefix matching dst
+ *
+ * params:
+ *   dst     - the destination address
+ *   nexthop - receives the address to resolve on the link
+ *
+ * returns:
+ *   the outgoing interface, or 0 if there is no route
+ */
+struct netif* route_lookup (unsigned int dst, unsigned int *nexthop);
+
+/* returns the ip layer counters
+ */
+const struct ip_stats* ip_stats (void);
@@ -0,0 +1,115 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "loopback.h"
+
+#include "kernel/softirq.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+
+static int loop_output (struct netif *netif, struct pbuf *p,
+                        unsigned int nexthop);
+
+struct netif loop_netif =
+{
+  .name = "lo",
+  .mtu = ETH_FRAME_MAX - ETH_HLEN,
+  .output = &loop_output,
+};
+
+// packets waiting for delivery, linked by link
+static struct pbuf *queue = 0;
+static struct pbuf *queue_tail = 0;
+static unsigned int queued = 0;
+
+static struct loopback_stats stats = { 0 };
+
+static int
+loop_output (struct netif *netif, struct pbuf *p, unsigned int nexthop)
+{
+  if (queued == LOOPBACK_QUEUE_MAX)
+    {
+      stats.drop_queue++;
+      pbuf_free(p);
+      return -ENOBUFS;
+    }
+
+  // the sender may keep its buffers for retransmissions
+  struct pbuf *q = pbuf_alloc(PBUF_IP_HEADROOM, p->tot_len);
+  if (!q)
+    {
+      stats.drop_nobuf++;
+      pbuf_free(p);
+      return -ENOMEM;
+    }
+  pbuf_copy_out(p, 0, q->payload, p->tot_len);
+  pbuf_free(p);
+
+  q->link = 0;
+  if (queue)
+    queue_tail->link = q;
+  else
+    queue = q;
+  queue_tail = q;
+  queued++;
+
+  stats.tx++;
+  softirq_raise(SOFTIRQ_NET_RX);
+  return 0;
+}
+
+void
+loopback_init (void)
+{
+  loop_netif.ip = IP4(127, 0, 0, 1);
+  loop_netif.netmask = IP4(255, 0, 0, 0);
+  route_add(loop_netif.ip, loop_netif.netmask, IP4_ANY, &loop_netif);
+}
+
+unsigned int
+loopback_poll (unsigned int budget)
+{
+  unsigned int done;
+  for (done = 0; done < budget && queue; ++done)
+    {
+      struct pbuf *p = queue;
+      queue = p->link;
+      if (!queue)
+        queue_tail = 0;
+      queued--;
+
+      p->link = 0;
+      stats.rx++;
+      ip_input(&loop_netif, p);
+    }
+
+  if (queue)
+    softirq_raise(SOFTIRQ_NET_RX);
+  return done;
+}
+
+const struct loopback_stats*
+loopback_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,68 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+struct netif;
+
+#define LOOPBACK_QUEUE_MAX 64
+#define LOOPBACK_BUDGET    32  // packets delivered per net_poll
+
+/* the loopback interface routes 127.0.0.0/8 back into the stack without
+ * touching hardware
+ *
+ * sent packets are copied into fresh buffers, like a network card would,
+ * and queued. delivering them right away would re-enter the protocol code
+ * that sent them, so the queue is delivered by loopback_poll instead, either
+ * from net_poll at the end of a socket syscall or from the receive bottom
+ * half, which is raised for every queued packet.
+ */
+extern struct netif loop_netif;
+
+struct loopback_stats
+{
+  unsigned int tx;
+  unsigned int rx;
+  unsigned int drop_queue;
+  unsigned int drop_nobuf;
+};
+
+/* bring up the interface with the address 127.0.0.1/8 */
+void loopback_init (void);
+
+/* deliver queued packets to the ip layer, must only be called from the
+ * outermost level of the network stack
+ *
+ * params:
+ *   budget - the maximum number of packets to deliver, the receive bottom
+ *            half is raised if more are queued
+ *
+ * returns:
+ *   the number of delivered packets
+ */
+unsigned int loopback_poll (unsigned int budget);
+
+/* returns the loopback counters
+ */
+const struct loopback_stats* loopback_stats (void);
@@ -0,0 +1,157 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "net.h"
+
+#include "kernel/scheduler.h"
+#include "kernel/softirq.h"
+#include "kernel/syscall.h"
+#include "kernel/drivers/smc91c111.h"
+#include "kernel/net/arp.h"
+#include "kernel/net/dhcp.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/loopback.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+
+static int eth_linkoutput (struct netif *netif, struct pbuf *p);
+
+struct netif eth_netif =
+{
+  .name = "eth0",
+  .mtu = ETH_FRAME_MAX - ETH_HLEN,
+  .output = &arp_output,
+  .linkoutput = &eth_linkoutput,
+};
+
+static unsigned int timer_ticks = 0;
+
+static int
+eth_linkoutput (struct netif *netif, struct pbuf *p)
+{
+  int result = smc91c111_transmit(p);
+  if (result < 0)
+    pbuf_free(p);
+  return result;
+}
+
+static void
+eth_receive (struct pbuf *p)
+{
+  ethernet_input(&eth_netif, p);
+}
+
+static unsigned int
+net_rx (unsigned int budget)
+{
+  unsigned int done = smc91c111_poll(budget);
+  done += loopback_poll(budget - done);
+  net_flush();
+  return done;
+}
+
+void
+net_init (void)
+{
+  softirq_register(SOFTIRQ_NET_RX, "net_rx", &net_rx, NET_RX_BUDGET);
+  loopback_init();
+
+  if (!smc91c111_present())
+    return;
+
+  smc91c111_mac(eth_netif.mac);
+  smc91c111_set_rx_handler(&eth_receive);
+  dhcp_start(&eth_netif);
+}
+
+void
+netif_configure (struct netif *netif, unsigned int ip, unsigned int netmask,
+                 unsigned int gateway)
+{
+  route_flush(netif);
+  netif->ip = ip;
+  netif->netmask = ip ? netmask : IP4_ANY;
+  if (!ip)
+    return;
+
+  route_add(ip, netmask, IP4_ANY, netif);
+  if (gateway)
+    route_add(IP4_ANY, IP4_ANY, gateway, netif);
+}
+
+void
+net_flush (void)
+{
+  smc91c111_flush();
+}
+
+void
+net_poll (void)
+{
+  loopback_poll(LOOPBACK_BUDGET);
+  net_flush();
+}
+
+void
+net_tick (void)
+{
+  if (++timer_ticks >= MS_TO_TICKS(NET_TIMER_MS))
+    {
+      timer_ticks = 0;
+      arp_timer();
+    }
+
+  // also sends what the timeouts of this tick queued
+  net_flush();
+}
+
+int
+sys_netif_tune (int param, int value)
+{
+  if (!smc91c111_present())
+    return -ENODEV;
+
+  struct smc91c111_coalesce *c = smc91c111_coalesce();
+  unsigned int *field;
+  switch (param)
+    {
+    case NETIF_RX_FRAMES:
+      field = &c->rx_frames;
+      break;
+    case NETIF_RX_USECS:
+      field = &c->rx_usecs;
+      if (value > NETIF_RX_USECS_MAX)
+        return -EINVAL;
+      break;
+    case NETIF_TX_FRAMES:
+      field = &c->tx_frames;
+      if (value == 0)
+        return -EINVAL;
+      break;
+    default:
+      return -EINVAL;
+    }
+
+  int old = *field;
+  if (value >= 0)
+    *field = value;
+  return old;
+}
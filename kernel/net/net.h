@@ -0,0 +1,112 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/net/ethernet.h"
+
+struct pbuf;
+
+// the network stack keeps addresses and header fields in network byte order
+#define htons(X) ((unsigned short)__builtin_bswap16(X))
+#define ntohs(X) htons(X)
+#define htonl(X) __builtin_bswap32(X)
+#define ntohl(X) htonl(X)
+
+#define IP4(A, B, C, D) htonl(((A) << 24) | ((B) << 16) | ((C) << 8) | (D))
+#define IP4_ANY       0
+#define IP4_BROADCAST 0xFFFFFFFF
+
+// the address plan of the qemu user mode network, used if no dhcp server
+// answers
+#define NET_DEFAULT_IP      IP4(10, 0, 2, 15)
+#define NET_DEFAULT_NETMASK IP4(255, 255, 255, 0)
+#define NET_DEFAULT_GATEWAY IP4(10, 0, 2, 2)
+#define NET_DEFAULT_DNS     IP4(10, 0, 2, 3)
+
+// period of the protocol timers
+#define NET_TIMER_MS 100
+
+// packets received per run of the receive bottom half
+#define NET_RX_BUDGET 16
+
+struct netif
+{
+  const char *name;
+  unsigned int ip;
+  unsigned int netmask;
+  unsigned char mac[ETH_ALEN];
+  unsigned short mtu;
+
+  /* send an ip packet to the next hop, the interface takes over the
+   * reference to p in every case
+   */
+  int (*output) (struct netif *netif, struct pbuf *p, unsigned int nexthop);
+
+  /* send a link layer frame, the interface takes over the reference to p */
+  int (*linkoutput) (struct netif *netif, struct pbuf *p);
+};
+
+extern struct netif eth_netif;
+
+/* bring up the loopback interface, and the ethernet interface if an
+ * ethernet controller is present. the ethernet interface is configured by
+ * dhcp, see kernel/net/dhcp.h.
+ *
+ * received packets are processed by the SOFTIRQ_NET_RX bottom half, which
+ * polls the interfaces for up to NET_RX_BUDGET packets per run
+ */
+void net_init (void);
+
+/* set the address of an interface and replace its routes
+ *
+ * params:
+ *   ip      - the address, or IP4_ANY to take the interface down
+ *   netmask - the prefix of the attached network
+ *   gateway - the default gateway, or IP4_ANY for none
+ */
+void netif_configure (struct netif *netif, unsigned int ip,
+                      unsigned int netmask, unsigned int gateway);
+
+/* hand the frames the interfaces batched for transmission to the hardware,
+ * called whenever the network stack is left
+ */
+void net_flush (void);
+
+/* deliver the packets the loopback interface deferred and flush the
+ * transmit batches, called when leaving the network stack at the end of
+ * socket syscalls. packets left over are delivered by the receive bottom
+ * half.
+ */
+void net_poll (void);
+
+/* called from the timer bottom half after the timeouts ran, runs the
+ * protocol timers every NET_TIMER_MS milliseconds
+ */
+void net_tick (void);
+
+/* get and set the interrupt coalescing parameters of the ethernet
+ * interface, see netif_tune in kernel/syscall.h
+ */
+int sys_netif_tune (int param, int value);
@@ -0,0 +1,284 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "pbuf.h"
+
+#include "kernel/interrupt.h"
+#include "kernel/memory.h"
+#include "kernel/page_alloc.h"
+
+#include <errno.h>
+#include <string.h>
+
+// free slots are linked through their next pointer, with a list per slot
+// size. pages stay owned by the pool while they are lent to tasks, and a
+// page carved into small slots stays small. the pool and the reference
+// counts are only touched with interrupts disabled, the receive interrupt
+// allocates while a bottom half may be freeing.
+static struct pbuf *free_list = 0;
+static struct pbuf *small_list = 0;
+static struct pbuf_stats stats = { 0 };
+
+static struct pbuf*
+slot_alloc (int small)
+{
+  struct pbuf **list = small ? &small_list : &free_list;
+  if (!*list)
+    {
+      if (stats.pages == PBUF_MAX_PAGES)
+        return 0;
+
+      unsigned int page = page_alloc();
+      if (!page)
+        return 0;
+      stats.pages++;
+
+      unsigned int size = small ? PBUF_SMALL_SLOT_SIZE : PBUF_SLOT_SIZE;
+      unsigned int slot;
+      for (slot = page; slot - page < PAGE_SIZE; slot += size)
+        {
+          struct pbuf *p = (struct pbuf*)slot;
+          p->small = small;
+          p->next = *list;
+          *list = p;
+        }
+
+      if (small)
+        {
+          stats.small_buffers += PAGE_SIZE / size;
+          stats.small_free += PAGE_SIZE / size;
+        }
+      else
+        {
+          stats.buffers += PAGE_SIZE / size;
+          stats.free += PAGE_SIZE / size;
+        }
+    }
+
+  struct pbuf *p = *list;
+  *list = p->next;
+  if (small)
+    stats.small_free--;
+  else
+    stats.free--;
+  return p;
+}
+
+static void
+slot_free (struct pbuf *p)
+{
+  if (p->small)
+    {
+      p->next = small_list;
+      small_list = p;
+      stats.small_free++;
+    }
+  else
+    {
+      p->next = free_list;
+      free_list = p;
+      stats.free++;
+    }
+}
+
+struct pbuf*
+pbuf_alloc_small (unsigned int headroom, unsigned int length)
+{
+  if (headroom + length > PBUF_SMALL_CAPACITY)
+    return pbuf_alloc(headroom, length);
+
+  unsigned int flags = irq_save();
+  struct pbuf *p = slot_alloc(1);
+  if (!p)
+    stats.alloc_failures++;
+  irq_restore(flags);
+  if (!p)
+    return 0;
+
+  p->next = 0;
+  p->link = 0;
+  p->payload = (unsigned char*)(p + 1) + headroom;
+  p->len = length;
+  p->tot_len = length;
+  p->ref = 1;
+  return p;
+}
+
+struct pbuf*
+pbuf_alloc (unsigned int headroom, unsigned int length)
+{
+  if (headroom >= PBUF_CAPACITY || length > 0xFFFF)
+    return 0;
+
+  struct pbuf *head = 0;
+  struct pbuf **tail = &head;
+  unsigned int remaining = length;
+
+  do
+    {
+      unsigned int flags = irq_save();
+      struct pbuf *p = slot_alloc(0);
+      if (!p)
+        stats.alloc_failures++;
+      irq_restore(flags);
+      if (!p)
+        {
+          pbuf_free(head);
+          return 0;
+        }
+
+      unsigned int len = PBUF_CAPACITY - headroom;
+      if (len > remaining)
+        len = remaining;
+
+      p->next = 0;
+      p->link = 0;
+      p->payload = (unsigned char*)(p + 1) + headroom;
+      p->len = len;
+      p->tot_len = remaining;
+      p->ref = 1;
+
+      remaining -= len;
+      headroom = 0;
+      *tail = p;
+      tail = &p->next;
+    }
+  while (remaining);
+
+  return head;
+}
+
+void
+pbuf_ref (struct pbuf *p)
+{
+  unsigned int flags = irq_save();
+  ++p->ref;
+  irq_restore(flags);
+}
+
+void
+pbuf_free (struct pbuf *p)
+{
+  // a buffer references the rest of its chain, so the walk stops at the
+  // first buffer that is still referenced elsewhere
+  unsigned int flags = irq_save();
+  while (p && --p->ref == 0)
+    {
+      struct pbuf *next = p->next;
+      slot_free(p);
+      p = next;
+    }
+  irq_restore(flags);
+}
+
+int
+pbuf_header (struct pbuf *p, int delta)
+{
+  if (delta >= 0)
+    {
+      if (p->payload - (unsigned char*)(p + 1) < delta)
+        return -ENOMEM;
+    }
+  else if (-delta > p->len)
+    return -ENOMEM;
+
+  p->payload -= delta;
+  p->len += delta;
+  p->tot_len += delta;
+  return 0;
+}
+
+void
+pbuf_trim (struct pbuf *p, unsigned int length)
+{
+  if (length >= p->tot_len)
+    return;
+
+  while (length > p->len)
+    {
+      p->tot_len = length;
+      length -= p->len;
+      p = p->next;
+    }
+
+  p->len = length;
+  p->tot_len = length;
+  pbuf_free(p->next);
+  p->next = 0;
+}
+
+void
+pbuf_cat (struct pbuf *h, struct pbuf *t)
+{
+  for (; h->next; h = h->next)
+    h->tot_len += t->tot_len;
+  h->tot_len += t->tot_len;
+  h->next = t;
+}
+
+unsigned int
+pbuf_copy_out (const struct pbuf *p, unsigned int offset,
+               void *dst, unsigned int length)
+{
+  unsigned char *out = dst;
+  unsigned int copied = 0;
+
+  for (; p && copied < length; p = p->next)
+    {
+      if (offset >= p->len)
+        {
+          offset -= p->len;
+          continue;
+        }
+
+      unsigned int n = p->len - offset;
+      if (n > length - copied)
+        n = length - copied;
+      memcpy(out + copied, p->payload + offset, n);
+      copied += n;
+      offset = 0;
+    }
+
+  return copied;
+}
+
+unsigned int
+pbuf_take (struct pbuf *p, const void *src, unsigned int length)
+{
+  const unsigned char *in = src;
+  unsigned int copied = 0;
+
+  for (; p && copied < length; p = p->next)
+    {
+      unsigned int n = p->len;
+      if (n > length - copied)
+        n = length - copied;
+      memcpy(p->payload, in + copied, n);
+      copied += n;
+    }
+
+  return copied;
+}
+
+const struct pbuf_stats*
+pbuf_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,150 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/memory.h"
+
+/* packet buffers hold network packets on their way through the stack. every
+ * buffer is a fixed size slot of PBUF_SLOT_SIZE bytes, larger packets are
+ * stored in a chain of buffers linked by next. a slot fills a page, so a
+ * buffer can be lent to a task without exposing other packets. headers and
+ * control segments, which are never lent, use the small slots of
+ * pbuf_alloc_small instead. each layer reserves room for the headers of the
+ * layers below when allocating, so headers are prepended with pbuf_header
+ * instead of copying the payload.
+ *
+ * the pool grows a page at a time up to PBUF_MAX_PAGES pages, 1 MiB, and
+ * never shrinks. that is 256 page slots, or 16 small slots per page taken
+ * for small ones, shared by all packets in flight, queued in sockets and
+ * lent to tasks.
+ *
+ * buffers are reference counted: whoever holds a pointer to a packet owns one
+ * reference and drops it with pbuf_free. allocating, referencing and freeing
+ * may happen in interrupt handlers and in bottom halves, these functions
+ * disable interrupts around the pool and the reference counts themselves.
+ * the other functions work on buffers owned by the caller and need no
+ * locking.
+ */
+
+#define PBUF_SLOT_SIZE PAGE_SIZE
+#define PBUF_SMALL_SLOT_SIZE 256
+#define PBUF_MAX_PAGES 256
+
+// headroom for a packet allocated at each layer. the two extra bytes keep the
+// ip header word aligned behind the 14 byte ethernet header.
+#define PBUF_LINK_HEADROOM      2
+#define PBUF_IP_HEADROOM        (PBUF_LINK_HEADROOM + 14)
+#define PBUF_TRANSPORT_HEADROOM (PBUF_IP_HEADROOM + 20)
+#define PBUF_APP_HEADROOM       (PBUF_TRANSPORT_HEADROOM + 60)
+
+struct pbuf
+{
+  struct pbuf *next;       // next buffer of the same packet
+  struct pbuf *link;       // next packet in a queue, free for use by the owner
+  unsigned char *payload;
+  unsigned short len;      // bytes in this buffer
+  unsigned short tot_len;  // bytes in this and all following buffers
+  unsigned short ref;
+  unsigned short port;     // source port of a received datagram
+  unsigned int addr;       // source address of a received datagram
+  unsigned int small;      // in a small slot, must not be lent to a task
+};
+
+#define PBUF_CAPACITY (PBUF_SLOT_SIZE - sizeof(struct pbuf))
+#define PBUF_SMALL_CAPACITY (PBUF_SMALL_SLOT_SIZE - sizeof(struct pbuf))
+
+struct pbuf_stats
+{
+  unsigned int pages;
+  unsigned int buffers;        // page slots
+  unsigned int free;
+  unsigned int small_buffers;
+  unsigned int small_free;
+  unsigned int alloc_failures;
+};
+
+/* allocate a packet, chained over several buffers if it does not fit one
+ *
+ * params:
+ *   headroom - bytes reserved in front of the payload of the first buffer
+ *   length   - the size of the payload
+ *
+ * returns:
+ *   the first buffer of the packet with a reference count of one, or 0 if the
+ *   pool is exhausted
+ */
+struct pbuf* pbuf_alloc (unsigned int headroom, unsigned int length);
+
+/* like pbuf_alloc, but takes a small slot if headroom and length fit one.
+ * for headers and control packets that are never lent to a task.
+ */
+struct pbuf* pbuf_alloc_small (unsigned int headroom, unsigned int length);
+
+/* take another reference to the packet starting at p
+ */
+void pbuf_ref (struct pbuf *p);
+
+/* drop a reference to the packet starting at p. buffers are returned to the
+ * pool once their last reference is dropped.
+ */
+void pbuf_free (struct pbuf *p);
+
+/* move the payload start of the first buffer
+ *
+ * params:
+ *   p     - the packet
+ *   delta - bytes to prepend, or to strip if negative
+ *
+ * returns:
+ *   0 on success, -ENOMEM if the headroom or the buffer is too small
+ */
+int pbuf_header (struct pbuf *p, int delta);
+
+/* shorten the packet to length bytes, freeing buffers that become empty
+ */
+void pbuf_trim (struct pbuf *p, unsigned int length);
+
+/* append the packet t to the packet h, the reference to t is taken over
+ */
+void pbuf_cat (struct pbuf *h, struct pbuf *t);
+
+/* copy bytes out of a packet
+ *
+ * returns:
+ *   the number of bytes copied
+ */
+unsigned int pbuf_copy_out (const struct pbuf *p, unsigned int offset,
+                            void *dst, unsigned int length);
+
+/* copy bytes into a packet, starting at the payload of the first buffer
+ *
+ * returns:
+ *   the number of bytes copied
+ */
+unsigned int pbuf_take (struct pbuf *p, const void *src, unsigned int length);
+
+/* returns the pool statistics
+ */
+const struct pbuf_stats* pbuf_stats (void);
@@ -0,0 +1,507 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "socket.h"
+
+#include "kernel/memory.h"
+#include "kernel/mmu.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+#include "kernel/net/tcp.h"
+#include "kernel/net/udp.h"
+
+#include <errno.h>
+
+#define UDP_PAYLOAD_MAX (ETH_FRAME_MAX - ETH_HLEN - IP_HLEN - UDP_HLEN)
+
+struct socket
+{
+  int type;     // zero if the slot is free
+  int flags;
+  task_t *owner;
+  struct udp_pcb *udp;
+  struct tcp_pcb *tcp;
+};
+
+static struct socket sockets[SOCKET_MAX] = { { 0 } };
+
+// packet buffers lent to each task, indexed by window page
+static struct pbuf *lent[MAX_TASK_NUMBER][TASK_WINDOW_PAGES] = { { 0 } };
+
+// returns the socket if it belongs to the current task and has the given
+// type, or any type if type is zero
+static struct socket*
+socket_get (int fd, int type)
+{
+  if (fd < 0 || fd >= SOCKET_MAX || !sockets[fd].type
+      || sockets[fd].owner != current_task
+      || (type && sockets[fd].type != type))
+    return 0;
+
+  return &sockets[fd];
+}
+
+static int
+socket_alloc (void)
+{
+  int fd;
+  for (fd = 0; fd < SOCKET_MAX; ++fd)
+    if (!sockets[fd].type)
+      return fd;
+
+  return -ENOBUFS;
+}
+
+// wait for the queue to be woken up, the syscall is repeated afterwards
+static int
+socket_block (struct socket *sock, wait_queue_t *queue)
+{
+  if (sock->flags & SOCK_NONBLOCK)
+    return -EAGAIN;
+
+  block_current_task(queue, 0);
+  need_resched = 1;
+  return -ERESTART;
+}
+
+static inline unsigned int
+window_address (unsigned int index)
+{
+  return TASK_REGION_BASE(current_task - tasks) + TASK_WINDOW_OFFSET
+       + index * PAGE_SIZE;
+}
+
+// map a packet buffer into a free window page of the current task
+static unsigned int
+window_lend (struct pbuf *p, int writable)
+{
+  struct pbuf **slots = lent[current_task - tasks];
+  unsigned int i;
+  for (i = 0; i < TASK_WINDOW_PAGES; ++i)
+    if (!slots[i])
+      {
+        unsigned int addr = window_address(i);
+        slots[i] = p;
+        mmu_map_window(addr, (unsigned int) p, writable);
+        return addr + (p->payload - (unsigned char*) p);
+      }
+
+  return 0;
+}
+
+// unmap the window page holding data and return its packet buffer
+static struct pbuf*
+window_return (unsigned int data)
+{
+  unsigned int index = (data - window_address(0)) / PAGE_SIZE;
+  if (index >= TASK_WINDOW_PAGES)
+    return 0;
+
+  struct pbuf **slot = &lent[current_task - tasks][index];
+  struct pbuf *p = *slot;
+  if (p)
+    {
+      mmu_unmap_window(window_address(index));
+      *slot = 0;
+    }
+
+  return p;
+}
+
+static int
+read_destination (const void *to, unsigned int *ip, unsigned short *port)
+{
+  if (!mmu_user_range((unsigned int) to, sizeof(struct sockaddr_in)))
+    return -EFAULT;
+
+  const struct sockaddr_in *sin = to;
+  if (sin->sin_family != AF_INET)
+    return -EINVAL;
+
+  *ip = sin->sin_addr;
+  *port = sin->sin_port;
+  return 0;
+}
+
+// take the next datagram, or block the task if there is none
+static struct pbuf*
+receive (struct socket *sock, int *error)
+{
+  struct pbuf *p = udp_recv(sock->udp);
+  if (!p)
+    *error = socket_block(sock, &sock->udp->readers);
+
+  return p;
+}
+
+int
+sys_socket (int type)
+{
+  int fd = socket_alloc();
+  if (fd < 0)
+    return fd;
+
+  struct socket *sock = &sockets[fd];
+  switch (type & ~SOCK_NONBLOCK)
+    {
+    case SOCK_DGRAM:
+      sock->udp = udp_new();
+      if (!sock->udp)
+        return -ENOBUFS;
+      break;
+    case SOCK_STREAM:
+      sock->tcp = tcp_new();
+      if (!sock->tcp)
+        return -ENOBUFS;
+      break;
+    default:
+      return -EINVAL;
+    }
+
+  sock->type = type & ~SOCK_NONBLOCK;
+  sock->flags = type & SOCK_NONBLOCK;
+  sock->owner = current_task;
+  return fd;
+}
+
+int
+sys_bind (int fd, unsigned int addr, unsigned int port)
+{
+  struct socket *sock = socket_get(fd, 0);
+  if (!sock)
+    return -EBADF;
+
+  if (sock->type == SOCK_STREAM)
+    return tcp_bind(sock->tcp, addr, port);
+  return udp_bind(sock->udp, addr, port);
+}
+
+int
+sys_sendto (int fd, const void *buf, unsigned int len, const void *to)
+{
+  struct socket *sock = socket_get(fd, SOCK_DGRAM);
+  if (!sock)
+    return -EBADF;
+  if (len > UDP_PAYLOAD_MAX)
+    return -EMSGSIZE;
+  if (!mmu_user_range((unsigned int) buf, len))
+    return -EFAULT;
+
+  unsigned int ip;
+  unsigned short port;
+  int res = read_destination(to, &ip, &port);
+  if (res < 0)
+    return res;
+
+  struct pbuf *p = pbuf_alloc(PBUF_APP_HEADROOM, len);
+  if (!p)
+    return -ENOBUFS;
+
+  // a single pass copies the payload and sums it
+  unsigned int sum = chksum_take_pbuf(p, buf, len, 0);
+  res = udp_sendto_sum(sock->udp, p, sum, ip, port);
+  net_poll();
+  return res < 0 ? res : (int) len;
+}
+
+int
+sys_recvfrom (int fd, void *buf, unsigned int len, void *from)
+{
+  struct socket *sock = socket_get(fd, SOCK_DGRAM);
+  if (!sock)
+    return -EBADF;
+  if (!mmu_user_range((unsigned int) buf, len)
+      || (from && !mmu_user_range((unsigned int) from, sizeof(struct sockaddr_in))))
+    return -EFAULT;
+
+  net_poll();
+  int error;
+  struct pbuf *p = receive(sock, &error);
+  if (!p)
+    return error;
+
+  if (from)
+    {
+      struct sockaddr_in *sin = from;
+      sin->sin_family = AF_INET;
+      sin->sin_port = p->port;
+      sin->sin_addr = p->addr;
+    }
+
+  unsigned int n = pbuf_copy_out(p, 0, buf, len);
+  pbuf_free(p);
+  return n;
+}
+
+int
+sys_close (int fd)
+{
+  struct socket *sock = socket_get(fd, 0);
+  if (!sock)
+    return -EBADF;
+
+  if (sock->type == SOCK_STREAM)
+    tcp_close(sock->tcp);
+  else
+    udp_remove(sock->udp);
+
+  sock->type = 0;
+  sock->owner = 0;
+  sock->udp = 0;
+  sock->tcp = 0;
+  net_poll();
+  return 0;
+}
+
+int
+sys_recv_zc (int fd, void *msg)
+{
+  struct socket *sock = socket_get(fd, SOCK_DGRAM);
+  if (!sock)
+    return -EBADF;
+  if (!mmu_user_range((unsigned int) msg, sizeof(struct msg_zc)))
+    return -EFAULT;
+
+  // check for a free window page first, so no datagram is lost
+  struct pbuf **slots = lent[current_task - tasks];
+  unsigned int i;
+  for (i = 0; i < TASK_WINDOW_PAGES && slots[i]; ++i);
+  if (i == TASK_WINDOW_PAGES)
+    return -ENOBUFS;
+
+  net_poll();
+  int error;
+  struct pbuf *p = receive(sock, &error);
+  if (!p)
+    return error;
+
+  // received frames always fit a single buffer
+  struct msg_zc *m = msg;
+  m->length = p->len;
+  m->from.sin_family = AF_INET;
+  m->from.sin_port = p->port;
+  m->from.sin_addr = p->addr;
+  m->data = (const void*) window_lend(p, 0);
+  return 0;
+}
+
+int
+sys_zc_alloc (unsigned int len)
+{
+  if (len > UDP_PAYLOAD_MAX)
+    return -EMSGSIZE;
+
+  struct pbuf *p = pbuf_alloc(PBUF_APP_HEADROOM, len);
+  if (!p)
+    return -ENOBUFS;
+
+  unsigned int data = window_lend(p, 1);
+  if (!data)
+    {
+      pbuf_free(p);
+      return -ENOBUFS;
+    }
+
+  return data;
+}
+
+int
+sys_zc_free (unsigned int data)
+{
+  struct pbuf *p = window_return(data);
+  if (!p)
+    return -EINVAL;
+
+  pbuf_free(p);
+  return 0;
+}
+
+int
+sys_sendto_zc (int fd, unsigned int data, unsigned int len, const void *to)
+{
+  unsigned int ip;
+  unsigned short port;
+  struct socket *sock = socket_get(fd, SOCK_DGRAM);
+  int res = sock ? read_destination(to, &ip, &port) : -EBADF;
+
+  struct pbuf *p = window_return(data);
+  if (!p)
+    return -EINVAL;
+
+  if (res < 0 || len > p->len)
+    {
+      pbuf_free(p);
+      return res < 0 ? res : -EMSGSIZE;
+    }
+
+  pbuf_trim(p, len);
+  res = udp_sendto(sock->udp, p, ip, port);
+  net_poll();
+  return res < 0 ? res : (int) len;
+}
+
+int
+sys_connect (int fd, unsigned int addr, unsigned int port)
+{
+  struct socket *sock = socket_get(fd, SOCK_STREAM);
+  if (!sock)
+    return -EBADF;
+
+  struct tcp_pcb *pcb = sock->tcp;
+  if (pcb->state == TCP_CLOSED)
+    {
+      // a failed attempt is reported once
+      int res = pcb->error;
+      pcb->error = 0;
+      if (!res)
+        res = tcp_connect(pcb, addr, port);
+      if (res < 0)
+        return res;
+      net_poll();
+    }
+
+  if (pcb->state == TCP_SYN_SENT || pcb->state == TCP_SYN_RCVD)
+    return socket_block(sock, &pcb->writers);
+
+  return 0;
+}
+
+int
+sys_listen (int fd, int backlog)
+{
+  struct socket *sock = socket_get(fd, SOCK_STREAM);
+  if (!sock)
+    return -EBADF;
+
+  return tcp_listen(sock->tcp, backlog > 0 ? backlog : 1);
+}
+
+int
+sys_accept (int fd, void *from)
+{
+  struct socket *sock = socket_get(fd, SOCK_STREAM);
+  if (!sock)
+    return -EBADF;
+  if (sock->tcp->state != TCP_LISTEN)
+    return -EINVAL;
+  if (from && !mmu_user_range((unsigned int) from, sizeof(struct sockaddr_in)))
+    return -EFAULT;
+
+  // a connection is only taken once it can be handed out
+  int child = socket_alloc();
+  if (child < 0)
+    return child;
+
+  net_poll();
+  struct tcp_pcb *pcb = tcp_accept(sock->tcp);
+  if (!pcb)
+    return socket_block(sock, &sock->tcp->readers);
+
+  sockets[child].type = SOCK_STREAM;
+  sockets[child].flags = sock->flags;
+  sockets[child].owner = current_task;
+  sockets[child].tcp = pcb;
+
+  if (from)
+    {
+      struct sockaddr_in *sin = from;
+      sin->sin_family = AF_INET;
+      sin->sin_port = pcb->remote_port;
+      sin->sin_addr = pcb->remote_ip;
+    }
+
+  return child;
+}
+
+int
+sys_send (int fd, const void *buf, unsigned int len)
+{
+  struct socket *sock = socket_get(fd, SOCK_STREAM);
+  if (!sock)
+    return -EBADF;
+  if (!mmu_user_range((unsigned int) buf, len))
+    return -EFAULT;
+
+  int res = tcp_write(sock->tcp, buf, len);
+  if (res > 0)
+    {
+      tcp_output(sock->tcp);
+      net_poll();
+    }
+  else if (!res && len)
+    return socket_block(sock, &sock->tcp->writers);
+
+  return res;
+}
+
+int
+sys_recv (int fd, void *buf, unsigned int len)
+{
+  struct socket *sock = socket_get(fd, SOCK_STREAM);
+  if (!sock)
+    return -EBADF;
+  if (!mmu_user_range((unsigned int) buf, len))
+    return -EFAULT;
+
+  net_poll();
+  int res = tcp_read(sock->tcp, buf, len);
+  if (res == -EAGAIN)
+    return socket_block(sock, &sock->tcp->readers);
+
+  net_poll();
+  return res;
+}
+
+int
+sys_setsockopt (int fd, int level, int name, int value)
+{
+  struct socket *sock = socket_get(fd, 0);
+  if (!sock)
+    return -EBADF;
+
+  if (sock->type == SOCK_STREAM && level == IPPROTO_TCP && name == TCP_NODELAY)
+    {
+      tcp_nodelay(sock->tcp, value);
+      return 0;
+    }
+
+  return -EINVAL;
+}
+
+void
+socket_release_task (void)
+{
+  int fd;
+  for (fd = 0; fd < SOCKET_MAX; ++fd)
+    if (sockets[fd].type && sockets[fd].owner == current_task)
+      sys_close(fd);
+
+  unsigned int i;
+  for (i = 0; i < TASK_WINDOW_PAGES; ++i)
+    {
+      struct pbuf *p = window_return(window_address(i));
+      if (p)
+        pbuf_free(p);
+    }
+}
@@ -0,0 +1,53 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the kernel side of the socket syscalls, see kernel/syscall.h for the
+ * interface seen by tasks. sockets belong to the task that created them and
+ * are closed when it exits.
+ */
+
+#define SOCKET_MAX 16
+
+int sys_socket (int type);
+int sys_bind (int fd, unsigned int addr, unsigned int port);
+int sys_sendto (int fd, const void *buf, unsigned int len, const void *to);
+int sys_recvfrom (int fd, void *buf, unsigned int len, void *from);
+int sys_close (int fd);
+int sys_recv_zc (int fd, void *msg);
+int sys_zc_alloc (unsigned int len);
+int sys_zc_free (unsigned int data);
+int sys_sendto_zc (int fd, unsigned int data, unsigned int len, const void *to);
+int sys_connect (int fd, unsigned int addr, unsigned int port);
+int sys_listen (int fd, int backlog);
+int sys_accept (int fd, void *from);
+int sys_send (int fd, const void *buf, unsigned int len);
+int sys_recv (int fd, void *buf, unsigned int len);
+int sys_setsockopt (int fd, int level, int name, int value);
+
+/* close the sockets of an exiting task and take back its lent buffers,
+ * called with the task still current
+ */
+void socket_release_task (void);
@@ -0,0 +1,1504 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "tcp.h"
+
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+
+// pcb flags
+#define TF_ACK_DELAY 0x01  // an acknowledgement is owed, the ack timer runs
+#define TF_ACK_NOW   0x02  // acknowledge on the next output
+#define TF_NODELAY   0x04  // nagle is disabled
+#define TF_RECOVERY  0x08  // in fast recovery
+#define TF_TIMING    0x10  // the segment at rtt_seq is timed
+#define TF_DETACHED  0x20  // the socket is gone, the pcb is freed once closed
+#define TF_FIN       0x40  // a fin is queued
+#define TF_RCVD_FIN  0x80  // the peer has closed its side
+
+// the fields of a received segment in host byte order
+struct tcp_in
+{
+  unsigned int seq;
+  unsigned int ack;
+  unsigned int wnd;
+  unsigned int len;  // payload bytes
+  unsigned char flags;
+  unsigned short mss;
+};
+
+static struct tcp_pcb pcbs[TCP_PCB_MAX] = { { 0 } };
+static struct tcp_seg segs[TCP_SEG_MAX] = { { 0 } };
+static struct tcp_seg *free_segs = 0;
+
+// connections hashed by the 4-tuple, listening pcbs by the local port
+static struct tcp_pcb *hash_table[TCP_HASH_SIZE] = { 0 };
+static struct tcp_pcb *listen_table[TCP_HASH_SIZE] = { 0 };
+
+static unsigned short next_ephemeral = TCP_PORT_EPHEMERAL;
+static unsigned int iss_offset = 0;
+static struct tcp_stats stats = { 0 };
+
+static void tcp_rtx_timeout (void *arg);
+static void tcp_ack_timeout (void *arg);
+static void tcp_linger_timeout (void *arg);
+
+static inline unsigned int
+min (unsigned int a, unsigned int b)
+{
+  return a < b ? a : b;
+}
+
+static inline unsigned int
+max (unsigned int a, unsigned int b)
+{
+  return a > b ? a : b;
+}
+
+static inline unsigned int
+tcp_hash (unsigned int lip, unsigned short lport, unsigned int rip,
+          unsigned short rport)
+{
+  unsigned int h = lip ^ rip ^ ((unsigned int) lport << 16) ^ rport;
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return h & (TCP_HASH_SIZE - 1);
+}
+
+static inline unsigned int
+seg_seqlen (const struct tcp_seg *seg)
+{
+  return seg->len + ((seg->flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+}
+
+static struct tcp_seg*
+seg_alloc (void)
+{
+  struct tcp_seg *seg = free_segs;
+  if (seg)
+    {
+      free_segs = seg->next;
+      seg->next = 0;
+    }
+
+  return seg;
+}
+
+static void
+seg_free (struct tcp_seg *seg)
+{
+  if (seg->p)
+    pbuf_free(seg->p);
+  seg->p = 0;
+  seg->next = free_segs;
+  free_segs = seg;
+}
+
+static void
+seg_free_list (struct tcp_seg *seg)
+{
+  while (seg)
+    {
+      struct tcp_seg *next = seg->next;
+      seg_free(seg);
+      seg = next;
+    }
+}
+
+static struct tcp_pcb*
+tcp_lookup (unsigned int lip, unsigned short lport, unsigned int rip,
+            unsigned short rport)
+{
+  struct tcp_pcb *pcb = hash_table[tcp_hash(lip, lport, rip, rport)];
+  for (; pcb; pcb = pcb->hash_next)
+    if (pcb->local_port == lport && pcb->remote_port == rport
+        && pcb->local_ip == lip && pcb->remote_ip == rip)
+      return pcb;
+
+  return 0;
+}
+
+// listeners bound to the destination address take precedence over
+// listeners bound to any address
+static struct tcp_pcb*
+tcp_lookup_listen (unsigned int ip, unsigned short port)
+{
+  struct tcp_pcb *any = 0;
+  struct tcp_pcb *pcb = listen_table[tcp_hash(0, port, 0, 0)];
+  for (; pcb; pcb = pcb->hash_next)
+    if (pcb->local_port == port)
+      {
+        if (pcb->local_ip == ip)
+          return pcb;
+        if (pcb->local_ip == IP4_ANY)
+          any = pcb;
+      }
+
+  return any;
+}
+
+static void
+tcp_hash_insert (struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **bucket = pcb->state == TCP_LISTEN
+    ? &listen_table[tcp_hash(0, pcb->local_port, 0, 0)]
+    : &hash_table[tcp_hash(pcb->local_ip, pcb->local_port, pcb->remote_ip,
+                           pcb->remote_port)];
+  pcb->hash_next = *bucket;
+  *bucket = pcb;
+}
+
+static void
+tcp_unhash (struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **pos = pcb->state == TCP_LISTEN
+    ? &listen_table[tcp_hash(0, pcb->local_port, 0, 0)]
+    : &hash_table[tcp_hash(pcb->local_ip, pcb->local_port, pcb->remote_ip,
+                           pcb->remote_port)];
+  for (; *pos; pos = &(*pos)->hash_next)
+    if (*pos == pcb)
+      {
+        *pos = pcb->hash_next;
+        break;
+      }
+
+  pcb->hash_next = 0;
+}
+
+static int
+tcp_port_used (unsigned int ip, unsigned short port)
+{
+  // only bound and listening pcbs own a port, connections share the port of
+  // their listener
+  unsigned int i;
+  for (i = 0; i < TCP_PCB_MAX; ++i)
+    if (pcbs[i].used && pcbs[i].local_port == port && !pcbs[i].remote_port
+        && (pcbs[i].local_ip == ip || !pcbs[i].local_ip || !ip))
+      return 1;
+
+  return 0;
+}
+
+// clock driven initial sequence numbers, advancing by 64000 per connection
+static unsigned int
+tcp_next_iss (void)
+{
+  iss_offset += 64000;
+  return tick_count * (TICK_US / 4) + iss_offset;
+}
+
+static void
+tcp_wake (struct tcp_pcb *pcb)
+{
+  wake_up(&pcb->readers);
+  wake_up(&pcb->writers);
+}
+
+// the window announced to the peer, the right edge only moves by a useful
+// amount to avoid the silly window syndrome
+static unsigned int
+tcp_window (struct tcp_pcb *pcb)
+{
+  unsigned int edge = pcb->rcv_nxt + TCP_WND - pcb->recv_queued;
+  if (TCP_SEQ_GEQ(edge, pcb->rcv_adv + min(TCP_WND / 2, pcb->mss)))
+    pcb->rcv_adv = edge;
+
+  return min(pcb->rcv_adv - pcb->rcv_nxt, 0xFFFF);
+}
+
+static void
+tcp_build_header (struct tcp_pcb *pcb, struct tcp_hdr *tcp, unsigned int seq,
+                  unsigned char flags, unsigned int hlen)
+{
+  if (pcb->state != TCP_SYN_SENT)
+    flags |= TCP_ACK;
+
+  tcp->src = pcb->local_port;
+  tcp->dst = pcb->remote_port;
+  tcp->seq = htonl(seq);
+  tcp->ack = htonl(pcb->rcv_nxt);
+  tcp->off = (hlen / 4) << 4;
+  tcp->flags = flags;
+  tcp->wnd = htons(tcp_window(pcb));
+  tcp->chksum = 0;
+  tcp->urp = 0;
+}
+
+// every segment carries the current acknowledgement
+static void
+tcp_acked (struct tcp_pcb *pcb)
+{
+  pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
+  pcb->acks_pending = 0;
+  timeout_del(&pcb->ack_timer);
+}
+
+// send a segment without payload
+static void
+tcp_send_empty (struct tcp_pcb *pcb, unsigned int seq, unsigned char flags)
+{
+  struct pbuf *p = pbuf_alloc_small(PBUF_TRANSPORT_HEADROOM, TCP_HLEN);
+  if (!p)
+    return;
+
+  struct tcp_hdr *tcp = (struct tcp_hdr*)p->payload;
+  tcp_build_header(pcb, tcp, seq, flags, TCP_HLEN);
+  tcp->chksum = chksum_fold(chksum_add(0, tcp, TCP_HLEN)
+                + chksum_pseudo(pcb->local_ip, pcb->remote_ip, IP_PROTO_TCP,
+                                TCP_HLEN));
+
+  tcp_acked(pcb);
+  if (flags & TCP_RST)
+    stats.resets++;
+  stats.tx++;
+  ip_output(p, pcb->local_ip, pcb->remote_ip, IP_PROTO_TCP);
+}
+
+// answer a segment that belongs to no connection
+static void
+tcp_rst_reply (const struct ip_hdr *iph, const struct tcp_hdr *tcp,
+               const struct tcp_in *in)
+{
+  struct pbuf *p = pbuf_alloc_small(PBUF_TRANSPORT_HEADROOM, TCP_HLEN);
+  if (!p)
+    return;
+
+  struct tcp_hdr *rst = (struct tcp_hdr*)p->payload;
+  rst->src = tcp->dst;
+  rst->dst = tcp->src;
+  if (in->flags & TCP_ACK)
+    {
+      rst->seq = htonl(in->ack);
+      rst->ack = 0;
+      rst->flags = TCP_RST;
+    }
+  else
+    {
+      unsigned int seqlen = in->len + ((in->flags & TCP_SYN) ? 1 : 0)
+                          + ((in->flags & TCP_FIN) ? 1 : 0);
+      rst->seq = 0;
+      rst->ack = htonl(in->seq + seqlen);
+      rst->flags = TCP_RST | TCP_ACK;
+    }
+  rst->off = (TCP_HLEN / 4) << 4;
+  rst->wnd = 0;
+  rst->chksum = 0;
+  rst->urp = 0;
+  rst->chksum = chksum_fold(chksum_add(0, rst, TCP_HLEN)
+                + chksum_pseudo(iph->dst, iph->src, IP_PROTO_TCP, TCP_HLEN));
+
+  stats.resets++;
+  stats.tx++;
+  ip_output(p, iph->dst, iph->src, IP_PROTO_TCP);
+}
+
+/* build the header in front of the payload of a queued segment and pass a
+ * reference to the ip layer, the segment keeps its own reference for
+ * retransmissions
+ */
+static int
+tcp_transmit (struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct pbuf *p = seg->p;
+
+  // a previous transmission still waits in a queue below
+  if (p->ref > 1)
+    return -EAGAIN;
+
+  unsigned int hlen = TCP_HLEN + ((seg->flags & TCP_SYN) ? 4 : 0);
+  pbuf_header(p, -(int)(seg->data - p->payload));
+  pbuf_header(p, hlen);
+
+  struct tcp_hdr *tcp = (struct tcp_hdr*)p->payload;
+  tcp_build_header(pcb, tcp, seg->seq, seg->flags, hlen);
+  if (seg->flags & TCP_SYN)
+    {
+      unsigned char *opt = (unsigned char*)(tcp + 1);
+      opt[0] = 2;  // maximum segment size
+      opt[1] = 4;
+      opt[2] = pcb->mss >> 8;
+      opt[3] = pcb->mss & 0xFF;
+    }
+
+  tcp->chksum = chksum_fold(seg->sum + chksum_add(0, tcp, hlen)
+                + chksum_pseudo(pcb->local_ip, pcb->remote_ip, IP_PROTO_TCP,
+                                p->tot_len));
+
+  pbuf_ref(p);
+  stats.tx++;
+  return ip_output(p, pcb->local_ip, pcb->remote_ip, IP_PROTO_TCP);
+}
+
+// queue an empty segment for a syn or a fin
+static int
+tcp_enqueue_flags (struct tcp_pcb *pcb, unsigned char flags)
+{
+  struct tcp_seg *seg = seg_alloc();
+  if (!seg)
+    return -ENOBUFS;
+
+  // segments with flags never take payload, see tcp_write
+  seg->p = pbuf_alloc_small(PBUF_APP_HEADROOM, 0);
+  if (!seg->p)
+    {
+      seg_free(seg);
+      return -ENOBUFS;
+    }
+
+  seg->data = seg->p->payload;
+  seg->seq = pcb->snd_lbb++;
+  seg->len = 0;
+  seg->flags = flags;
+  seg->sum = 0;
+
+  if (pcb->unsent)
+    pcb->unsent_tail->next = seg;
+  else
+    pcb->unsent = seg;
+  pcb->unsent_tail = seg;
+
+  if (flags & TCP_FIN)
+    pcb->flags |= TF_FIN;
+  return 0;
+}
+
+static void
+tcp_rtt_sample (struct tcp_pcb *pcb, int rtt)
+{
+  if (!pcb->srtt)
+    {
+      pcb->srtt = rtt << 3;
+      pcb->rttvar = rtt << 1;
+    }
+  else
+    {
+      // srtt += (rtt - srtt) / 8, rttvar += (|rtt - srtt| - rttvar) / 4
+      int delta = rtt - (pcb->srtt >> 3);
+      pcb->srtt += delta;
+      if (delta < 0)
+        delta = -delta;
+      pcb->rttvar += delta - (pcb->rttvar >> 2);
+    }
+
+  unsigned int rto = (pcb->srtt >> 3) + pcb->rttvar;
+  pcb->rto = min(max(rto, MS_TO_TICKS(TCP_RTO_MIN_MS)),
+                 MS_TO_TICKS(TCP_RTO_MAX_MS));
+}
+
+static void
+tcp_free_acked (struct tcp_pcb *pcb, struct tcp_seg **head,
+                struct tcp_seg **tail, unsigned int ack)
+{
+  while (*head && TCP_SEQ_LEQ((*head)->seq + seg_seqlen(*head), ack))
+    {
+      struct tcp_seg *seg = *head;
+      *head = seg->next;
+      pcb->snd_queued -= seg->len;
+      seg_free(seg);
+    }
+
+  if (!*head)
+    *tail = 0;
+}
+
+// advance snd_una and release the acknowledged segments
+static void
+tcp_ack_segments (struct tcp_pcb *pcb, unsigned int ack)
+{
+  pcb->snd_una = ack;
+  if (TCP_SEQ_GT(ack, pcb->snd_nxt))
+    pcb->snd_nxt = ack;
+  pcb->retries = 0;
+
+  // karn's algorithm, timing is cancelled when a segment is retransmitted
+  if ((pcb->flags & TF_TIMING) && TCP_SEQ_GT(ack, pcb->rtt_seq))
+    {
+      tcp_rtt_sample(pcb, tick_count - pcb->rtt_start);
+      pcb->flags &= ~TF_TIMING;
+    }
+
+  // after a timeout segments that were sent already are on the unsent queue
+  tcp_free_acked(pcb, &pcb->unacked, &pcb->unacked_tail, ack);
+  tcp_free_acked(pcb, &pcb->unsent, &pcb->unsent_tail, ack);
+
+  if (pcb->unacked)
+    timeout_add(&pcb->rtx_timer, pcb->rto);
+  else
+    timeout_del(&pcb->rtx_timer);
+
+  wake_up(&pcb->writers);
+}
+
+static void
+tcp_rexmit_first (struct tcp_pcb *pcb)
+{
+  if (!pcb->unacked)
+    return;
+
+  pcb->flags &= ~TF_TIMING;
+  stats.retransmits++;
+  tcp_transmit(pcb, pcb->unacked);
+}
+
+static void
+tcp_dupack (struct tcp_pcb *pcb)
+{
+  // every duplicate ack in recovery means a segment left the network
+  if (pcb->flags & TF_RECOVERY)
+    {
+      pcb->cwnd += pcb->mss;
+      return;
+    }
+
+  if (++pcb->dupacks != 3)
+    return;
+
+  // newreno, losses of the window that was recovered from do not count
+  if (!TCP_SEQ_GT(pcb->snd_una, pcb->recover))
+    return;
+
+  stats.fast_retransmits++;
+  pcb->ssthresh = max((pcb->snd_max - pcb->snd_una) / 2, 2 * pcb->mss);
+  pcb->recover = pcb->snd_max;
+  pcb->flags |= TF_RECOVERY;
+  tcp_rexmit_first(pcb);
+  pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
+}
+
+static void
+tcp_receive_ack (struct tcp_pcb *pcb, const struct tcp_in *in)
+{
+  int window_update = 0;
+  if (TCP_SEQ_LT(pcb->snd_wl1, in->seq)
+      || (pcb->snd_wl1 == in->seq && TCP_SEQ_LEQ(pcb->snd_wl2, in->ack)))
+    {
+      window_update = pcb->snd_wnd != in->wnd;
+      pcb->snd_wnd = in->wnd;
+      pcb->snd_wl1 = in->seq;
+      pcb->snd_wl2 = in->ack;
+    }
+
+  if (TCP_SEQ_LEQ(in->ack, pcb->snd_una))
+    {
+      if (in->ack == pcb->snd_una && !in->len && !window_update
+          && !(in->flags & (TCP_SYN | TCP_FIN)) && pcb->unacked)
+        tcp_dupack(pcb);
+      return;
+    }
+
+  unsigned int acked = in->ack - pcb->snd_una;
+  tcp_ack_segments(pcb, in->ack);
+  pcb->dupacks = 0;
+
+  if (pcb->flags & TF_RECOVERY)
+    {
+      if (TCP_SEQ_GEQ(in->ack, pcb->recover))
+        {
+          // full acknowledgement, deflate the window
+          pcb->cwnd = min(pcb->ssthresh,
+                          pcb->snd_max - pcb->snd_una + pcb->mss);
+          pcb->flags &= ~TF_RECOVERY;
+        }
+      else
+        {
+          // partial acknowledgement, the next segment was lost as well
+          tcp_rexmit_first(pcb);
+          pcb->cwnd -= min(pcb->cwnd, acked);
+          pcb->cwnd += pcb->mss;
+        }
+    }
+  else if (pcb->cwnd < pcb->ssthresh)
+    pcb->cwnd += min(acked, pcb->mss);
+  else
+    pcb->cwnd += max(pcb->mss * pcb->mss / pcb->cwnd, 1);
+}
+
+static void
+tcp_established (struct tcp_pcb *pcb)
+{
+  pcb->state = TCP_ESTABLISHED;
+  pcb->cwnd = min(4 * pcb->mss, max(2 * pcb->mss, 4380));
+  tcp_wake(pcb);
+}
+
+static void
+tcp_set_mss (struct tcp_pcb *pcb, unsigned short peer, struct netif *netif)
+{
+  unsigned int mss = min(TCP_MSS, netif->mtu - IP_HLEN - TCP_HLEN);
+  if (peer && peer < mss)
+    mss = peer;
+  pcb->mss = max(mss, 64);
+}
+
+static unsigned short
+tcp_parse_mss (const struct tcp_hdr *tcp, unsigned int hlen)
+{
+  const unsigned char *opt = (const unsigned char*)(tcp + 1);
+  const unsigned char *end = (const unsigned char*)tcp + hlen;
+
+  while (opt < end && *opt)
+    {
+      if (*opt == 1)
+        {
+          ++opt;
+          continue;
+        }
+      if (opt + 1 >= end || opt[1] < 2 || opt + opt[1] > end)
+        break;
+      if (opt[0] == 2 && opt[1] == 4)
+        return (opt[2] << 8) | opt[3];
+      opt += opt[1];
+    }
+
+  return 536;  // the default of rfc 879
+}
+
+static void
+tcp_free (struct tcp_pcb *pcb)
+{
+  timeout_del(&pcb->rtx_timer);
+  timeout_del(&pcb->ack_timer);
+  timeout_del(&pcb->linger_timer);
+  tcp_unhash(pcb);
+
+  seg_free_list(pcb->unsent);
+  seg_free_list(pcb->unacked);
+  seg_free_list(pcb->ooseq);
+  while (pcb->recv_queue)
+    {
+      struct pbuf *p = pcb->recv_queue;
+      pcb->recv_queue = p->link;
+      p->link = 0;
+      pbuf_free(p);
+    }
+
+  struct tcp_pcb *listener = pcb->listener;
+  if (listener)
+    {
+      struct tcp_pcb **pos = &listener->accept_queue;
+      for (; *pos; pos = &(*pos)->accept_next)
+        if (*pos == pcb)
+          {
+            *pos = pcb->accept_next;
+            break;
+          }
+      listener->children--;
+    }
+
+  tcp_wake(pcb);
+  pcb->used = 0;
+}
+
+// the connection is over, it is freed unless a socket still refers to it
+static void
+tcp_set_closed (struct tcp_pcb *pcb)
+{
+  if (pcb->flags & TF_DETACHED || pcb->listener)
+    {
+      tcp_free(pcb);
+      return;
+    }
+
+  timeout_del(&pcb->rtx_timer);
+  timeout_del(&pcb->ack_timer);
+  timeout_del(&pcb->linger_timer);
+  tcp_unhash(pcb);
+  pcb->state = TCP_CLOSED;
+
+  seg_free_list(pcb->unsent);
+  seg_free_list(pcb->unacked);
+  seg_free_list(pcb->ooseq);
+  pcb->unsent = pcb->unsent_tail = 0;
+  pcb->unacked = pcb->unacked_tail = 0;
+  pcb->ooseq = 0;
+  pcb->ooseq_count = 0;
+  pcb->snd_queued = 0;
+  tcp_wake(pcb);
+}
+
+static void
+tcp_abort (struct tcp_pcb *pcb, int error)
+{
+  if (pcb->state >= TCP_SYN_RCVD && pcb->state != TCP_TIME_WAIT)
+    tcp_send_empty(pcb, pcb->snd_nxt, TCP_RST);
+
+  pcb->error = error;
+  tcp_set_closed(pcb);
+}
+
+static void
+tcp_ack_delayed (struct tcp_pcb *pcb)
+{
+  // every second full segment is acknowledged at once, rfc 1122
+  if (++pcb->acks_pending >= 2)
+    pcb->flags |= TF_ACK_NOW;
+  else if (!(pcb->flags & TF_ACK_DELAY))
+    {
+      pcb->flags |= TF_ACK_DELAY;
+      timeout_add(&pcb->ack_timer, MS_TO_TICKS(TCP_DELACK_MS));
+    }
+}
+
+static void
+tcp_deliver (struct tcp_pcb *pcb, struct pbuf *p, unsigned int len)
+{
+  if (!len)
+    {
+      pbuf_free(p);
+      return;
+    }
+
+  pbuf_trim(p, len);
+  p->link = 0;
+  if (pcb->recv_queue)
+    pcb->recv_tail->link = p;
+  else
+    pcb->recv_queue = p;
+  pcb->recv_tail = p;
+
+  pcb->recv_queued += len;
+  pcb->rcv_nxt += len;
+}
+
+static void
+tcp_ooseq_insert (struct tcp_pcb *pcb, const struct tcp_in *in,
+                  unsigned int seq, unsigned int len, struct pbuf *p)
+{
+  struct tcp_seg *seg = 0;
+  if (pcb->ooseq_count < TCP_OOSEQ_MAX)
+    seg = seg_alloc();
+  if (!seg)
+    {
+      stats.drop_ooseq++;
+      pbuf_free(p);
+      return;
+    }
+
+  // overlapping segments are kept and trimmed once they are in order
+  struct tcp_seg **pos = &pcb->ooseq;
+  while (*pos && TCP_SEQ_LEQ((*pos)->seq, seq))
+    pos = &(*pos)->next;
+
+  seg->p = p;
+  seg->data = p->payload;
+  seg->seq = seq;
+  seg->len = len;
+  seg->flags = in->flags & TCP_FIN;
+  seg->sum = 0;
+  seg->next = *pos;
+  *pos = seg;
+  pcb->ooseq_count++;
+}
+
+static void
+tcp_receive_data (struct tcp_pcb *pcb, const struct tcp_in *in, struct pbuf *p)
+{
+  unsigned int seq = in->seq;
+  unsigned int len = in->len;
+  int fin = in->flags & TCP_FIN;
+
+  // strip what was received before
+  if (TCP_SEQ_LT(seq, pcb->rcv_nxt))
+    {
+      unsigned int dup = pcb->rcv_nxt - seq;
+      if (dup > len || (dup == len && !fin) || pbuf_header(p, -(int) dup))
+        {
+          pcb->flags |= TF_ACK_NOW;
+          pbuf_free(p);
+          return;
+        }
+      len -= dup;
+      seq = pcb->rcv_nxt;
+    }
+
+  // strip what does not fit the window
+  unsigned int room = pcb->rcv_adv - seq;
+  if (len > room)
+    {
+      len = room;
+      fin = 0;
+    }
+
+  if (seq != pcb->rcv_nxt)
+    {
+      // ask for the missing data with a duplicate ack
+      tcp_ooseq_insert(pcb, in, seq, len, p);
+      pcb->flags |= TF_ACK_NOW;
+      return;
+    }
+
+  tcp_deliver(pcb, p, len);
+
+  int filled = 0;
+  while (pcb->ooseq && TCP_SEQ_LEQ(pcb->ooseq->seq, pcb->rcv_nxt) && !fin)
+    {
+      struct tcp_seg *seg = pcb->ooseq;
+      pcb->ooseq = seg->next;
+      pcb->ooseq_count--;
+
+      unsigned int end = seg->seq + seg->len;
+      if (TCP_SEQ_GEQ(end, pcb->rcv_nxt))
+        {
+          pbuf_header(seg->p, -(int)(pcb->rcv_nxt - seg->seq));
+          tcp_deliver(pcb, seg->p, end - pcb->rcv_nxt);
+          seg->p = 0;
+          fin = seg->flags & TCP_FIN;
+          filled = 1;
+        }
+      seg_free(seg);
+    }
+
+  if (fin)
+    {
+      pcb->rcv_nxt++;
+      pcb->flags |= TF_RCVD_FIN | TF_ACK_NOW;
+      switch (pcb->state)
+        {
+        case TCP_ESTABLISHED:
+          pcb->state = TCP_CLOSE_WAIT;
+          break;
+        case TCP_FIN_WAIT_1:
+          pcb->state = TCP_CLOSING;
+          break;
+        case TCP_FIN_WAIT_2:
+          pcb->state = TCP_TIME_WAIT;
+          timeout_add(&pcb->linger_timer, MS_TO_TICKS(2 * TCP_MSL_MS));
+          break;
+        default:
+          break;
+        }
+      tcp_wake(pcb);
+    }
+  else if (len || filled)
+    {
+      // a segment that fills a gap is acknowledged at once, rfc 5681
+      if (filled)
+        pcb->flags |= TF_ACK_NOW;
+      else
+        tcp_ack_delayed(pcb);
+      wake_up(&pcb->readers);
+    }
+}
+
+// a syn for a listening pcb opens a new connection in SYN_RCVD
+static void
+tcp_listen_input (struct tcp_pcb *lpcb, struct netif *netif,
+                  const struct ip_hdr *iph, const struct tcp_hdr *tcp,
+                  const struct tcp_in *in)
+{
+  if (in->flags & TCP_RST)
+    return;
+  if (in->flags & TCP_ACK)
+    {
+      tcp_rst_reply(iph, tcp, in);
+      return;
+    }
+  if (!(in->flags & TCP_SYN) || lpcb->children >= lpcb->backlog)
+    return;
+
+  struct tcp_pcb *pcb = tcp_new();
+  if (!pcb)
+    return;
+
+  pcb->local_ip = iph->dst;
+  pcb->local_port = tcp->dst;
+  pcb->remote_ip = iph->src;
+  pcb->remote_port = tcp->src;
+  pcb->flags |= lpcb->flags & TF_NODELAY;
+  pcb->listener = lpcb;
+  lpcb->children++;
+
+  pcb->state = TCP_SYN_RCVD;
+  pcb->irs = in->seq;
+  pcb->rcv_nxt = in->seq + 1;
+  pcb->rcv_adv = pcb->rcv_nxt + TCP_WND;
+  pcb->snd_wnd = in->wnd;
+  pcb->snd_wl1 = in->seq;
+  pcb->snd_wl2 = pcb->iss;
+  tcp_set_mss(pcb, in->mss, netif);
+  tcp_hash_insert(pcb);
+
+  if (tcp_enqueue_flags(pcb, TCP_SYN) < 0)
+    {
+      tcp_free(pcb);
+      return;
+    }
+  tcp_output(pcb);
+}
+
+static void
+tcp_syn_sent_input (struct tcp_pcb *pcb, struct netif *netif,
+                    const struct tcp_in *in)
+{
+  int ack_ok = (in->flags & TCP_ACK) && TCP_SEQ_GT(in->ack, pcb->iss)
+            && TCP_SEQ_LEQ(in->ack, pcb->snd_max);
+
+  if (in->flags & TCP_RST)
+    {
+      if (ack_ok)
+        tcp_abort(pcb, -ECONNREFUSED);
+      return;
+    }
+  if (!(in->flags & TCP_SYN) || ((in->flags & TCP_ACK) && !ack_ok))
+    return;
+
+  pcb->irs = in->seq;
+  pcb->rcv_nxt = in->seq + 1;
+  pcb->rcv_adv = pcb->rcv_nxt + TCP_WND;
+  pcb->snd_wnd = in->wnd;
+  pcb->snd_wl1 = in->seq;
+  pcb->snd_wl2 = in->ack;
+  tcp_set_mss(pcb, in->mss, netif);
+  pcb->flags |= TF_ACK_NOW;
+
+  if (ack_ok)
+    {
+      tcp_ack_segments(pcb, in->ack);
+      tcp_established(pcb);
+    }
+  else
+    {
+      // simultaneous open, send the syn again with an ack
+      pcb->state = TCP_SYN_RCVD;
+      if (pcb->unacked)
+        {
+          pcb->unacked->next = pcb->unsent;
+          pcb->unsent = pcb->unacked;
+          if (!pcb->unsent_tail)
+            pcb->unsent_tail = pcb->unacked;
+          pcb->unacked = pcb->unacked_tail = 0;
+          pcb->snd_nxt = pcb->snd_una;
+        }
+    }
+
+  tcp_output(pcb);
+}
+
+static void
+tcp_process (struct tcp_pcb *pcb, const struct ip_hdr *iph,
+             const struct tcp_hdr *tcp, const struct tcp_in *in,
+             struct pbuf *p)
+{
+  // acceptable if the segment is not entirely old and starts inside the
+  // window, the right edge is included so pure acks at the edge count
+  unsigned int seqlen = in->len + ((in->flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+  if (TCP_SEQ_LT(in->seq + seqlen, pcb->rcv_nxt)
+      || TCP_SEQ_GT(in->seq, pcb->rcv_adv)
+      || (seqlen && in->seq + seqlen == pcb->rcv_nxt && in->len))
+    {
+      if (!(in->flags & TCP_RST))
+        {
+          pcb->flags |= TF_ACK_NOW;
+          tcp_output(pcb);
+        }
+      goto drop;
+    }
+
+  if (in->flags & TCP_RST)
+    {
+      // only a reset at the expected sequence number is taken, rfc 5961
+      if (in->seq == pcb->rcv_nxt)
+        tcp_abort(pcb, pcb->state == TCP_SYN_RCVD ? -ECONNREFUSED
+                                                   : -ECONNRESET);
+      else
+        {
+          pcb->flags |= TF_ACK_NOW;
+          tcp_output(pcb);
+        }
+      goto drop;
+    }
+
+  if ((in->flags & TCP_SYN) || !(in->flags & TCP_ACK))
+    {
+      if (in->flags & TCP_SYN)
+        {
+          pcb->flags |= TF_ACK_NOW;
+          tcp_output(pcb);
+        }
+      goto drop;
+    }
+
+  if (TCP_SEQ_GT(in->ack, pcb->snd_max))
+    {
+      pcb->flags |= TF_ACK_NOW;
+      tcp_output(pcb);
+      goto drop;
+    }
+
+  if (pcb->state == TCP_SYN_RCVD)
+    {
+      if (TCP_SEQ_LEQ(in->ack, pcb->snd_una))
+        {
+          tcp_rst_reply(iph, tcp, in);
+          goto drop;
+        }
+
+      tcp_established(pcb);
+      struct tcp_pcb *listener = pcb->listener;
+      if (listener)
+        {
+          struct tcp_pcb **pos = &listener->accept_queue;
+          while (*pos)
+            pos = &(*pos)->accept_next;
+          *pos = pcb;
+          pcb->accept_next = 0;
+          wake_up(&listener->readers);
+        }
+    }
+
+  tcp_receive_ack(pcb, in);
+
+  // our fin was acknowledged
+  if ((pcb->flags & TF_FIN) && pcb->snd_una == pcb->snd_lbb)
+    switch (pcb->state)
+      {
+      case TCP_FIN_WAIT_1:
+        pcb->state = TCP_FIN_WAIT_2;
+        timeout_add(&pcb->linger_timer, MS_TO_TICKS(TCP_FIN_WAIT_MS));
+        break;
+      case TCP_CLOSING:
+        pcb->state = TCP_TIME_WAIT;
+        timeout_add(&pcb->linger_timer, MS_TO_TICKS(2 * TCP_MSL_MS));
+        break;
+      case TCP_LAST_ACK:
+        tcp_set_closed(pcb);
+        goto drop;
+      default:
+        break;
+      }
+
+  // a segment that starts before rcv_nxt or a fin after the peer's fin was
+  // sent again, so our ack got lost. it is acknowledged right away, in any
+  // state, and time wait starts over to catch the next retransmission.
+  if (TCP_SEQ_LT(in->seq, pcb->rcv_nxt)
+      || ((in->flags & TCP_FIN) && (pcb->flags & TF_RCVD_FIN)))
+    {
+      pcb->flags |= TF_ACK_NOW;
+      if (pcb->state == TCP_TIME_WAIT)
+        timeout_add(&pcb->linger_timer, MS_TO_TICKS(2 * TCP_MSL_MS));
+    }
+
+  if ((in->len || (in->flags & TCP_FIN))
+      && (pcb->state == TCP_ESTABLISHED || pcb->state == TCP_FIN_WAIT_1
+          || pcb->state == TCP_FIN_WAIT_2))
+    {
+      tcp_receive_data(pcb, in, p);
+      p = 0;
+    }
+
+  tcp_output(pcb);
+
+drop:
+  if (p)
+    pbuf_free(p);
+}
+
+static void
+tcp_rtx_timeout (void *arg)
+{
+  struct tcp_pcb *pcb = arg;
+
+  if (!pcb->unacked)
+    {
+      // persist, probe the zero window with an old sequence number
+      if (pcb->unsent && !pcb->snd_wnd)
+        {
+          tcp_send_empty(pcb, pcb->snd_una - 1, 0);
+          pcb->rto = min(pcb->rto * 2, MS_TO_TICKS(TCP_RTO_MAX_MS));
+          timeout_add(&pcb->rtx_timer, pcb->rto);
+        }
+      return;
+    }
+
+  stats.timeouts++;
+  unsigned int limit = pcb->state < TCP_ESTABLISHED ? TCP_SYN_RETRIES
+                                                    : TCP_MAX_RETRIES;
+  if (++pcb->retries > limit)
+    {
+      tcp_abort(pcb, -ETIMEDOUT);
+      return;
+    }
+
+  // back off and restart from slow start
+  pcb->rto = min(pcb->rto * 2, MS_TO_TICKS(TCP_RTO_MAX_MS));
+  pcb->ssthresh = max((pcb->snd_max - pcb->snd_una) / 2, 2 * pcb->mss);
+  pcb->cwnd = pcb->mss;
+  pcb->recover = pcb->snd_max;
+  pcb->dupacks = 0;
+  pcb->flags &= ~(TF_RECOVERY | TF_TIMING);
+
+  // go back n, everything in flight is sent again
+  pcb->unacked_tail->next = pcb->unsent;
+  if (!pcb->unsent)
+    pcb->unsent_tail = pcb->unacked_tail;
+  pcb->unsent = pcb->unacked;
+  pcb->unacked = pcb->unacked_tail = 0;
+  pcb->snd_nxt = pcb->snd_una;
+
+  stats.retransmits++;
+  tcp_output(pcb);
+}
+
+static void
+tcp_ack_timeout (void *arg)
+{
+  struct tcp_pcb *pcb = arg;
+  if (pcb->flags & TF_ACK_DELAY)
+    {
+      stats.delayed_acks++;
+      tcp_send_empty(pcb, pcb->snd_nxt, 0);
+    }
+}
+
+static void
+tcp_linger_timeout (void *arg)
+{
+  tcp_set_closed(arg);
+}
+
+void
+tcp_output (struct tcp_pcb *pcb)
+{
+  if (pcb->state == TCP_CLOSED || pcb->state == TCP_LISTEN)
+    return;
+
+  unsigned int wnd = min(pcb->snd_wnd, pcb->cwnd);
+  int sent = 0;
+
+  struct tcp_seg *seg;
+  while ((seg = pcb->unsent))
+    {
+      // syn and fin are sent regardless of the window
+      if (seg->len && seg->seq + seg->len - pcb->snd_una > wnd)
+        break;
+
+      // nagle, hold back a small segment while data is in flight
+      if (!(pcb->flags & (TF_NODELAY | TF_RECOVERY)) && pcb->unacked
+          && seg->len < pcb->mss && !seg->next)
+        break;
+
+      pcb->unsent = seg->next;
+      if (!pcb->unsent)
+        pcb->unsent_tail = 0;
+      seg->next = 0;
+      if (pcb->unacked)
+        pcb->unacked_tail->next = seg;
+      else
+        pcb->unacked = seg;
+      pcb->unacked_tail = seg;
+
+      tcp_transmit(pcb, seg);
+      sent = 1;
+
+      unsigned int end = seg->seq + seg_seqlen(seg);
+      if (TCP_SEQ_GT(end, pcb->snd_nxt))
+        pcb->snd_nxt = end;
+      if (TCP_SEQ_GT(end, pcb->snd_max))
+        {
+          if (!(pcb->flags & TF_TIMING) && TCP_SEQ_GEQ(seg->seq, pcb->snd_max))
+            {
+              pcb->rtt_seq = seg->seq;
+              pcb->rtt_start = tick_count;
+              pcb->flags |= TF_TIMING;
+            }
+          pcb->snd_max = end;
+        }
+
+      if (!timeout_pending(&pcb->rtx_timer))
+        timeout_add(&pcb->rtx_timer, pcb->rto);
+    }
+
+  if (sent)
+    tcp_acked(pcb);
+  else if (pcb->flags & TF_ACK_NOW)
+    tcp_send_empty(pcb, pcb->snd_nxt, 0);
+
+  // a zero window is probed once nothing is left in flight
+  if (pcb->unsent && !pcb->unacked && !timeout_pending(&pcb->rtx_timer))
+    timeout_add(&pcb->rtx_timer, pcb->rto);
+}
+
+struct tcp_pcb*
+tcp_new (void)
+{
+  unsigned int i;
+  for (i = 0; i < TCP_PCB_MAX; ++i)
+    if (!pcbs[i].used)
+      {
+        struct tcp_pcb *pcb = &pcbs[i];
+        *pcb = (struct tcp_pcb) { 0 };
+
+        pcb->iss = tcp_next_iss();
+        pcb->snd_una = pcb->snd_nxt = pcb->snd_max = pcb->iss;
+        pcb->snd_lbb = pcb->iss;
+        pcb->recover = pcb->iss;
+        pcb->mss = 536;
+        pcb->cwnd = pcb->mss;
+        pcb->ssthresh = 0xFFFF;
+        pcb->rto = MS_TO_TICKS(TCP_RTO_INITIAL_MS);
+
+        timeout_set(&pcb->rtx_timer, &tcp_rtx_timeout, pcb);
+        timeout_set(&pcb->ack_timer, &tcp_ack_timeout, pcb);
+        timeout_set(&pcb->linger_timer, &tcp_linger_timeout, pcb);
+        pcb->used = 1;
+        return pcb;
+      }
+
+  return 0;
+}
+
+int
+tcp_bind (struct tcp_pcb *pcb, unsigned int ip, unsigned short port)
+{
+  if (pcb->state != TCP_CLOSED)
+    return -EINVAL;
+
+  if (!port)
+    {
+      unsigned int tries;
+      for (tries = 0; tries < 0x10000 - TCP_PORT_EPHEMERAL; ++tries)
+        {
+          unsigned short candidate = htons(next_ephemeral);
+          if (++next_ephemeral == 0)
+            next_ephemeral = TCP_PORT_EPHEMERAL;
+          if (!tcp_port_used(IP4_ANY, candidate))
+            {
+              port = candidate;
+              break;
+            }
+        }
+      if (!port)
+        return -EADDRINUSE;
+    }
+  else if (tcp_port_used(ip, port))
+    return -EADDRINUSE;
+
+  pcb->local_ip = ip;
+  pcb->local_port = port;
+  return 0;
+}
+
+int
+tcp_listen (struct tcp_pcb *pcb, unsigned int backlog)
+{
+  if (pcb->state != TCP_CLOSED)
+    return -EINVAL;
+  if (!pcb->local_port && tcp_bind(pcb, pcb->local_ip, 0) < 0)
+    return -EADDRINUSE;
+
+  pcb->state = TCP_LISTEN;
+  pcb->backlog = backlog ? backlog : 1;
+  tcp_hash_insert(pcb);
+  return 0;
+}
+
+struct tcp_pcb*
+tcp_accept (struct tcp_pcb *pcb)
+{
+  struct tcp_pcb *child = pcb->accept_queue;
+  if (child)
+    {
+      pcb->accept_queue = child->accept_next;
+      pcb->children--;
+      child->accept_next = 0;
+      child->listener = 0;
+    }
+
+  return child;
+}
+
+int
+tcp_connect (struct tcp_pcb *pcb, unsigned int ip, unsigned short port)
+{
+  if (pcb->state != TCP_CLOSED || pcb->remote_port)
+    return -EINVAL;
+
+  unsigned int nexthop;
+  struct netif *netif = route_lookup(ip, &nexthop);
+  if (!netif)
+    return -ENETUNREACH;
+
+  if (!pcb->local_port && tcp_bind(pcb, pcb->local_ip, 0) < 0)
+    return -EADDRINUSE;
+  unsigned int local_ip = pcb->local_ip ? pcb->local_ip : netif->ip;
+  if (tcp_lookup(local_ip, pcb->local_port, ip, port))
+    return -EADDRINUSE;
+
+  pcb->local_ip = local_ip;
+  pcb->remote_ip = ip;
+  pcb->remote_port = port;
+  tcp_set_mss(pcb, 0, netif);
+
+  pcb->state = TCP_SYN_SENT;
+  if (tcp_enqueue_flags(pcb, TCP_SYN) < 0)
+    {
+      pcb->state = TCP_CLOSED;
+      pcb->remote_port = 0;
+      return -ENOBUFS;
+    }
+
+  tcp_hash_insert(pcb);
+  tcp_output(pcb);
+  return 0;
+}
+
+int
+tcp_write (struct tcp_pcb *pcb, const void *data, unsigned int len)
+{
+  if (pcb->error)
+    return pcb->error;
+  if (pcb->state != TCP_ESTABLISHED && pcb->state != TCP_CLOSE_WAIT)
+    return -ENOTCONN;
+
+  const unsigned char *in = data;
+  unsigned int written = 0;
+
+  while (written < len && pcb->snd_queued < TCP_SND_BUF)
+    {
+      // small writes are coalesced into the last segment as long as it was
+      // not handed to the layers below
+      struct tcp_seg *seg = pcb->unsent_tail;
+      if (!seg || seg->len >= pcb->mss || seg->flags || seg->p->ref > 1)
+        {
+          seg = seg_alloc();
+          if (!seg)
+            break;
+          seg->p = pbuf_alloc(PBUF_APP_HEADROOM, 0);
+          if (!seg->p)
+            {
+              seg_free(seg);
+              break;
+            }
+          seg->data = seg->p->payload;
+          seg->seq = pcb->snd_lbb;
+          seg->len = 0;
+          seg->flags = 0;
+          seg->sum = 0;
+
+          if (pcb->unsent)
+            pcb->unsent_tail->next = seg;
+          else
+            pcb->unsent = seg;
+          pcb->unsent_tail = seg;
+        }
+
+      unsigned int n = min(len - written, pcb->mss - seg->len);
+      n = min(n, TCP_SND_BUF - pcb->snd_queued);
+
+      // the payload is copied into the segment and summed in one pass
+      seg->sum += chksum_shift(chksum_copy(seg->data + seg->len, in + written,
+                                           n, 0), seg->len & 1);
+      seg->len += n;
+      seg->p->len += n;
+      seg->p->tot_len += n;
+
+      pcb->snd_lbb += n;
+      pcb->snd_queued += n;
+      written += n;
+    }
+
+  return written;
+}
+
+int
+tcp_read (struct tcp_pcb *pcb, void *buf, unsigned int len)
+{
+  unsigned char *out = buf;
+  unsigned int copied = 0;
+
+  while (copied < len && pcb->recv_queue)
+    {
+      struct pbuf *p = pcb->recv_queue;
+      unsigned int n = pbuf_copy_out(p, pcb->recv_offset, out + copied,
+                                     len - copied);
+      copied += n;
+      pcb->recv_offset += n;
+
+      if (pcb->recv_offset == p->tot_len)
+        {
+          pcb->recv_queue = p->link;
+          if (!pcb->recv_queue)
+            pcb->recv_tail = 0;
+          pcb->recv_offset = 0;
+          p->link = 0;
+          pbuf_free(p);
+        }
+    }
+
+  if (copied)
+    {
+      pcb->recv_queued -= copied;
+
+      // announce the opened window if it is worth a segment
+      unsigned int edge = pcb->rcv_nxt + TCP_WND - pcb->recv_queued;
+      if (pcb->state != TCP_CLOSED
+          && TCP_SEQ_GEQ(edge, pcb->rcv_adv + min(TCP_WND / 2, pcb->mss)))
+        {
+          pcb->flags |= TF_ACK_NOW;
+          tcp_output(pcb);
+        }
+      return copied;
+    }
+
+  if (pcb->error)
+    return pcb->error;
+  if (pcb->flags & TF_RCVD_FIN)
+    return 0;
+  if (pcb->state != TCP_ESTABLISHED && pcb->state != TCP_FIN_WAIT_1
+      && pcb->state != TCP_FIN_WAIT_2)
+    return -ENOTCONN;
+
+  return -EAGAIN;
+}
+
+void
+tcp_nodelay (struct tcp_pcb *pcb, int enable)
+{
+  if (enable)
+    pcb->flags |= TF_NODELAY;
+  else
+    pcb->flags &= ~TF_NODELAY;
+}
+
+void
+tcp_close (struct tcp_pcb *pcb)
+{
+  pcb->flags |= TF_DETACHED;
+
+  switch (pcb->state)
+    {
+    case TCP_LISTEN:
+      {
+        // connections that were not accepted are reset
+        unsigned int i;
+        for (i = 0; i < TCP_PCB_MAX; ++i)
+          if (pcbs[i].used && pcbs[i].listener == pcb)
+            tcp_abort(&pcbs[i], -ECONNRESET);
+        tcp_free(pcb);
+        return;
+      }
+
+    case TCP_CLOSED:
+    case TCP_SYN_SENT:
+      tcp_free(pcb);
+      return;
+
+    case TCP_SYN_RCVD:
+    case TCP_ESTABLISHED:
+    case TCP_CLOSE_WAIT:
+      // data that was never read is lost, the peer is told with a reset
+      if (pcb->recv_queue || tcp_enqueue_flags(pcb, TCP_FIN) < 0)
+        {
+          tcp_abort(pcb, -ECONNRESET);
+          return;
+        }
+      pcb->state = pcb->state == TCP_CLOSE_WAIT ? TCP_LAST_ACK
+                                                : TCP_FIN_WAIT_1;
+      tcp_output(pcb);
+      return;
+
+    case TCP_FIN_WAIT_2:
+      timeout_add(&pcb->linger_timer, MS_TO_TICKS(TCP_FIN_WAIT_MS));
+      return;
+
+    default:
+      return;
+    }
+}
+
+void
+tcp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph)
+{
+  stats.rx++;
+
+  struct tcp_hdr *tcp = (struct tcp_hdr*)p->payload;
+  unsigned int hlen;
+  if (p->len < TCP_HLEN || (hlen = (tcp->off >> 4) * 4) < TCP_HLEN
+      || hlen > p->len || iph->dst != netif->ip)
+    {
+      stats.drop_header++;
+      goto drop;
+    }
+
+  if (chksum_fold(chksum_add_pbuf(chksum_pseudo(iph->src, iph->dst,
+      IP_PROTO_TCP, p->tot_len), p)))
+    {
+      stats.drop_checksum++;
+      goto drop;
+    }
+
+  struct tcp_in in;
+  in.seq = ntohl(tcp->seq);
+  in.ack = ntohl(tcp->ack);
+  in.wnd = ntohs(tcp->wnd);
+  in.flags = tcp->flags;
+  in.mss = (in.flags & TCP_SYN) ? tcp_parse_mss(tcp, hlen) : 0;
+  pbuf_header(p, -(int) hlen);
+  in.len = p->tot_len;
+
+  struct tcp_pcb *pcb = tcp_lookup(iph->dst, tcp->dst, iph->src, tcp->src);
+  if (pcb)
+    {
+      if (pcb->state == TCP_SYN_SENT)
+        tcp_syn_sent_input(pcb, netif, &in);
+      else
+        {
+          tcp_process(pcb, iph, tcp, &in, p);
+          return;
+        }
+      goto drop;
+    }
+
+  pcb = tcp_lookup_listen(iph->dst, tcp->dst);
+  if (pcb)
+    {
+      tcp_listen_input(pcb, netif, iph, tcp, &in);
+      goto drop;
+    }
+
+  stats.drop_noport++;
+  if (!(in.flags & TCP_RST))
+    tcp_rst_reply(iph, tcp, &in);
+
+drop:
+  pbuf_free(p);
+}
+
+const struct tcp_stats*
+tcp_stats (void)
+{
+  return &stats;
+}
+
+static void
+__attribute((constructor))
+tcp_init (void)
+{
+  unsigned int i;
+  for (i = 0; i < TCP_SEG_MAX; ++i)
+    {
+      segs[i].next = free_segs;
+      free_segs = &segs[i];
+    }
+}
@@ -0,0 +1,277 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/scheduler.h"
+#include "kernel/timeout.h"
+
+struct pbuf;
+struct netif;
+struct ip_hdr;
+
+#define TCP_HLEN 20
+#define TCP_MSS  1460  // ethernet mtu minus the ip and tcp headers
+
+#define TCP_PCB_MAX   16
+#define TCP_SEG_MAX   128   // segment descriptors shared by all connections
+#define TCP_HASH_SIZE 16    // power of two
+#define TCP_PORT_EPHEMERAL 49152
+
+#define TCP_WND        (8 * TCP_MSS)  // receive buffer per connection
+#define TCP_SND_BUF    (8 * TCP_MSS)  // send buffer per connection
+#define TCP_OOSEQ_MAX  8              // out of order segments held per connection
+
+#define TCP_RTO_INITIAL_MS 1000
+#define TCP_RTO_MIN_MS     200
+#define TCP_RTO_MAX_MS     60000
+#define TCP_DELACK_MS      40
+#define TCP_MSL_MS         2000
+#define TCP_FIN_WAIT_MS    20000  // limit for orphaned connections in FIN_WAIT_2
+#define TCP_SYN_RETRIES    5
+#define TCP_MAX_RETRIES    12
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+// sequence number comparisons modulo 2^32
+#define TCP_SEQ_LT(A, B)  ((int)((A) - (B)) < 0)
+#define TCP_SEQ_LEQ(A, B) ((int)((A) - (B)) <= 0)
+#define TCP_SEQ_GT(A, B)  ((int)((A) - (B)) > 0)
+#define TCP_SEQ_GEQ(A, B) ((int)((A) - (B)) >= 0)
+
+struct tcp_hdr
+{
+  unsigned short src;
+  unsigned short dst;
+  unsigned int seq;
+  unsigned int ack;
+  unsigned char off;    // header length in words in the upper nibble
+  unsigned char flags;
+  unsigned short wnd;
+  unsigned short chksum;
+  unsigned short urp;
+};
+
+enum tcp_state
+{
+  TCP_CLOSED = 0,
+  TCP_LISTEN,
+  TCP_SYN_SENT,
+  TCP_SYN_RCVD,
+  TCP_ESTABLISHED,
+  TCP_FIN_WAIT_1,
+  TCP_FIN_WAIT_2,
+  TCP_CLOSE_WAIT,
+  TCP_CLOSING,
+  TCP_LAST_ACK,
+  TCP_TIME_WAIT
+};
+
+/* a segment on the send or out of order queue. the payload of p starts at
+ * data and holds len bytes, the headers are built in front of it on every
+ * transmission.
+ */
+struct tcp_seg
+{
+  struct tcp_seg *next;
+  struct pbuf *p;
+  unsigned char *data;
+  unsigned int seq;
+  unsigned short len;
+  unsigned char flags;  // TCP_SYN and TCP_FIN occupy sequence space
+  unsigned int sum;     // partial checksum of the payload
+};
+
+/* a tcp connection. addresses and ports in network byte order, sequence
+ * numbers and windows in host byte order.
+ */
+struct tcp_pcb
+{
+  unsigned int local_ip;
+  unsigned int remote_ip;
+  unsigned short local_port;
+  unsigned short remote_port;
+  struct tcp_pcb *hash_next;
+
+  enum tcp_state state;
+  unsigned int flags;  // TF_*, see tcp.c
+  int error;           // the error that closed the connection
+
+  // send sequence space
+  unsigned int iss;
+  unsigned int snd_una;  // oldest unacknowledged
+  unsigned int snd_nxt;  // next to send
+  unsigned int snd_max;  // highest sent
+  unsigned int snd_wl1;  // segment used for the last window update
+  unsigned int snd_wl2;
+  unsigned int snd_wnd;
+  unsigned int snd_lbb;     // sequence number of the next byte queued
+  unsigned int snd_queued;  // payload bytes on the unsent and unacked queues
+  unsigned short mss;
+  struct tcp_seg *unsent;
+  struct tcp_seg *unsent_tail;
+  struct tcp_seg *unacked;
+  struct tcp_seg *unacked_tail;
+
+  // congestion control, newreno
+  unsigned int cwnd;
+  unsigned int ssthresh;
+  unsigned int recover;  // snd_max when fast recovery was entered
+  unsigned int dupacks;
+
+  // round trip estimation in ticks, srtt scaled by 8 and rttvar by 4
+  int srtt;
+  int rttvar;
+  unsigned int rto;
+  unsigned int rtt_seq;
+  unsigned int rtt_start;
+  unsigned int retries;
+
+  // receive sequence space
+  unsigned int irs;
+  unsigned int rcv_nxt;
+  unsigned int rcv_adv;  // right edge of the announced window
+  unsigned int acks_pending;
+
+  // in order data not read yet, linked by link
+  struct pbuf *recv_queue;
+  struct pbuf *recv_tail;
+  unsigned int recv_queued;
+  unsigned int recv_offset;  // bytes already read from the first buffer
+  struct tcp_seg *ooseq;
+  unsigned int ooseq_count;
+
+  struct timeout rtx_timer;  // retransmission and window probes
+  struct timeout ack_timer;  // delayed acknowledgements
+  struct timeout linger_timer;
+
+  // connections of a listening socket that are not accepted yet
+  struct tcp_pcb *listener;
+  struct tcp_pcb *accept_queue;
+  struct tcp_pcb *accept_next;
+  unsigned int backlog;
+  unsigned int children;
+
+  wait_queue_t readers;
+  wait_queue_t writers;
+  int used;
+};
+
+struct tcp_stats
+{
+  unsigned int rx;
+  unsigned int drop_header;
+  unsigned int drop_checksum;
+  unsigned int drop_noport;
+  unsigned int drop_ooseq;
+  unsigned int tx;
+  unsigned int retransmits;
+  unsigned int fast_retransmits;
+  unsigned int timeouts;
+  unsigned int delayed_acks;
+  unsigned int resets;
+};
+
+/* returns:
+ *   a new closed connection, or 0 if all are in use
+ */
+struct tcp_pcb* tcp_new (void);
+
+/* bind the connection to a local address and port
+ *
+ * params:
+ *   ip   - the local address, or IP4_ANY
+ *   port - the local port, or 0 for an ephemeral port
+ *
+ * returns:
+ *   0 on success or -EADDRINUSE
+ */
+int tcp_bind (struct tcp_pcb *pcb, unsigned int ip, unsigned short port);
+
+/* accept connections on the bound port
+ *
+ * params:
+ *   backlog - connections held until they are accepted
+ *
+ * returns:
+ *   0 on success or a negative error code
+ */
+int tcp_listen (struct tcp_pcb *pcb, unsigned int backlog);
+
+/* returns:
+ *   the oldest established connection of a listening pcb, or 0 if there is
+ *   none
+ */
+struct tcp_pcb* tcp_accept (struct tcp_pcb *pcb);
+
+/* start the handshake, binding the connection to an ephemeral port if
+ * needed. the connection is established once pcb->state is
+ * TCP_ESTABLISHED, writers are woken up on every state change.
+ *
+ * returns:
+ *   0 on success or a negative error code
+ */
+int tcp_connect (struct tcp_pcb *pcb, unsigned int ip, unsigned short port);
+
+/* queue data for sending, the data is copied straight into the segments
+ * that are sent
+ *
+ * returns:
+ *   the number of bytes queued, 0 if the send buffer is full, or a negative
+ *   error code
+ */
+int tcp_write (struct tcp_pcb *pcb, const void *data, unsigned int len);
+
+/* read received data and open the receive window
+ *
+ * returns:
+ *   the number of bytes read, 0 at the end of the stream, -EAGAIN if no data
+ *   is available yet, or a negative error code
+ */
+int tcp_read (struct tcp_pcb *pcb, void *buf, unsigned int len);
+
+/* send the queued segments the windows allow, and pending acknowledgements
+ */
+void tcp_output (struct tcp_pcb *pcb);
+
+/* disable or enable the nagle algorithm */
+void tcp_nodelay (struct tcp_pcb *pcb, int enable);
+
+/* give up the connection. the pcb must not be used afterwards, a connection
+ * that is still open is shut down in the background, or reset if received
+ * data was not read.
+ */
+void tcp_close (struct tcp_pcb *pcb);
+
+/* handle a received tcp segment, takes over the reference to p
+ */
+void tcp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph);
+
+/* returns the tcp counters
+ */
+const struct tcp_stats* tcp_stats (void);
@@ -0,0 +1,296 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "udp.h"
+
+#include "kernel/net/checksum.h"
+#include "kernel/net/ip.h"
+#include "kernel/net/net.h"
+#include "kernel/net/pbuf.h"
+
+#include <errno.h>
+
+static struct udp_pcb pcbs[UDP_PCB_MAX] = { { 0 } };
+
+// bound endpoints, hashed by local address and port
+static struct udp_pcb *hash_table[UDP_HASH_SIZE] = { 0 };
+
+static unsigned short next_ephemeral = UDP_PORT_EPHEMERAL;
+static struct udp_stats stats = { 0 };
+
+static inline unsigned int
+udp_hash (unsigned int ip, unsigned short port)
+{
+  unsigned int h = ip ^ (ip >> 16) ^ port;
+  h ^= h >> 8;
+  return h & (UDP_HASH_SIZE - 1);
+}
+
+static struct udp_pcb*
+udp_lookup_exact (unsigned int ip, unsigned short port)
+{
+  struct udp_pcb *pcb = hash_table[udp_hash(ip, port)];
+  for (; pcb; pcb = pcb->hash_next)
+    if (pcb->local_port == port && pcb->local_ip == ip)
+      return pcb;
+
+  return 0;
+}
+
+// endpoints bound to the destination address take precedence over
+// endpoints bound to any address
+static struct udp_pcb*
+udp_lookup (unsigned int ip, unsigned short port)
+{
+  struct udp_pcb *pcb = udp_lookup_exact(ip, port);
+  return pcb ? pcb : udp_lookup_exact(IP4_ANY, port);
+}
+
+static int
+udp_port_used (unsigned short port)
+{
+  unsigned int i;
+  for (i = 0; i < UDP_PCB_MAX; ++i)
+    if (pcbs[i].used && pcbs[i].local_port == port)
+      return 1;
+
+  return 0;
+}
+
+static void
+udp_unhash (struct udp_pcb *pcb)
+{
+  if (!pcb->local_port)
+    return;
+
+  struct udp_pcb **pos = &hash_table[udp_hash(pcb->local_ip, pcb->local_port)];
+  while (*pos != pcb)
+    pos = &(*pos)->hash_next;
+  *pos = pcb->hash_next;
+  pcb->hash_next = 0;
+}
+
+struct udp_pcb*
+udp_new (void)
+{
+  unsigned int i;
+  for (i = 0; i < UDP_PCB_MAX; ++i)
+    if (!pcbs[i].used)
+      {
+        struct udp_pcb *pcb = &pcbs[i];
+        pcb->local_ip = IP4_ANY;
+        pcb->local_port = 0;
+        pcb->queued = 0;
+        pcb->hash_next = 0;
+        pcb->netif = 0;
+        pcb->recv = 0;
+        pcb->queue = 0;
+        pcb->queue_tail = 0;
+        pcb->readers.head = 0;
+        pcb->used = 1;
+        return pcb;
+      }
+
+  return 0;
+}
+
+void
+udp_remove (struct udp_pcb *pcb)
+{
+  udp_unhash(pcb);
+
+  struct pbuf *p;
+  while ((p = udp_recv(pcb)))
+    pbuf_free(p);
+
+  wake_up(&pcb->readers);
+  pcb->used = 0;
+}
+
+int
+udp_bind (struct udp_pcb *pcb, unsigned int ip, unsigned short port)
+{
+  if (!port)
+    {
+      unsigned int tries;
+      for (tries = 0; tries < 0x10000 - UDP_PORT_EPHEMERAL; ++tries)
+        {
+          unsigned short candidate = htons(next_ephemeral);
+          if (++next_ephemeral == 0)
+            next_ephemeral = UDP_PORT_EPHEMERAL;
+          if (!udp_port_used(candidate))
+            {
+              port = candidate;
+              break;
+            }
+        }
+      if (!port)
+        return -EADDRINUSE;
+    }
+  else if (udp_lookup_exact(ip, port))
+    return -EADDRINUSE;
+
+  udp_unhash(pcb);
+  pcb->local_ip = ip;
+  pcb->local_port = port;
+
+  unsigned int h = udp_hash(ip, port);
+  pcb->hash_next = hash_table[h];
+  hash_table[h] = pcb;
+  return 0;
+}
+
+int
+udp_sendto_sum (struct udp_pcb *pcb, struct pbuf *p, unsigned int sum,
+                unsigned int ip, unsigned short port)
+{
+  if (!pcb->local_port && udp_bind(pcb, pcb->local_ip, 0) < 0)
+    {
+      stats.drop_tx++;
+      pbuf_free(p);
+      return -EADDRINUSE;
+    }
+
+  struct netif *netif = pcb->netif;
+  unsigned int nexthop = ip;
+  if (!netif && !(netif = route_lookup(ip, &nexthop)))
+    {
+      stats.drop_tx++;
+      pbuf_free(p);
+      return -ENETUNREACH;
+    }
+  unsigned int src = pcb->local_ip ? pcb->local_ip : netif->ip;
+
+  if (pbuf_header(p, UDP_HLEN))
+    {
+      struct pbuf *h = pbuf_alloc_small(PBUF_TRANSPORT_HEADROOM, UDP_HLEN);
+      if (!h)
+        {
+          stats.drop_tx++;
+          pbuf_free(p);
+          return -ENOMEM;
+        }
+      pbuf_cat(h, p);
+      p = h;
+    }
+
+  struct udp_hdr *udp = (struct udp_hdr*)p->payload;
+  udp->src = pcb->local_port;
+  udp->dst = port;
+  udp->len = htons(p->tot_len);
+  udp->chksum = 0;
+
+  sum += chksum_add(0, udp, UDP_HLEN);
+  sum += chksum_pseudo(src, ip, IP_PROTO_UDP, p->tot_len);
+  udp->chksum = chksum_fold(sum);
+  if (!udp->chksum)
+    udp->chksum = 0xFFFF;  // zero means no checksum
+
+  stats.tx++;
+  return ip_output_if(p, netif, src, ip, nexthop, IP_PROTO_UDP);
+}
+
+int
+udp_sendto (struct udp_pcb *pcb, struct pbuf *p, unsigned int ip,
+            unsigned short port)
+{
+  return udp_sendto_sum(pcb, p, chksum_add_pbuf(0, p), ip, port);
+}
+
+struct pbuf*
+udp_recv (struct udp_pcb *pcb)
+{
+  struct pbuf *p = pcb->queue;
+  if (p)
+    {
+      pcb->queue = p->link;
+      p->link = 0;
+      pcb->queued--;
+    }
+
+  return p;
+}
+
+void
+udp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph)
+{
+  stats.rx++;
+
+  struct udp_hdr *udp = (struct udp_hdr*)p->payload;
+  unsigned int len;
+  if (p->len < UDP_HLEN || (len = ntohs(udp->len)) < UDP_HLEN
+      || len > p->tot_len)
+    {
+      stats.drop_header++;
+      goto drop;
+    }
+
+  pbuf_trim(p, len);
+  if (udp->chksum && chksum_fold(chksum_add_pbuf(chksum_pseudo(iph->src,
+      iph->dst, IP_PROTO_UDP, len), p)))
+    {
+      stats.drop_checksum++;
+      goto drop;
+    }
+
+  struct udp_pcb *pcb = udp_lookup(iph->dst, udp->dst);
+  if (!pcb)
+    {
+      stats.drop_noport++;
+      goto drop;
+    }
+
+  if (!pcb->recv && pcb->queued == UDP_QUEUE_MAX)
+    {
+      stats.drop_queue++;
+      goto drop;
+    }
+
+  p->addr = iph->src;
+  p->port = udp->src;
+  pbuf_header(p, -UDP_HLEN);
+  stats.rx_delivered++;
+
+  if (pcb->recv)
+    {
+      pcb->recv(pcb, p);
+      return;
+    }
+
+  p->link = 0;
+  if (pcb->queue)
+    pcb->queue_tail->link = p;
+  else
+    pcb->queue = p;
+  pcb->queue_tail = p;
+  pcb->queued++;
+
+  wake_up(&pcb->readers);
+  return;
+
+drop:
+  pbuf_free(p);
+}
+
+const struct udp_stats*
+udp_stats (void)
+{
+  return &stats;
+}
@@ -0,0 +1,141 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/scheduler.h"
+
+struct pbuf;
+struct netif;
+struct ip_hdr;
+
+#define UDP_HLEN 8
+
+#define UDP_PCB_MAX      16
+#define UDP_HASH_SIZE    16   // power of two
+#define UDP_QUEUE_MAX    32   // datagrams held per socket
+#define UDP_PORT_EPHEMERAL 49152
+
+struct udp_hdr
+{
+  unsigned short src;
+  unsigned short dst;
+  unsigned short len;
+  unsigned short chksum;
+};
+
+struct udp_pcb;
+
+/* receive hook of endpoints used inside the kernel, takes over the
+ * reference to p, whose payload is at the udp payload with the sender in
+ * addr and port
+ */
+typedef void (*udp_recv_fn) (struct udp_pcb *pcb, struct pbuf *p);
+
+/* a udp endpoint, addresses and ports in network byte order */
+struct udp_pcb
+{
+  unsigned int local_ip;
+  unsigned short local_port;
+  unsigned short queued;
+  struct udp_pcb *hash_next;
+
+  // if set, datagrams are sent through this interface regardless of the
+  // routes, e.g. while the interface has no address yet
+  struct netif *netif;
+
+  // if set, datagrams are handed to the hook instead of being queued
+  udp_recv_fn recv;
+
+  // received datagrams, linked by link, payload at the udp payload with the
+  // sender in addr and port
+  struct pbuf *queue;
+  struct pbuf *queue_tail;
+
+  wait_queue_t readers;
+  int used;
+};
+
+struct udp_stats
+{
+  unsigned int rx;
+  unsigned int rx_delivered;
+  unsigned int drop_header;
+  unsigned int drop_checksum;
+  unsigned int drop_noport;
+  unsigned int drop_queue;
+  unsigned int tx;
+  unsigned int drop_tx;
+};
+
+/* returns:
+ *   a new unbound endpoint, or 0 if all are in use
+ */
+struct udp_pcb* udp_new (void);
+
+/* unbind the endpoint and drop its queued datagrams */
+void udp_remove (struct udp_pcb *pcb);
+
+/* bind the endpoint to a local address and port
+ *
+ * params:
+ *   ip   - the local address, or IP4_ANY
+ *   port - the local port, or 0 for an ephemeral port
+ *
+ * returns:
+ *   0 on success or -EADDRINUSE
+ */
+int udp_bind (struct udp_pcb *pcb, unsigned int ip, unsigned short port);
+
+/* send a datagram, binding the endpoint to an ephemeral port if needed
+ *
+ * params:
+ *   p    - the payload with room for the headers, the reference is taken
+ *          over
+ *   sum  - the partial checksum of the payload, see kernel/net/checksum.h
+ *   ip   - the destination address
+ *   port - the destination port
+ *
+ * returns:
+ *   0 on success or a negative error code
+ */
+int udp_sendto_sum (struct udp_pcb *pcb, struct pbuf *p, unsigned int sum,
+                    unsigned int ip, unsigned short port);
+
+/* like udp_sendto_sum, for payloads that have not been summed yet */
+int udp_sendto (struct udp_pcb *pcb, struct pbuf *p, unsigned int ip,
+                unsigned short port);
+
+/* returns:
+ *   the oldest queued datagram, or 0 if there is none
+ */
+struct pbuf* udp_recv (struct udp_pcb *pcb);
+
+/* handle a received udp datagram, takes over the reference to p
+ */
+void udp_input (struct netif *netif, struct pbuf *p, const struct ip_hdr *iph);
+
+/* returns the udp counters
+ */
+const struct udp_stats* udp_stats (void);
@@ -0,0 +1,97 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "page_alloc.h"
+
+#include "kernel/memory.h"
+
+#define PAGE_COUNT (PAGE_POOL_SIZE / PAGE_SIZE)
+#define PAGE_INDEX(P) (((P) - PAGE_POOL_BASE) / PAGE_SIZE)
+
+#define NO_PAGE 0xFFFF
+
+/* the free list is kept outside of the pages, so a free page is never
+ * written through its kernel mapping. this keeps the data cache free of
+ * aliases once the page gets mapped into a task region.
+ */
+static unsigned short refcount[PAGE_COUNT];
+static unsigned short next_free[PAGE_COUNT];
+static unsigned int free_head = NO_PAGE;
+static unsigned int free_count = 0;
+
+unsigned int
+page_alloc (void)
+{
+  if (free_head == NO_PAGE)
+    return 0;
+
+  unsigned int index = free_head;
+  free_head = next_free[index];
+  free_count--;
+
+  refcount[index] = 1;
+  return PAGE_POOL_BASE + index * PAGE_SIZE;
+}
+
+void
+page_get (unsigned int page)
+{
+  refcount[PAGE_INDEX(page)]++;
+}
+
+void
+page_put (unsigned int page)
+{
+  unsigned int index = PAGE_INDEX(page);
+  if (--refcount[index])
+    return;
+
+  next_free[index] = free_head;
+  free_head = index;
+  free_count++;
+}
+
+unsigned int
+page_refcount (unsigned int page)
+{
+  return refcount[PAGE_INDEX(page)];
+}
+
+unsigned int
+page_free_count (void)
+{
+  return free_count;
+}
+
+/* put all pages of the pool on the free list
+ * this is done automatically on startup
+ */
+static void
+__attribute((constructor))
+page_alloc_init (void)
+{
+  unsigned int i;
+  for (i = PAGE_COUNT; i > 0; --i)
+    {
+      next_free[i - 1] = free_head;
+      free_head = i - 1;
+    }
+  free_count = PAGE_COUNT;
+}
@@ -0,0 +1,55 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* the page allocator hands out the physical pages of the page pool, see
+ * PAGE_POOL_BASE in kernel/memory.h. pages are reference counted, so they can
+ * be shared between tasks. all functions run in O(1).
+ */
+
+/* allocate a page with a reference count of one
+ *
+ * returns:
+ *   the physical address of the page, or 0 if the pool is exhausted
+ */
+unsigned int page_alloc (void);
+
+/* take another reference to an allocated page */
+void page_get (unsigned int page);
+
+/* drop a reference to an allocated page, the page is freed when the last
+ * reference is dropped
+ */
+void page_put (unsigned int page);
+
+/* returns:
+ *   the number of references to an allocated page
+ */
+unsigned int page_refcount (unsigned int page);
+
+/* returns:
+ *   the number of free pages in the pool
+ */
+unsigned int page_free_count (void);
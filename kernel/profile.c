@@ -0,0 +1,127 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "profile.h"
+
+#include "kernel/memory.h"
+#include "kernel/interrupt.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+// task ids as reported by taskid, the idle task gets 0
+#define TASK_KERNEL 0xFF
+
+struct profile_sample
+{
+  unsigned int pc;
+  unsigned int task;
+};
+
+static struct profile_sample samples[PROFILE_SAMPLES];
+
+// samples taken since the profiler was started, the next one is stored at
+// head modulo PROFILE_SAMPLES
+static unsigned int head = 0;
+static int enabled = 1;
+
+// samples left to print by a running dump
+static unsigned int dump_next = 0;
+static unsigned int dump_end = 0;
+static int dumping = 0;
+
+void
+__fasttext
+profile_sample (void)
+{
+  if (!enabled)
+    return;
+
+  struct profile_sample *sample = &samples[head++ & (PROFILE_SAMPLES - 1)];
+  if (irq_kernel_pc)
+    {
+      sample->pc = irq_kernel_pc;
+      sample->task = TASK_KERNEL;
+      return;
+    }
+
+  unsigned int task = current_task - tasks;
+  sample->pc = current_task->pc;
+  sample->task = task < MAX_TASK_NUMBER ? task + 1 : 0;
+}
+
+// print the next chunk of samples, oldest first. the profiler is stopped
+// while the samples are printed.
+static int
+dump_chunk (void)
+{
+  if (!dumping)
+    {
+      unsigned int count = head < PROFILE_SAMPLES ? head : PROFILE_SAMPLES;
+      dump_next = head - count;
+      dump_end = head;
+      dumping = 1;
+      enabled = 0;
+      printf("profile: begin samples=%u total=%u tick_us=%u\n",
+             count, head, TICK_US);
+    }
+
+  unsigned int n;
+  for (n = 0; n < PROFILE_DUMP_CHUNK && dump_next != dump_end; ++n)
+    {
+      struct profile_sample *sample =
+        &samples[dump_next++ & (PROFILE_SAMPLES - 1)];
+      if (sample->task == TASK_KERNEL)
+        printf("profile: 0x%x kernel\n", sample->pc);
+      else if (!sample->task)
+        printf("profile: 0x%x idle\n", sample->pc);
+      else
+        printf("profile: 0x%x %u\n", sample->pc, sample->task);
+    }
+
+  if (dump_next != dump_end)
+    return dump_end - dump_next;
+
+  puts("profile: end");
+  dumping = 0;
+  return 0;
+}
+
+int
+sys_profile (int command)
+{
+  switch (command)
+    {
+    case PROFILE_START:
+      head = 0;
+      dumping = 0;
+      enabled = 1;
+      return 0;
+    case PROFILE_STOP:
+      enabled = 0;
+      return 0;
+    case PROFILE_DUMP:
+      return dump_chunk();
+    default:
+      return -EINVAL;
+    }
+}
@@ -0,0 +1,46 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+// number of samples kept, a power of two. once the buffer is full, new
+// samples replace the oldest ones.
+#define PROFILE_SAMPLES 4096
+
+// samples printed per call of sys_profile with PROFILE_DUMP
+#define PROFILE_DUMP_CHUNK 64
+
+/* take a sample of the interrupted instruction and the running task, called
+ * from the timer interrupt on every tick
+ *
+ * ticks that arrive during a syscall are delayed until the syscall returns,
+ * so the time spent in syscalls is attributed to the instruction after the
+ * swi. bottom halves are sampled at their own addresses.
+ */
+void profile_sample (void);
+
+/* control the profiler, see profile_start, profile_stop and profile_dump in
+ * kernel/syscall.h
+ */
+int sys_profile (int command);
@@ -20,37 +20,76 @@
 
 #include "scheduler.h"
 
+#include "kernel/crash.h"
 #include "kernel/memory.h"
+#include "kernel/mmu.h"
+#include "kernel/profile.h"
+#include "kernel/syscall.h"
+#include "kernel/softirq.h"
+#include "kernel/timeout.h"
+#include "kernel/trace.h"
 #include "kernel/drivers/timer.h"
 #include "kernel/interrupt.h"
 #include "kernel/interrupt_handler.h"
+#include "kernel/net/net.h"
+#include "kernel/net/socket.h"
 
-#define CPSR_MODE_SVC  0x13
-#define CPSR_MODE_USER 0x10
-
-#if BOARD_VERSATILEPB
-#  define TIMER_LOAD_VALUE 0x2000
+#if ENABLE_BENCHMARK
+#  include "kernel/bench/bench_latency.h"
 #endif
 
-#if BOARD_EV3
-#  define TIMER_LOAD_VALUE 0x10000
-#endif
+#include <errno.h>
+#include <stdio.h>
 
-#define MAX_TASK_NUMBER 16
+#define CPSR_MODE_SVC  0x13
+#define CPSR_MODE_USER 0x10
 
 int task_count   = 0;
-int buffer_start = 0;
-int buffer_end   = 0;
+int buffer_start __fastdata = 0;
+int buffer_end   __fastdata = 0;
 int isRunning    = 0;
+int need_resched __fastdata = 0;
+unsigned int tick_count __fastdata = 0;
 task_t tasks[MAX_TASK_NUMBER] = { 0 };
-task_t* ring_buffer[MAX_TASK_NUMBER] = { 0 };
-task_t* current_task = (void*)0;
+task_t* ring_buffer[MAX_TASK_NUMBER + 1] __fastdata = { 0 };
+task_t* current_task __fastdata = (void*)0;
 
-// TODO: disable interrupts during insertion
-void
-ring_buffer_insert (task_t *task)
+// sleeping tasks, sorted by their wakeup tick
+static task_t *sleep_list __fastdata = 0;
+
+// runs whenever no other task is ready, never enters the ring buffer
+static task_t idle_task;
+
+// the real-time tasks, see task_periodic in kernel/syscall.h. they never
+// enter the ring buffer either, rt_pick selects them before the normal tasks.
+static unsigned int rt_count __fastdata = 0;
+static unsigned int rt_policy = SCHED_NORMAL;  // the class of all of them
+static unsigned int rt_density = 0;            // in ppm
+
+// the Liu and Layland bound n * (2^(1/n) - 1) in ppm, indexed by n - 1
+static const unsigned int rm_bound[MAX_TASK_NUMBER] =
 {
-  int new_end = (buffer_end + 1) % MAX_TASK_NUMBER;
+  1000000, 828427, 779763, 756828, 743491, 734772, 728626, 724061,
+  720537, 717734, 715451, 713557, 711958, 710592, 709411
+};
+
+// the cpu reservation groups, see task_reserve in kernel/syscall.h
+static struct reservation reservations[RESERVATION_GROUPS];
+static unsigned int reserved_count __fastdata = 0;  // groups in use
+static unsigned int reserved_share = 0;             // in ppm
+
+// the id of a task as reported by taskid, 0 for the idle task
+static inline unsigned int
+task_number (task_t *task)
+{
+  return task == &idle_task ? 0 : task - tasks + 1;
+}
+
+static void
+__fasttext
+ring_buffer_push (task_t *task)
+{
+  int new_end = (buffer_end + 1) % (MAX_TASK_NUMBER + 1);
   if (new_end != buffer_start)
     {
       ring_buffer[buffer_end] = task;
@@ -58,17 +97,37 @@ ring_buffer_insert (task_t *task)
     }
 }
 
+// TODO: disable interrupts during insertion
+void
+__fasttext
+ring_buffer_insert (task_t *task)
+{
+  task->account.since = timer_counter_read();
+  if (task->rt.policy)
+    return;
+
+  ring_buffer_push(task);
+}
+
 task_t*
+__fasttext
 ring_buffer_remove (void)
 {
   if (buffer_start == buffer_end)
     return 0;
 
   task_t* task = ring_buffer[buffer_start];
-  buffer_start = (buffer_start + 1) % MAX_TASK_NUMBER;
+  buffer_start = (buffer_start + 1) % (MAX_TASK_NUMBER + 1);
   return task;
 }
 
+// tasks returning from their entrypoint end up here
+static void
+task_return (void)
+{
+  task_exit();
+}
+
 void
 init_task (task_t *task, void *entrypoint, unsigned int stackbase)
 {
@@ -77,30 +136,490 @@ init_task (task_t *task, void *entrypoint, unsigned int stackbase)
     task->reg[i] = i;
 
   task->sp = stackbase;
-  task->lr = 0;
-  task->lr = 0;
+  task->lr = (unsigned int) &task_return;
   task->pc = (unsigned int) entrypoint;
 
   task->cpsr = CPSR_MODE_USER;
+  task->dacr = MMU_DACR_KERNEL;
+
+  task->state = TASK_READY;
+  task->wakeup = 0;
+  task->brk = 0;
+  task->next = 0;
+  task->waiting = 0;
+  task->wait_next = 0;
+  task->account = (struct task_account) { 0 };
+  task->rt = (struct task_rt) { 0 };
+  task->reservation = 0;
+}
+
+static int
+find_free_slot (void)
+{
+  int slot;
+  for (slot = 0; slot < MAX_TASK_NUMBER; ++slot)
+    if (tasks[slot].state == TASK_UNUSED)
+      return slot;
+
+  return -1;
 }
 
 void
 add_task (void *entrypoint)
 {
-  if (task_count >= MAX_TASK_NUMBER)
+  int slot = find_free_slot();
+  if (slot < 0)
     return;
 
-  unsigned int stackbase = TASK_STACK_BASE_ADDRESS - STACK_SIZE*task_count;
-  init_task(&tasks[task_count], entrypoint, stackbase);
-  ring_buffer_insert(&tasks[task_count]);
+  unsigned int stackbase = TASK_STACK_BASE_ADDRESS(slot);
+  init_task(&tasks[slot], entrypoint, stackbase);
+  tasks[slot].dacr = mmu_init_task(slot);
+  ring_buffer_insert(&tasks[slot]);
   task_count++;
 }
 
+// whether a is due before b
+static inline int
+before (unsigned int a, unsigned int b)
+{
+  return (int)(a - b) < 0;
+}
+
+// whether real-time task a takes precedence over b
+static inline int
+rt_precedes (const task_t *a, const task_t *b)
+{
+  if (rt_policy == SCHED_EDF)
+    return before(a->rt.release + a->rt.deadline,
+                  b->rt.release + b->rt.deadline);
+
+  return a->rt.deadline < b->rt.deadline;
+}
+
+// the ready real-time task to run next, or 0
+static task_t*
+__fasttext
+rt_pick (void)
+{
+  task_t *next = 0;
+  unsigned int i;
+  for (i = 0; i < MAX_TASK_NUMBER; ++i)
+    {
+      task_t *task = &tasks[i];
+      if (task->rt.policy && task->state == TASK_READY && !task->rt.throttled
+          && (!next || rt_precedes(task, next)))
+        next = task;
+    }
+  return next;
+}
+
+// charge the cpu time since the task was last accounted, to the task and
+// to its reservation
+static inline void
+__attribute__((always_inline))
+account_runtime (task_t *task, unsigned int now)
+{
+  unsigned int delta = now - task->account.since;
+  task->account.runtime += delta;
+  task->rt.used += delta;
+
+  struct reservation *res = task->reservation;
+  if (res)
+    {
+      res->used += delta;
+      if (!res->throttled && res->used >= res->budget)
+        {
+          res->throttled = 1;
+          res->throttles++;
+        }
+    }
+}
+
+// the next normal task to run, or 0. tasks of throttled groups are parked
+// until their group is replenished.
+static task_t*
+__fasttext
+pick_normal (void)
+{
+  task_t *task;
+  while ((task = ring_buffer_remove())
+         && task->reservation && task->reservation->throttled)
+    {
+      task_t **pos = &task->reservation->parked;
+      while (*pos)
+        pos = &(*pos)->next;
+      *pos = task;
+      task->next = 0;
+    }
+  return task;
+}
+
 void
+__fasttext
 schedule (void)
 {
-  ring_buffer_insert(current_task);
-  current_task = ring_buffer_remove();
+  need_resched = 0;
+
+  unsigned int now = timer_counter_read();
+  task_t *prev = current_task;
+  account_runtime(prev, now);
+  int preempted = prev->state == TASK_RUNNING && !prev->account.yielded;
+  prev->account.yielded = 0;
+
+  if (current_task->state == TASK_RUNNING && current_task != &idle_task)
+    {
+      current_task->state = TASK_READY;
+      ring_buffer_insert(current_task);
+    }
+
+  current_task = rt_count ? rt_pick() : 0;
+  if (!current_task)
+    current_task = pick_normal();
+  if (!current_task)
+    current_task = &idle_task;
+
+  current_task->state = TASK_RUNNING;
+  if (current_task != prev)
+    {
+      trace(TRACE_SWITCH, task_number(prev), task_number(current_task));
+      if (preempted)
+        prev->account.switches_preempted++;
+      else
+        prev->account.switches_voluntary++;
+
+      // the idle task is never made ready, it just runs
+      struct task_account *account = &current_task->account;
+      if (current_task != &idle_task)
+        {
+          unsigned int latency = now - account->since;
+          account->wait_time += latency;
+          if (latency > account->max_latency)
+            account->max_latency = latency;
+        }
+    }
+  current_task->account.since = now;
+}
+
+static void
+__fasttext
+wait_queue_remove (task_t *task)
+{
+  task_t **pos = &task->waiting->head;
+  while (*pos != task)
+    pos = &(*pos)->wait_next;
+  *pos = task->wait_next;
+
+  task->waiting = 0;
+  task->wait_next = 0;
+}
+
+// bring the accounting of the running task up to date
+static void
+__fasttext
+charge_current_task (void)
+{
+  unsigned int now = timer_counter_read();
+  account_runtime(current_task, now);
+  current_task->account.since = now;
+}
+
+// start the next job of a real-time task
+static void
+__fasttext
+rt_release (task_t *task)
+{
+  task->rt.release += task->rt.period;
+  task->rt.used = 0;
+  task->rt.done = 0;
+  task->rt.missed = 0;
+  task->rt.throttled = 0;
+  task->rt.jobs++;
+}
+
+// enforce the budget of the running job, count the missed deadlines and
+// release the jobs that are due
+static void
+__fasttext
+rt_tick (void)
+{
+  if (current_task->rt.policy)
+    {
+      charge_current_task();
+      struct task_rt *rt = &current_task->rt;
+      if (!rt->throttled && rt->used >= rt->budget)
+        {
+          rt->throttled = 1;
+          rt->overruns++;
+        }
+    }
+
+  unsigned int i;
+  for (i = 0; i < MAX_TASK_NUMBER; ++i)
+    {
+      struct task_rt *rt = &tasks[i].rt;
+      if (!rt->policy)
+        continue;
+
+      if (!rt->done && !rt->missed
+          && !before(tick_count, rt->release + rt->deadline))
+        {
+          rt->missed = 1;
+          rt->deadline_misses++;
+        }
+
+      if (!before(tick_count, rt->release + rt->period))
+        rt_release(&tasks[i]);
+    }
+}
+
+// let the parked tasks of a reservation run again
+static void
+__fasttext
+reserve_unpark (struct reservation *res)
+{
+  res->throttled = 0;
+  while (res->parked)
+    {
+      task_t *task = res->parked;
+      res->parked = task->next;
+      task->next = 0;
+      ring_buffer_push(task);
+    }
+}
+
+// start a new window of a reservation, time used beyond the budget is
+// taken from it
+static void
+__fasttext
+reserve_replenish (struct reservation *res)
+{
+  res->start += res->window;
+  if (before(res->start + res->window, tick_count))
+    res->start = tick_count;
+
+  res->used = res->used > res->budget ? res->used - res->budget : 0;
+  if (res->used < res->budget)
+    reserve_unpark(res);
+  else
+    res->throttles++;
+}
+
+// enforce the budget of the running task's group and replenish the groups
+// whose window ended
+static void
+__fasttext
+reserve_tick (void)
+{
+  if (current_task->reservation)
+    charge_current_task();
+
+  unsigned int i;
+  for (i = 0; i < RESERVATION_GROUPS; ++i)
+    {
+      struct reservation *res = &reservations[i];
+      if (res->members && !before(tick_count, res->start + res->window))
+        reserve_replenish(res);
+    }
+}
+
+void
+__fasttext
+scheduler_tick (void)
+{
+  ++tick_count;
+
+  while (sleep_list && (int)(tick_count - sleep_list->wakeup) >= 0)
+    {
+      task_t *task = sleep_list;
+      sleep_list = task->next;
+      task->next = 0;
+      if (task->waiting)
+        wait_queue_remove(task);
+      task->state = TASK_READY;
+      ring_buffer_insert(task);
+      trace(TRACE_WAKE, task_number(task), 0);
+    }
+
+  if (rt_count)
+    rt_tick();
+  if (reserved_count)
+    reserve_tick();
+
+  schedule();
+}
+
+static void
+__fasttext
+timer_interrupt (void)
+{
+  timer_ack();
+#if ENABLE_BENCHMARK
+  latency_tick();
+#endif
+  profile_sample();
+  softirq_raise(SOFTIRQ_TIMER);
+  scheduler_tick();
+}
+
+// the protocol timers, run as a bottom half of the timer interrupt
+static unsigned int
+__fasttext
+timer_softirq (unsigned int budget)
+{
+  timeout_run();
+  net_tick();
+  return 1;
+}
+
+void
+yield_current_task (void)
+{
+  current_task->account.yielded = 1;
+}
+
+void
+sleep_current_task (unsigned int ticks)
+{
+  task_t *task = current_task;
+  task->state = TASK_SLEEPING;
+  task->wakeup = tick_count + ticks;
+
+  task_t **pos = &sleep_list;
+  while (*pos && (int)((*pos)->wakeup - task->wakeup) <= 0)
+    pos = &(*pos)->next;
+
+  task->next = *pos;
+  *pos = task;
+}
+
+void
+block_current_task (wait_queue_t *queue, unsigned int timeout)
+{
+  task_t *task = current_task;
+  trace(TRACE_BLOCK, (unsigned int) queue, timeout);
+  if (timeout)
+    sleep_current_task(timeout);
+
+  task->state = TASK_BLOCKED;
+  task->waiting = queue;
+  task->wait_next = queue->head;
+  queue->head = task;
+}
+
+void
+wake_up (wait_queue_t *queue)
+{
+  // bottom halves wake up tasks with interrupts enabled, keep the timer
+  // interrupt out of the run queue and the sleep list meanwhile
+  unsigned int flags = irq_save();
+  while (queue->head)
+    {
+      task_t *task = queue->head;
+      queue->head = task->wait_next;
+      task->waiting = 0;
+      task->wait_next = 0;
+
+      // drop the timeout
+      task_t **pos = &sleep_list;
+      while (*pos && *pos != task)
+        pos = &(*pos)->next;
+      if (*pos)
+        *pos = task->next;
+      task->next = 0;
+
+      task->state = TASK_READY;
+      ring_buffer_insert(task);
+      trace(TRACE_WAKE, task_number(task), 0);
+      need_resched = 1;
+    }
+  irq_restore(flags);
+}
+
+// move a task back to the normal class
+static void
+rt_leave (task_t *task)
+{
+  if (!task->rt.policy)
+    return;
+
+  rt_count--;
+  rt_density -= task->rt.density;
+  task->rt = (struct task_rt) { 0 };
+}
+
+// take a task out of its reservation group, the task must not be parked
+static void
+reserve_leave (task_t *task)
+{
+  struct reservation *res = task->reservation;
+  if (!res)
+    return;
+
+  task->reservation = 0;
+  if (--res->members)
+    return;
+
+  reserved_count--;
+  reserved_share -= res->share;
+  *res = (struct reservation) { 0 };
+}
+
+void
+exit_current_task (void)
+{
+  trace(TRACE_EXIT, task_number(current_task), 0);
+  rt_leave(current_task);
+  reserve_leave(current_task);
+  socket_release_task();
+  mmu_release_task(current_task - tasks);
+  current_task->state = TASK_UNUSED;
+  task_count--;
+
+#if ENABLE_BENCHMARK
+  // the benchmarks are done when their last task exits, see scripts/bench.py
+  if (!task_count)
+    {
+      puts("bench: done");
+      system_reset();
+    }
+#endif
+}
+
+void
+fork_current_task (void)
+{
+  task_t *parent = current_task;
+  int slot = find_free_slot();
+  if (slot < 0)
+    {
+      parent->reg[0] = -EAGAIN;
+      return;
+    }
+
+  unsigned int parent_slot = parent - tasks;
+  unsigned int parent_base = TASK_REGION_BASE(parent_slot);
+  unsigned int offset = TASK_REGION_BASE(slot) - parent_base;
+
+  task_t *child = &tasks[slot];
+  *child = *parent;
+  child->sp += offset;
+  if (child->reg[11] - parent_base < TASK_REGION_SIZE)
+    child->reg[11] += offset;
+  child->reg[0] = 0;
+  child->state = TASK_READY;
+  child->next = 0;
+  child->account = (struct task_account) { 0 };
+  child->rt = (struct task_rt) { 0 };
+  if (child->reservation)
+    child->reservation->members++;
+
+  child->dacr = mmu_init_task(slot);
+  mmu_fork_task(parent_slot, slot);
+
+  ring_buffer_insert(child);
+  task_count++;
+
+  parent->reg[0] = slot + 1;
 }
 
 void
@@ -108,11 +627,199 @@ start_scheduler (void)
 {
   if (!isRunning)
     {
+      init_task(&idle_task, &idle_loop, 0);
+
       current_task = ring_buffer_remove();
+      if (!current_task)
+        current_task = &idle_task;
+      current_task->state = TASK_RUNNING;
+
       isRunning = 1;
       timer_stop();
+      timer_counter_start();
+
+      // the tasks were made ready before the counter ran
+      unsigned int now = timer_counter_read();
+      unsigned int i;
+      for (i = 0; i < MAX_TASK_NUMBER; ++i)
+        tasks[i].account.since = now;
+      idle_task.account.since = now;
+      softirq_register(SOFTIRQ_TIMER, "timer", &timer_softirq, 0);
+      interrupt_register(TIMER_IRQ, &timer_interrupt);
       init_interrupt_handling();
-      timer_start(TIMER_LOAD_VALUE);
-      load_current_task_state();
+      mmu_init();
+      timer_start(BOARD_TIMER_PERIOD);
+
+      start_first_task();
     }
 }
+
+int
+sys_task_stats (unsigned int id, struct task_stats *stats)
+{
+  if (!mmu_user_range((unsigned int) stats, sizeof(*stats)))
+    return -EFAULT;
+
+  task_t *task;
+  if (id == 0)
+    task = &idle_task;
+  else if (id <= MAX_TASK_NUMBER && tasks[id - 1].state != TASK_UNUSED)
+    task = &tasks[id - 1];
+  else
+    return -EINVAL;
+
+  // the calling task is running right now
+  struct task_account *account = &task->account;
+  unsigned long long runtime = account->runtime;
+  if (task == current_task)
+    runtime += timer_counter_read() - account->since;
+
+  stats->state = task->state;
+  stats->runtime_us = runtime / TIMER_COUNTER_MHZ;
+  stats->wait_us = account->wait_time / TIMER_COUNTER_MHZ;
+  stats->max_latency_us = account->max_latency / TIMER_COUNTER_MHZ;
+  stats->switches_voluntary = account->switches_voluntary;
+  stats->switches_preempted = account->switches_preempted;
+  stats->policy = task->rt.policy;
+  stats->jobs = task->rt.jobs;
+  stats->deadline_misses = task->rt.deadline_misses;
+  stats->overruns = task->rt.overruns;
+  stats->group = task->reservation ? task->reservation - reservations + 1 : 0;
+  stats->throttles = task->reservation ? task->reservation->throttles : 0;
+  return 0;
+}
+
+int
+sys_task_periodic (unsigned int policy, unsigned int period_us,
+                   unsigned int budget_us, unsigned int deadline_us)
+{
+  if (policy == SCHED_NORMAL)
+    {
+      rt_leave(current_task);
+      return 0;
+    }
+
+  if (!deadline_us)
+    deadline_us = period_us;
+  if ((policy != SCHED_EDF && policy != SCHED_RM) || !budget_us
+      || budget_us > deadline_us || deadline_us > period_us
+      || period_us > 0x7FFFFFFF || budget_us > 0xFFFFFFFF / TIMER_COUNTER_MHZ)
+    return -EINVAL;
+  if (current_task->reservation)
+    return -EBUSY;
+
+  // releases happen on ticks, round to the side that keeps the guarantee
+  unsigned int period = (period_us + TICK_US - 1) / TICK_US;
+  unsigned int deadline = deadline_us / TICK_US;
+  if (!deadline)
+    return -EINVAL;
+  unsigned int density =
+    (unsigned long long) budget_us * 1000000 / (deadline * TICK_US);
+
+  // admission control, the task may already be admitted with other
+  // parameters
+  struct task_rt *rt = &current_task->rt;
+  unsigned int count = rt_count + !rt->policy;
+  unsigned int others = rt_density - rt->density;
+  if (count > 1 && rt_policy != policy)
+    return -EBUSY;
+  unsigned int bound = policy == SCHED_EDF ? 1000000 : rm_bound[count - 1];
+  if (others + density > bound)
+    return -EBUSY;
+
+  // the first job is released right away
+  charge_current_task();
+  rt_count = count;
+  rt_policy = policy;
+  rt_density = others + density;
+  *rt = (struct task_rt) { 0 };
+  rt->policy = policy;
+  rt->period = period;
+  rt->deadline = deadline;
+  rt->budget = budget_us * TIMER_COUNTER_MHZ;
+  rt->density = density;
+  rt->release = tick_count;
+  rt->jobs = 1;
+
+  // another real-time task may take precedence
+  need_resched = 1;
+  return 0;
+}
+
+int
+sys_task_wait_period (void)
+{
+  struct task_rt *rt = &current_task->rt;
+  if (!rt->policy)
+    return -EINVAL;
+
+  // the next release is always in the future, it happens on the tick that
+  // reaches it
+  rt->done = 1;
+  sleep_current_task(rt->release + rt->period - tick_count);
+  need_resched = 1;
+  return 0;
+}
+
+// move the current task into a group, the task is running and thus not
+// parked
+static void
+reserve_join (struct reservation *res)
+{
+  if (current_task->reservation == res)
+    return;
+
+  reserve_leave(current_task);
+  if (!res->members++)
+    reserved_count++;
+  current_task->reservation = res;
+}
+
+int
+sys_task_reserve (unsigned int group, unsigned int budget_us,
+                  unsigned int window_us)
+{
+  if (group > RESERVATION_GROUPS)
+    return -EINVAL;
+  if (current_task->rt.policy)
+    return -EBUSY;
+
+  // the time so far belongs to the old group
+  charge_current_task();
+  if (!group)
+    {
+      reserve_leave(current_task);
+      return 0;
+    }
+
+  struct reservation *res = &reservations[group - 1];
+  if (!budget_us)
+    {
+      if (!res->members)
+        return -EINVAL;
+      reserve_join(res);
+      return 0;
+    }
+
+  if (budget_us > window_us || window_us > 0x7FFFFFFF
+      || budget_us > 0xFFFFFFFF / TIMER_COUNTER_MHZ)
+    return -EINVAL;
+
+  unsigned int window = (window_us + TICK_US - 1) / TICK_US;
+  unsigned int share =
+    (unsigned long long) budget_us * 1000000 / (window * TICK_US);
+  if (reserved_share - res->share + share > 1000000)
+    return -EBUSY;
+
+  reserve_join(res);
+
+  // the group starts over with a fresh window
+  reserved_share = reserved_share - res->share + share;
+  res->budget = budget_us * TIMER_COUNTER_MHZ;
+  res->window = window;
+  res->share = share;
+  res->start = tick_count;
+  res->used = 0;
+  reserve_unpark(res);
+  return 0;
+}
@@ -24,6 +24,73 @@
 #  include <config.h>
 #endif
 
+#include "kernel/board.h"
+
+// one memory domain per task, domain 0 belongs to the kernel
+#define MAX_TASK_NUMBER 15
+
+enum task_state
+{
+  TASK_UNUSED = 0,
+  TASK_READY,
+  TASK_RUNNING,
+  TASK_SLEEPING,
+  TASK_BLOCKED
+};
+typedef enum task_state task_state;
+
+/* cpu accounting of a task, maintained by the scheduler in ticks of the free
+ * running counter, see timer_counter_read
+ */
+struct task_account
+{
+  unsigned long long runtime;
+  unsigned long long wait_time;  // ready but not running
+  unsigned int max_latency;      // longest time from ready to running
+  unsigned int switches_voluntary;
+  unsigned int switches_preempted;
+  unsigned int since;            // when the task started running or waiting
+  int yielded;
+};
+
+/* the real-time parameters of a periodic task, see task_periodic in
+ * kernel/syscall.h. periods and deadlines are in timer ticks, budgets in
+ * ticks of the free running counter.
+ */
+struct task_rt
+{
+  unsigned int policy;           // SCHED_NORMAL for tasks of the normal class
+  unsigned int period;
+  unsigned int deadline;         // relative to the release
+  unsigned int budget;
+  unsigned int density;          // budget per deadline in ppm
+  unsigned int release;          // tick of the release of the current job
+  unsigned int used;             // cpu time of the current job
+  int done;                      // the current job completed
+  int missed;                    // the current job missed its deadline
+  int throttled;                 // the current job used up its budget
+  unsigned int jobs;
+  unsigned int deadline_misses;
+  unsigned int overruns;         // jobs that were throttled
+};
+
+/* a cpu reservation shared by a group of normal tasks, see task_reserve in
+ * kernel/syscall.h. windows are in timer ticks, budgets in ticks of the
+ * free running counter.
+ */
+struct reservation
+{
+  unsigned int budget;
+  unsigned int window;
+  unsigned int share;            // budget per window in ppm
+  unsigned int start;            // tick of the start of the current window
+  unsigned int used;             // cpu time in the current window
+  int throttled;                 // the budget of the window is used up
+  unsigned int members;          // 0 if the reservation is unused
+  unsigned int throttles;        // windows in which the group was throttled
+  struct task_t *parked;         // ready tasks held back while throttled
+};
+
 struct task_t
 {
   // r01..r12, sp, lr, pc
@@ -32,13 +99,143 @@ struct task_t
 	unsigned int lr;
 	unsigned int pc;
 	unsigned int cpsr;
+	unsigned int dacr;  // domain access control, see kernel/mmu.h
+
+	// scheduler bookkeeping, not touched by the context switch code
+	task_state state;
+	unsigned int wakeup;
+	unsigned int brk;   // heap size, the heap starts at the task region base
+	struct task_t *next;
+	struct wait_queue *waiting;  // the queue a blocked task waits on
+	struct task_t *wait_next;
+	struct task_account account;
+	struct task_rt rt;
+	struct reservation *reservation;  // 0 if the task is not in a group
 };
 typedef struct task_t task_t;
 
+/* tasks blocked until an event, e.g. the arrival of a packet */
+struct wait_queue
+{
+  task_t *head;
+};
+typedef struct wait_queue wait_queue_t;
+
+struct task_stats;
+
+extern task_t tasks[MAX_TASK_NUMBER];
+
 extern task_t *current_task;
 
+/* set by the kernel whenever the current task has to give up the cpu before
+ * returning to user mode, e.g. because it blocked in a syscall
+ */
+extern int need_resched;
+
+/* the number of timer ticks since the scheduler was started */
+extern unsigned int tick_count;
+
+/* the number of tasks in the system, not counting the idle task */
+extern int task_count;
+
+// length of a timer tick in microseconds, see BOARD_TIMER_PERIOD
+#define TICK_US BOARD_TICK_US
+
+#define MS_TO_TICKS(MS) (((MS) * 1000 + TICK_US - 1) / TICK_US)
+
 void add_task (void *entrypoint);
 
 void start_scheduler (void);
 
 void schedule (void);
+
+/* called from the timer interrupt, advances the tick count, wakes up expired
+ * sleepers and selects the next task to run
+ */
+void scheduler_tick (void);
+
+/* give up the cpu, the current task stays ready
+ *
+ * like sleep_current_task, the caller has to switch to another task. the
+ * switch is accounted as voluntary.
+ */
+void yield_current_task (void);
+
+/* put the current task to sleep for the given number of ticks
+ *
+ * the task is only removed from the run queue, the caller is responsible for
+ * switching to another task, usually by setting need_resched
+ */
+void sleep_current_task (unsigned int ticks);
+
+/* block the current task on a wait queue
+ *
+ * like sleep_current_task, the caller has to switch to another task. the
+ * task becomes ready again when the queue is woken up or, if timeout is not
+ * zero, after timeout ticks. syscalls that block return a value telling
+ * the task to retry the call once it runs again.
+ */
+void block_current_task (wait_queue_t *queue, unsigned int timeout);
+
+/* make all tasks blocked on the queue ready, may be called from interrupt
+ * handlers and bottom halves. sets need_resched if a task was woken.
+ */
+void wake_up (wait_queue_t *queue);
+
+/* remove the current task from the system, its slot is free to be reused
+ * once the scheduler switched away from it
+ */
+void exit_current_task (void);
+
+/* copy the cpu accounting of a task, see task_stats in kernel/syscall.h
+ *
+ * params:
+ *   id - the task id as reported by taskid, or 0 for the idle task
+ *
+ * returns:
+ *   0 on success, -EINVAL if no task with the id exists or -EFAULT if
+ *   stats is not writable by the task
+ */
+int sys_task_stats (unsigned int id, struct task_stats *stats);
+
+/* make the current task a periodic real-time task or a normal task again,
+ * see task_periodic in kernel/syscall.h
+ *
+ * returns:
+ *   0 on success, -EINVAL for invalid parameters or -EBUSY if admitting
+ *   the task would make the real-time tasks unschedulable or the task is
+ *   in a reservation group
+ */
+int sys_task_periodic (unsigned int policy, unsigned int period_us,
+                       unsigned int budget_us, unsigned int deadline_us);
+
+/* complete the current job of a periodic task and sleep until the next
+ * release
+ *
+ * returns:
+ *   0 on success, -EINVAL if the task is not periodic
+ */
+int sys_task_wait_period (void);
+
+/* move the current task into a cpu reservation group, or out of it, see
+ * task_reserve in kernel/syscall.h
+ *
+ * returns:
+ *   0 on success, -EINVAL for invalid parameters or -EBUSY if the task is
+ *   a real-time task or the reservations would exceed the cpu
+ */
+int sys_task_reserve (unsigned int group, unsigned int budget_us,
+                      unsigned int window_us);
+
+/* create a copy of the current task, whose state must have been saved to
+ * current_task
+ *
+ * the memory of the task region is shared copy-on-write, the stack pointer
+ * and frame pointer are moved to the region of the child. pointers into the
+ * stack that are stored in memory still point into the parent's region, so
+ * the child must not use them.
+ *
+ * the result is stored in the saved r0 of both tasks: the child's task id in
+ * the parent, 0 in the child, or -EAGAIN if no slot is free
+ */
+void fork_current_task (void);
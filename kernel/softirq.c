@@ -0,0 +1,134 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "softirq.h"
+
+#include "kernel/memory.h"
+#include "kernel/interrupt.h"
+#include "kernel/mmu.h"
+#include "kernel/trace.h"
+#include "kernel/drivers/timer.h"
+
+#include <errno.h>
+#include <string.h>
+
+struct softirq_action
+{
+  softirq_handler_t handler;
+  unsigned int budget;
+  struct softirq_stats stats;
+};
+
+unsigned int softirq_pending __fastdata = 0;
+
+static struct softirq_action softirqs[SOFTIRQ_COUNT] __fastdata = { { 0 } };
+
+void
+softirq_register (unsigned int nr, const char *name,
+                  softirq_handler_t handler, unsigned int budget)
+{
+  softirqs[nr].handler = handler;
+  softirqs[nr].budget = budget;
+  softirqs[nr].stats.name = name;
+}
+
+void
+__fasttext
+softirq_raise (unsigned int nr)
+{
+  unsigned int flags = irq_save();
+  softirq_pending |= 1 << nr;
+  softirqs[nr].stats.raised++;
+  irq_restore(flags);
+
+  // a syscall returns to its task without looking at the pending softirqs
+  if (in_syscall())
+    interrupt_resched();
+}
+
+void
+__fasttext
+softirq_run (void)
+{
+  unsigned int round;
+  for (round = 0; round < SOFTIRQ_ROUNDS; ++round)
+    {
+      unsigned int flags = irq_save();
+      unsigned int pending = softirq_pending;
+      softirq_pending = 0;
+      irq_restore(flags);
+
+      if (!pending)
+        return;
+
+      while (pending)
+        {
+          unsigned int nr = __builtin_ctz(pending);
+          pending &= pending - 1;
+
+          struct softirq_action *softirq = &softirqs[nr];
+          if (!softirq->handler)
+            continue;
+
+          trace(TRACE_SOFTIRQ_ENTRY, nr, 0);
+          unsigned int start = timer_counter_read();
+          unsigned int work = softirq->handler(softirq->budget);
+          unsigned int us = (timer_counter_read() - start) / TIMER_COUNTER_MHZ;
+          trace(TRACE_SOFTIRQ_EXIT, nr, work);
+
+          struct softirq_stats *stats = &softirq->stats;
+          stats->runs++;
+          stats->work += work;
+          stats->time_us += us;
+          if (us > stats->max_us)
+            stats->max_us = us;
+          if (softirq->budget && work >= softirq->budget)
+            stats->exhausted++;
+        }
+    }
+
+  // whatever is still pending runs at the next interrupt
+  unsigned int pending = softirq_pending;
+  while (pending)
+    {
+      unsigned int nr = __builtin_ctz(pending);
+      pending &= pending - 1;
+      softirqs[nr].stats.deferred++;
+    }
+}
+
+const struct softirq_stats*
+softirq_stats (unsigned int nr)
+{
+  return &softirqs[nr].stats;
+}
+
+int
+sys_softirq_stats (unsigned int nr, struct softirq_stats *stats)
+{
+  if (nr >= SOFTIRQ_COUNT)
+    return -EINVAL;
+  if (!mmu_user_range((unsigned int) stats, sizeof(*stats)))
+    return -EFAULT;
+
+  // the statistics are fastdata, which tasks can't read on every board
+  memcpy(stats, &softirqs[nr].stats, sizeof(*stats));
+  return 0;
+}
@@ -0,0 +1,106 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* bottom halves, the deferred part of interrupt handling
+ *
+ * interrupt handlers only deal with the hardware and raise a softirq for the
+ * rest of the work. pending softirqs run when irq_handler is about to return
+ * to a task, in svc mode on the svc stack with interrupts enabled, and before
+ * the scheduler picks the next task. they never run concurrently with a
+ * syscall, which runs with interrupts disabled, so the two may share data
+ * freely. data shared with interrupt handlers has to be guarded with
+ * irq_save, see kernel/interrupt.h.
+ *
+ * softirqs with lower numbers run first
+ */
+enum softirq
+{
+  SOFTIRQ_TIMER = 0,
+  SOFTIRQ_NET_RX,
+  SOFTIRQ_COUNT
+};
+
+// rounds over the pending softirqs per interrupt, work left after that
+// waits for the next interrupt so that a flood of packets can't keep the
+// tasks from running
+#define SOFTIRQ_ROUNDS 4
+
+/* bottom half handler
+ *
+ * a handler that does not get through its work in one run does at most
+ * budget units of it, e.g. received packets, and raises its softirq again.
+ *
+ * returns:
+ *   the units of work done
+ */
+typedef unsigned int (*softirq_handler_t) (unsigned int budget);
+
+struct softirq_stats
+{
+  const char *name;
+  unsigned int raised;
+  unsigned int runs;
+  unsigned int work;
+  unsigned int exhausted;      // runs that used up the budget
+  unsigned int deferred;       // times the work was left to the next interrupt
+  unsigned int time_us;        // total time spent in the handler
+  unsigned int max_us;         // longest run of the handler
+};
+
+/* the bit mask of raised softirqs, checked by irq_handler */
+extern unsigned int softirq_pending;
+
+/* install the handler of a softirq
+ *
+ * params:
+ *   nr      - one of the SOFTIRQ_ constants
+ *   name    - shown in the statistics
+ *   handler - the function to call while the softirq is pending
+ *   budget  - the units of work per run passed to the handler, 0 for
+ *             handlers that always get through their work
+ */
+void softirq_register (unsigned int nr, const char *name,
+                       softirq_handler_t handler, unsigned int budget);
+
+/* mark a softirq as pending, may be called from interrupt handlers, bottom
+ * halves and syscalls. softirqs raised by a syscall run as soon as it
+ * returns, see interrupt_resched.
+ */
+void softirq_raise (unsigned int nr);
+
+/* run the pending softirqs for up to SOFTIRQ_ROUNDS rounds, called by
+ * irq_handler with interrupts enabled
+ */
+void softirq_run (void);
+
+/* returns the statistics of a softirq
+ */
+const struct softirq_stats* softirq_stats (unsigned int nr);
+
+/* copy the statistics of a softirq to a task, see softirq_read in
+ * kernel/syscall.h
+ */
+int sys_softirq_stats (unsigned int nr, struct softirq_stats *stats);
@@ -0,0 +1,162 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "syscall.h"
+
+#include "kernel/memory.h"
+#include "kernel/mmu.h"
+#include "kernel/profile.h"
+#include "kernel/scheduler.h"
+#include "kernel/softirq.h"
+#include "kernel/trace.h"
+#include "kernel/bench/bench_latency.h"
+#include "kernel/net/dns.h"
+#include "kernel/net/net.h"
+#include "kernel/net/socket.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+// the arguments are passed through in r0-r3 untouched
+typedef int (*syscall_fn) ();
+
+/* the syscalls are called from swi_handler with interrupts disabled
+ *
+ * a syscall that blocks or gives up the cpu sets need_resched, all other
+ * syscalls return straight to the calling task without a pass through the
+ * scheduler.
+ */
+
+int
+sys_invalid (void)
+{
+  return -ENOSYS;
+}
+
+static int
+sys_null (void)
+{
+  return 0;
+}
+
+static int
+sys_yield (void)
+{
+  yield_current_task();
+  need_resched = 1;
+  return 0;
+}
+
+static int
+sys_sleep (unsigned int ticks)
+{
+  if (ticks == 0)
+    return sys_yield();
+
+  trace(TRACE_SLEEP, ticks, 0);
+  sleep_current_task(ticks);
+  need_resched = 1;
+  return 0;
+}
+
+static int
+sys_exit (void)
+{
+  exit_current_task();
+  need_resched = 1;
+  return 0;
+}
+
+static int
+sys_taskid (void)
+{
+  return current_task - tasks + 1;
+}
+
+static int
+sys_uptime (void)
+{
+  return tick_count;
+}
+
+static int
+sys_write (const char *buf, unsigned int len)
+{
+  // the kernel may read memory the task can't, e.g. the page pool
+  if (!mmu_user_range((unsigned int) buf, len))
+    return -EFAULT;
+
+  unsigned int i;
+  for (i = 0; i < len; ++i)
+    if (__builtin_expect(putchar(buf[i]) == EOF, 0))
+      break;
+
+  return i;
+}
+
+// the heap may grow up to the packet buffer window below the stack
+static int
+sys_sbrk (int increment)
+{
+  unsigned int brk = current_task->brk;
+  if (increment < 0 || brk + increment > TASK_HEAP_LIMIT)
+    return -ENOMEM;
+
+  current_task->brk += increment;
+  return TASK_REGION_BASE(current_task - tasks) + brk;
+}
+
+const syscall_fn syscall_table[SYSCALL_COUNT] =
+{
+  [SYSCALL_NULL]   = &sys_null,
+  [SYSCALL_YIELD]  = &sys_yield,
+  [SYSCALL_SLEEP]  = &sys_sleep,
+  [SYSCALL_EXIT]   = &sys_exit,
+  [SYSCALL_TASKID] = &sys_taskid,
+  [SYSCALL_WRITE]  = &sys_write,
+  [SYSCALL_FORK]   = &sys_invalid,  // handled in swi_handler
+  [SYSCALL_SBRK]   = &sys_sbrk,
+  [SYSCALL_SOCKET]    = &sys_socket,
+  [SYSCALL_BIND]      = &sys_bind,
+  [SYSCALL_SENDTO]    = &sys_sendto,
+  [SYSCALL_RECVFROM]  = &sys_recvfrom,
+  [SYSCALL_CLOSE]     = &sys_close,
+  [SYSCALL_RECV_ZC]   = &sys_recv_zc,
+  [SYSCALL_ZC_ALLOC]  = &sys_zc_alloc,
+  [SYSCALL_ZC_FREE]   = &sys_zc_free,
+  [SYSCALL_SENDTO_ZC] = &sys_sendto_zc,
+  [SYSCALL_CONNECT]   = &sys_connect,
+  [SYSCALL_LISTEN]    = &sys_listen,
+  [SYSCALL_ACCEPT]    = &sys_accept,
+  [SYSCALL_SEND]      = &sys_send,
+  [SYSCALL_RECV]      = &sys_recv,
+  [SYSCALL_SETSOCKOPT] = &sys_setsockopt,
+  [SYSCALL_RESOLVE]    = &sys_resolve,
+  [SYSCALL_NETIF_TUNE] = &sys_netif_tune,
+  [SYSCALL_PROFILE]    = &sys_profile,
+  [SYSCALL_TRACE]      = &sys_trace,
+  [SYSCALL_TASK_STATS] = &sys_task_stats,
+  [SYSCALL_TASK_PERIODIC] = &sys_task_periodic,
+  [SYSCALL_WAIT_PERIOD]   = &sys_task_wait_period,
+  [SYSCALL_TASK_RESERVE]  = &sys_task_reserve,
+  [SYSCALL_UPTIME]        = &sys_uptime,
+  [SYSCALL_LATENCY]       = &sys_latency_read,
+  [SYSCALL_SOFTIRQ_STATS] = &sys_softirq_stats,
+};
@@ -0,0 +1,704 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* syscall numbers, passed to the kernel in r7
+ *
+ * the arguments are passed in r0-r3, the return value is passed back in r0.
+ * this header is also included by the syscall entry code in
+ * interrupt_handler.S, so only preprocessor definitions are visible there.
+ */
+#define SYSCALL_NULL   0
+#define SYSCALL_YIELD  1
+#define SYSCALL_SLEEP  2
+#define SYSCALL_EXIT   3
+#define SYSCALL_TASKID 4
+#define SYSCALL_WRITE  5
+#define SYSCALL_FORK   6
+#define SYSCALL_SBRK   7
+#define SYSCALL_SOCKET     8
+#define SYSCALL_BIND       9
+#define SYSCALL_SENDTO     10
+#define SYSCALL_RECVFROM   11
+#define SYSCALL_CLOSE      12
+#define SYSCALL_RECV_ZC    13
+#define SYSCALL_ZC_ALLOC   14
+#define SYSCALL_ZC_FREE    15
+#define SYSCALL_SENDTO_ZC  16
+#define SYSCALL_CONNECT    17
+#define SYSCALL_LISTEN     18
+#define SYSCALL_ACCEPT     19
+#define SYSCALL_SEND       20
+#define SYSCALL_RECV       21
+#define SYSCALL_SETSOCKOPT 22
+#define SYSCALL_RESOLVE    23
+#define SYSCALL_NETIF_TUNE 24
+#define SYSCALL_PROFILE    25
+#define SYSCALL_TRACE      26
+#define SYSCALL_TASK_STATS 27
+#define SYSCALL_TASK_PERIODIC 28
+#define SYSCALL_WAIT_PERIOD   29
+#define SYSCALL_TASK_RESERVE  30
+#define SYSCALL_UPTIME        31
+#define SYSCALL_LATENCY       32
+#define SYSCALL_SOFTIRQ_STATS 33
+
+#define SYSCALL_COUNT  34
+
+// scheduling classes, see task_periodic
+#define SCHED_NORMAL 0
+#define SCHED_EDF    1
+#define SCHED_RM     2
+
+// the number of cpu reservation groups, see task_reserve
+#define RESERVATION_GROUPS 4
+
+#ifndef __ASSEMBLER__
+
+#include <errno.h>
+
+/* trap into the kernel
+ *
+ * r1-r3 are clobbered by the kernel, all other registers are preserved.
+ */
+#if __arm__
+static inline int
+syscall (unsigned int number, unsigned int arg0, unsigned int arg1,
+         unsigned int arg2, unsigned int arg3)
+{
+  register unsigned int r0 asm ("r0") = arg0;
+  register unsigned int r1 asm ("r1") = arg1;
+  register unsigned int r2 asm ("r2") = arg2;
+  register unsigned int r3 asm ("r3") = arg3;
+  register unsigned int r7 asm ("r7") = number;
+
+  asm volatile (
+    "swi  #0\n"
+    : "+r" (r0), "+r" (r1), "+r" (r2), "+r" (r3)
+    : "r" (r7)
+    : "memory"
+  );
+
+  return r0;
+}
+#else
+// the host build, see host/, provides a mock
+int syscall (unsigned int number, unsigned int arg0, unsigned int arg1,
+             unsigned int arg2, unsigned int arg3);
+#endif
+
+/* do nothing, used to measure the syscall round-trip cost */
+static inline int
+syscall_null (void)
+{
+  return syscall(SYSCALL_NULL, 0, 0, 0, 0);
+}
+
+/* give up the cpu, the task is put at the end of the run queue */
+static inline void
+task_yield (void)
+{
+  syscall(SYSCALL_YIELD, 0, 0, 0, 0);
+}
+
+/* sleep for at least the given number of scheduler ticks */
+static inline void
+task_sleep (unsigned int ticks)
+{
+  syscall(SYSCALL_SLEEP, ticks, 0, 0, 0);
+}
+
+/* terminate the calling task, does not return */
+static inline void
+task_exit (void)
+{
+  syscall(SYSCALL_EXIT, 0, 0, 0, 0);
+  while (1);
+}
+
+/* returns:
+ *   the id of the calling task, task ids start at 1
+ */
+static inline int
+task_id (void)
+{
+  return syscall(SYSCALL_TASKID, 0, 0, 0, 0);
+}
+
+/* returns:
+ *   the number of scheduler ticks since the scheduler was started
+ */
+static inline unsigned int
+uptime (void)
+{
+  return syscall(SYSCALL_UPTIME, 0, 0, 0, 0);
+}
+
+/* cpu accounting of a task, times in microseconds */
+struct task_stats
+{
+  unsigned int state;  // see enum task_state in kernel/scheduler.h
+  unsigned long long runtime_us;
+  unsigned long long wait_us;       // ready but waiting for the cpu
+  unsigned int max_latency_us;      // longest wait from ready to running
+  unsigned int switches_voluntary;  // blocked, slept, yielded or exited
+  unsigned int switches_preempted;
+  unsigned int policy;              // the scheduling class, SCHED_
+  unsigned int jobs;                // released jobs of a periodic task
+  unsigned int deadline_misses;
+  unsigned int overruns;            // jobs throttled for using up the budget
+  unsigned int group;               // the reservation group, or 0
+  unsigned int throttles;           // windows in which the group was throttled
+};
+
+/* get the cpu accounting of a task
+ *
+ * params:
+ *   id - a task id, or 0 for the idle task
+ *
+ * returns:
+ *   0 on success, -EINVAL if no task with the id exists
+ */
+static inline int
+task_stats (unsigned int id, struct task_stats *stats)
+{
+  return syscall(SYSCALL_TASK_STATS, id, (unsigned int) stats, 0, 0);
+}
+
+/* make the calling task a periodic real-time task, or a normal task again
+ *
+ * a periodic task runs one job per period: a job is released at the start
+ * of every period and completes with task_wait_period. the real-time tasks
+ * run before all normal tasks, by earliest absolute deadline (SCHED_EDF) or
+ * by shortest relative deadline (SCHED_RM, rate monotonic if the deadline
+ * is the period). a job that used up its budget is throttled until the next
+ * release. releases happen on timer ticks, so the period is rounded up and
+ * the deadline down to whole ticks, see TICK_US in kernel/scheduler.h.
+ *
+ * a task is only admitted if the sum of budget per deadline of all real-time
+ * tasks stays within 100% for SCHED_EDF, or within the Liu and Layland bound
+ * n * (2^(1/n) - 1) of n tasks for SCHED_RM. all real-time tasks have to use
+ * the same class.
+ *
+ * params:
+ *   policy      - SCHED_EDF or SCHED_RM, SCHED_NORMAL to leave the
+ *                 real-time class
+ *   period_us   - the time between two releases
+ *   budget_us   - the cpu time of a job
+ *   deadline_us - the time from the release by which a job has to complete,
+ *                 at most period_us, or 0 for period_us
+ *
+ * returns:
+ *   0 on success, -EINVAL for invalid parameters, or -EBUSY if the task
+ *   would make the real-time tasks unschedulable or is in a reservation
+ *   group
+ */
+static inline int
+task_periodic (unsigned int policy, unsigned int period_us,
+               unsigned int budget_us, unsigned int deadline_us)
+{
+  return syscall(SYSCALL_TASK_PERIODIC, policy, period_us, budget_us,
+                 deadline_us);
+}
+
+/* complete the current job of a periodic task and sleep until the release
+ * of the next one. a job that overran into the next period completes that
+ * job, too.
+ *
+ * returns:
+ *   0 on success, -EINVAL if the task is not periodic
+ */
+static inline int
+task_wait_period (void)
+{
+  return syscall(SYSCALL_WAIT_PERIOD, 0, 0, 0, 0);
+}
+
+/* limit the cpu time of the calling task, together with the other tasks of
+ * its group
+ *
+ * the tasks of a group share a budget of cpu time per window. once they
+ * used it up, they are throttled until the next window, even if the cpu
+ * would be idle otherwise. the budget is enforced on timer ticks, time used
+ * beyond it is taken from the next window. windows are rounded up to whole
+ * ticks, see TICK_US in kernel/scheduler.h. forked tasks stay in the group
+ * of their parent.
+ *
+ * the budgets per window of all groups may add up to at most 100%.
+ * real-time tasks have budgets of their own and can't join a group.
+ *
+ * params:
+ *   group     - 1 to RESERVATION_GROUPS, or 0 to leave the group
+ *   budget_us - the cpu time of the group per window, 0 to join a group
+ *               with its current budget and window
+ *   window_us - the length of a window
+ *
+ * returns:
+ *   0 on success, -EINVAL for invalid parameters, or -EBUSY if the task is
+ *   a real-time task or the budgets would exceed the cpu
+ */
+static inline int
+task_reserve (unsigned int group, unsigned int budget_us,
+              unsigned int window_us)
+{
+  return syscall(SYSCALL_TASK_RESERVE, group, budget_us, window_us, 0);
+}
+
+/* write len characters from buf to the console
+ *
+ * params:
+ *   buf - in the heap, on the stack or in the packet buffer window of the
+ *         calling task
+ *
+ * returns:
+ *   the number of characters written, or -EFAULT if buf is not readable by
+ *   the task
+ */
+static inline int
+console_write (const char *buf, unsigned int len)
+{
+  return syscall(SYSCALL_WRITE, (unsigned int) buf, len, 0, 0);
+}
+
+/* create a copy of the calling task, see fork_current_task in
+ * kernel/scheduler.h for the restrictions
+ *
+ * returns:
+ *   the task id of the child in the parent, 0 in the child, or a negative
+ *   error number
+ */
+static inline int
+task_fork (void)
+{
+  return syscall(SYSCALL_FORK, 0, 0, 0, 0);
+}
+
+/* grow the heap of the calling task, the memory is backed on first touch
+ *
+ * returns:
+ *   the previous end of the heap, or (void*)-1 if the task region is full
+ */
+static inline void*
+sbrk (int increment)
+{
+  unsigned int res = syscall(SYSCALL_SBRK, increment, 0, 0, 0);
+  if (res >= (unsigned int) -4095)
+    return (void*) -1;
+  return (void*) res;
+}
+
+// ## Sockets
+//
+// a subset of the bsd socket interface. calls that block return -ERESTART
+// from the kernel once the task was woken up, and are simply repeated.
+
+#define AF_INET 2
+
+#define SOCK_STREAM   1
+#define SOCK_DGRAM    2
+#define SOCK_NONBLOCK 0x100  // fail with -EAGAIN instead of blocking
+
+#define IPPROTO_TCP 6
+#define TCP_NODELAY 1  // send small segments at once instead of coalescing
+
+/* addresses and ports in network byte order, see kernel/net/net.h */
+struct sockaddr_in
+{
+  unsigned short sin_family;
+  unsigned short sin_port;
+  unsigned int sin_addr;
+};
+
+/* a datagram received with recv_zc */
+struct msg_zc
+{
+  const void *data;
+  unsigned int length;
+  struct sockaddr_in from;
+};
+
+/* create a socket, owned by the calling task
+ *
+ * params:
+ *   domain   - AF_INET
+ *   type     - SOCK_STREAM or SOCK_DGRAM, optionally or'ed with
+ *              SOCK_NONBLOCK
+ *   protocol - 0
+ *
+ * returns:
+ *   the socket descriptor, or a negative error number
+ */
+static inline int
+socket (int domain, int type, int protocol)
+{
+  if (domain != AF_INET || protocol)
+    return -EINVAL;
+  return syscall(SYSCALL_SOCKET, type, 0, 0, 0);
+}
+
+/* bind a socket to a local address, a zero port selects an ephemeral port
+ */
+static inline int
+bind (int fd, const struct sockaddr_in *addr)
+{
+  return syscall(SYSCALL_BIND, fd, addr->sin_addr, addr->sin_port, 0);
+}
+
+/* send a datagram
+ *
+ * returns:
+ *   the number of bytes sent, or a negative error number
+ */
+static inline int
+sendto (int fd, const void *buf, unsigned int len, const struct sockaddr_in *to)
+{
+  return syscall(SYSCALL_SENDTO, fd, (unsigned int) buf, len, (unsigned int) to);
+}
+
+/* receive a datagram, blocking until one arrives unless the socket was
+ * created with SOCK_NONBLOCK. the datagram is truncated to len bytes.
+ *
+ * params:
+ *   from - receives the sender, may be NULL
+ *
+ * returns:
+ *   the number of bytes received, or a negative error number
+ */
+static inline int
+recvfrom (int fd, void *buf, unsigned int len, struct sockaddr_in *from)
+{
+  int res;
+  while ((res = syscall(SYSCALL_RECVFROM, fd, (unsigned int) buf, len,
+                        (unsigned int) from)) == -ERESTART);
+  return res;
+}
+
+/* close a socket. a stream is shut down in the background, or reset if
+ * received data was not read. datagram sockets drop their queued data.
+ */
+static inline int
+close (int fd)
+{
+  return syscall(SYSCALL_CLOSE, fd, 0, 0, 0);
+}
+
+/* receive a datagram without copying it
+ *
+ * the packet buffer is mapped read only into the calling task, msg->data
+ * points to the payload. the buffer has to be returned with zc_free. at
+ * most TASK_WINDOW_PAGES buffers can be held at a time.
+ *
+ * returns:
+ *   0 on success, or a negative error number
+ */
+static inline int
+recv_zc (int fd, struct msg_zc *msg)
+{
+  int res;
+  while ((res = syscall(SYSCALL_RECV_ZC, fd, (unsigned int) msg, 0, 0))
+         == -ERESTART);
+  return res;
+}
+
+/* borrow a packet buffer to fill for sendto_zc
+ *
+ * returns:
+ *   a writable buffer of at least len bytes, or NULL if none is available
+ */
+static inline void*
+zc_alloc (unsigned int len)
+{
+  unsigned int res = syscall(SYSCALL_ZC_ALLOC, len, 0, 0, 0);
+  if (res >= (unsigned int) -4095)
+    return (void*) 0;
+  return (void*) res;
+}
+
+/* return a buffer obtained from recv_zc or zc_alloc */
+static inline int
+zc_free (const void *data)
+{
+  return syscall(SYSCALL_ZC_FREE, (unsigned int) data, 0, 0, 0);
+}
+
+/* send a buffer obtained from zc_alloc without copying it, the buffer is
+ * handed over to the kernel even if sending fails
+ *
+ * returns:
+ *   the number of bytes sent, or a negative error number
+ */
+static inline int
+sendto_zc (int fd, void *data, unsigned int len, const struct sockaddr_in *to)
+{
+  return syscall(SYSCALL_SENDTO_ZC, fd, (unsigned int) data, len, (unsigned int) to);
+}
+
+/* connect a stream socket, blocking until the connection is established
+ * unless the socket was created with SOCK_NONBLOCK
+ *
+ * returns:
+ *   0 on success, or a negative error number
+ */
+static inline int
+connect (int fd, const struct sockaddr_in *addr)
+{
+  int res;
+  while ((res = syscall(SYSCALL_CONNECT, fd, addr->sin_addr, addr->sin_port,
+                        0)) == -ERESTART);
+  return res;
+}
+
+/* accept connections on a bound stream socket
+ *
+ * params:
+ *   backlog - connections held until they are accepted
+ */
+static inline int
+listen (int fd, int backlog)
+{
+  return syscall(SYSCALL_LISTEN, fd, backlog, 0, 0);
+}
+
+/* take the next connection of a listening socket, blocking until one is
+ * established unless the socket was created with SOCK_NONBLOCK. the
+ * connection inherits SOCK_NONBLOCK from the listening socket
+ *
+ * params:
+ *   from - receives the address of the peer, may be NULL
+ *
+ * returns:
+ *   the socket descriptor of the connection, or a negative error number
+ */
+static inline int
+accept (int fd, struct sockaddr_in *from)
+{
+  int res;
+  while ((res = syscall(SYSCALL_ACCEPT, fd, (unsigned int) from, 0, 0))
+         == -ERESTART);
+  return res;
+}
+
+/* queue data on a stream, blocking while the send buffer is full
+ *
+ * returns:
+ *   the number of bytes queued, which may be less than len, or a negative
+ *   error number
+ */
+static inline int
+send (int fd, const void *buf, unsigned int len)
+{
+  int res;
+  while ((res = syscall(SYSCALL_SEND, fd, (unsigned int) buf, len, 0))
+         == -ERESTART);
+  return res;
+}
+
+/* read from a stream, blocking until data arrives
+ *
+ * returns:
+ *   the number of bytes read, 0 at the end of the stream, or a negative
+ *   error number
+ */
+static inline int
+recv (int fd, void *buf, unsigned int len)
+{
+  int res;
+  while ((res = syscall(SYSCALL_RECV, fd, (unsigned int) buf, len, 0))
+         == -ERESTART);
+  return res;
+}
+
+/* set a socket option, only TCP_NODELAY at level IPPROTO_TCP is supported
+ */
+static inline int
+setsockopt (int fd, int level, int name, int value)
+{
+  return syscall(SYSCALL_SETSOCKOPT, fd, level, name, value);
+}
+
+/* look up the address of a host name, blocking until the dns server answers
+ *
+ * answers are cached by the kernel, so repeated lookups of a name don't
+ * leave the system until its time to live runs out. addresses in dotted
+ * decimal notation are returned as they are.
+ *
+ * params:
+ *   addr - receives the address in network byte order
+ *
+ * returns:
+ *   0 on success, -ENOENT if the name has no address, -ETIMEDOUT if the
+ *   server does not answer, -ENETUNREACH if no server is known, or another
+ *   negative error number
+ */
+static inline int
+resolve (const char *name, unsigned int *addr)
+{
+  unsigned int len = 0;
+  while (name[len])
+    ++len;
+
+  int res;
+  while ((res = syscall(SYSCALL_RESOLVE, (unsigned int) name, len,
+                        (unsigned int) addr, 0)) == -ERESTART);
+  return res;
+}
+
+// interrupt coalescing parameters of the ethernet interface
+#define NETIF_RX_FRAMES 1  // frames per poll that keep the interrupts masked
+#define NETIF_RX_USECS  2  // how long to wait for more frames, 0 disables
+#define NETIF_TX_FRAMES 3  // frames queued before transmission starts
+
+#define NETIF_RX_USECS_MAX 1000
+
+/* get and set an interrupt coalescing parameter of the ethernet interface
+ *
+ * the driver statistics report the resulting interrupts per frame, see
+ * kernel/drivers/smc91c111.h
+ *
+ * params:
+ *   param - one of the NETIF_* parameters above
+ *   value - the new value, or -1 to leave the parameter unchanged
+ *
+ * returns:
+ *   the previous value, -EINVAL for unknown parameters and values out of
+ *   range, or -ENODEV if there is no ethernet interface
+ */
+static inline int
+netif_tune (int param, int value)
+{
+  return syscall(SYSCALL_NETIF_TUNE, param, value, 0, 0);
+}
+
+// ## Profiling
+//
+// the kernel samples the interrupted instruction and task on every timer
+// tick, see kernel/profile.h. the profiler runs from boot on, and keeps the
+// most recent PROFILE_SAMPLES samples.
+
+#define PROFILE_START 0
+#define PROFILE_STOP  1
+#define PROFILE_DUMP  2
+
+/* drop the samples taken so far and start sampling */
+static inline void
+profile_start (void)
+{
+  syscall(SYSCALL_PROFILE, PROFILE_START, 0, 0, 0);
+}
+
+/* stop sampling, the samples are kept */
+static inline void
+profile_stop (void)
+{
+  syscall(SYSCALL_PROFILE, PROFILE_STOP, 0, 0, 0);
+}
+
+/* stop sampling and print the samples to the console, one line per sample
+ * in the form "profile: <address> <task id|idle|kernel>". the output is
+ * symbolised on the host with scripts/profile.py.
+ *
+ * the samples are printed in chunks, interrupts are served between them.
+ */
+static inline void
+profile_dump (void)
+{
+  while (syscall(SYSCALL_PROFILE, PROFILE_DUMP, 0, 0, 0) > 0);
+}
+
+// ## Tracing
+//
+// with --enable-trace, the kernel records scheduling, interrupt and driver
+// events, see kernel/trace.h. the trace runs from boot on, and keeps the most
+// recent TRACE_RECORDS events. without it, these calls return -ENOSYS.
+
+#define TRACE_START 0
+#define TRACE_STOP  1
+#define TRACE_DUMP  2
+
+/* drop the events recorded so far and start tracing */
+static inline int
+trace_start (void)
+{
+  return syscall(SYSCALL_TRACE, TRACE_START, 0, 0, 0);
+}
+
+/* stop tracing, the events are kept */
+static inline int
+trace_stop (void)
+{
+  return syscall(SYSCALL_TRACE, TRACE_STOP, 0, 0, 0);
+}
+
+/* stop tracing and print the events to the console, one line of hex words
+ * per event. the output is converted to the chrome trace format on the host
+ * with scripts/trace.py.
+ */
+static inline int
+trace_dump (void)
+{
+  int res;
+  while ((res = syscall(SYSCALL_TRACE, TRACE_DUMP, 0, 0, 0)) > 0);
+  return res;
+}
+
+// ## Benchmarks
+
+/* copy a histogram of the interrupt latency harness, which is only filled
+ * in benchmark builds, see kernel/bench/bench_latency.h
+ *
+ * params:
+ *   point - the latency point, LATENCY_ENTRY or LATENCY_RESUME
+ *   hist  - room for LATENCY_BUCKETS counts
+ *
+ * returns:
+ *   0 on success, -EINVAL for an unknown point or -EFAULT if hist is not
+ *   writable by the task
+ */
+static inline int
+latency_read (unsigned int point, unsigned int *hist)
+{
+  return syscall(SYSCALL_LATENCY, point, (unsigned int) hist, 0, 0);
+}
+
+struct softirq_stats;
+
+/* copy the statistics of a bottom half, see kernel/softirq.h
+ *
+ * params:
+ *   nr    - the softirq, below SOFTIRQ_COUNT
+ *   stats - room for a struct softirq_stats, the name points into the
+ *           kernel image
+ *
+ * returns:
+ *   0 on success, -EINVAL for an unknown softirq or -EFAULT if stats is not
+ *   writable by the task
+ */
+static inline int
+softirq_read (unsigned int nr, struct softirq_stats *stats)
+{
+  return syscall(SYSCALL_SOFTIRQ_STATS, nr, (unsigned int) stats, 0, 0);
+}
+
+#endif
@@ -0,0 +1,80 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "timeout.h"
+
+#include "kernel/memory.h"
+#include "kernel/scheduler.h"
+
+static struct timeout *timeouts = 0;
+
+void
+timeout_set (struct timeout *t, void (*fn) (void *arg), void *arg)
+{
+  t->next = 0;
+  t->expires = 0;
+  t->fn = fn;
+  t->arg = arg;
+  t->pending = 0;
+}
+
+void
+timeout_add (struct timeout *t, unsigned int ticks)
+{
+  timeout_del(t);
+
+  t->expires = tick_count + (ticks ? ticks : 1);
+  t->pending = 1;
+
+  struct timeout **pos = &timeouts;
+  while (*pos && (int)((*pos)->expires - t->expires) <= 0)
+    pos = &(*pos)->next;
+  t->next = *pos;
+  *pos = t;
+}
+
+void
+timeout_del (struct timeout *t)
+{
+  if (!t->pending)
+    return;
+
+  struct timeout **pos = &timeouts;
+  while (*pos != t)
+    pos = &(*pos)->next;
+  *pos = t->next;
+
+  t->next = 0;
+  t->pending = 0;
+}
+
+void
+__fasttext
+timeout_run (void)
+{
+  while (timeouts && (int)(tick_count - timeouts->expires) >= 0)
+    {
+      struct timeout *t = timeouts;
+      timeouts = t->next;
+      t->next = 0;
+      t->pending = 0;
+      t->fn(t->arg);
+    }
+}
@@ -0,0 +1,69 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* one-shot kernel timers, run from the timer bottom half
+ *
+ * pending timeouts are kept in a list sorted by expiry, so a tick only looks
+ * at the head of the list and the cost of a timer is paid when it is armed,
+ * not on every tick. the structures are embedded into their owners and must
+ * stay valid while the timeout is pending.
+ */
+
+struct timeout
+{
+  struct timeout *next;
+  unsigned int expires;  // in tick_count
+  void (*fn) (void *arg);
+  void *arg;
+  int pending;
+};
+
+/* initialize a timeout with its callback, the timeout is not armed
+ */
+void timeout_set (struct timeout *t, void (*fn) (void *arg), void *arg);
+
+/* arm a timeout, or move it if it is already pending
+ *
+ * params:
+ *   t     - the timeout
+ *   ticks - the delay in timer ticks, at least one tick
+ */
+void timeout_add (struct timeout *t, unsigned int ticks);
+
+/* disarm a timeout, does nothing if it is not pending
+ */
+void timeout_del (struct timeout *t);
+
+static inline int
+timeout_pending (const struct timeout *t)
+{
+  return t->pending;
+}
+
+/* called from the timer bottom half, runs the callbacks of expired timeouts.
+ * a callback may arm or disarm any timeout, including its own.
+ */
+void timeout_run (void);
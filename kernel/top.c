@@ -0,0 +1,92 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "top.h"
+
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+
+#include <stdio.h>
+
+static const char *state_names[] =
+{
+  [TASK_UNUSED]   = "unused",
+  [TASK_READY]    = "ready",
+  [TASK_RUNNING]  = "running",
+  [TASK_SLEEPING] = "sleeping",
+  [TASK_BLOCKED]  = "blocked",
+};
+
+void
+top_task (void)
+{
+  // the runtime of every task at the previous report, on the stack since
+  // tasks can't write the kernel's data
+  unsigned long long last[MAX_TASK_NUMBER + 1] = { 0 };
+
+  while (1)
+    {
+      task_sleep(MS_TO_TICKS(TOP_PERIOD_MS));
+
+      struct task_stats stats[MAX_TASK_NUMBER + 1];
+      unsigned long long delta[MAX_TASK_NUMBER + 1];
+      unsigned long long total = 0;
+      unsigned int id;
+      for (id = 0; id <= MAX_TASK_NUMBER; ++id)
+        {
+          delta[id] = 0;
+          if (task_stats(id, &stats[id]) < 0)
+            {
+              stats[id].state = TASK_UNUSED;
+              last[id] = 0;
+              continue;
+            }
+
+          // the slot may have been reused since the last report
+          unsigned long long runtime = stats[id].runtime_us;
+          delta[id] = runtime >= last[id] ? runtime - last[id] : runtime;
+          last[id] = runtime;
+          total += delta[id];
+        }
+
+      for (id = 0; id <= MAX_TASK_NUMBER; ++id)
+        {
+          if (stats[id].state == TASK_UNUSED)
+            continue;
+
+          unsigned int permille = total ? delta[id] * 1000 / total : 0;
+          printf("top: task=%u state=%s cpu=%u.%u%% runtime_ms=%u wait_ms=%u"
+                 " max_latency_us=%u voluntary=%u preempted=%u\n",
+                 id, state_names[stats[id].state], permille / 10, permille % 10,
+                 (unsigned int) (stats[id].runtime_us / 1000),
+                 (unsigned int) (stats[id].wait_us / 1000),
+                 stats[id].max_latency_us, stats[id].switches_voluntary,
+                 stats[id].switches_preempted);
+          if (stats[id].policy != SCHED_NORMAL)
+            printf("top: task=%u class=%s jobs=%u misses=%u overruns=%u\n",
+                   id, stats[id].policy == SCHED_EDF ? "edf" : "rm",
+                   stats[id].jobs, stats[id].deadline_misses,
+                   stats[id].overruns);
+          if (stats[id].group)
+            printf("top: task=%u group=%u throttles=%u\n",
+                   id, stats[id].group, stats[id].throttles);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#include "trace.h"
+
+#include "kernel/memory.h"
+#include "kernel/scheduler.h"
+#include "kernel/syscall.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#if ENABLE_TRACE
+
+struct trace_record trace_buffer[TRACE_RECORDS];
+
+// records appended since the trace was started, the next one is stored at
+// trace_head modulo TRACE_RECORDS
+unsigned int trace_head __fastdata = 0;
+int trace_enabled __fastdata = 1;
+
+// records left to print by a running dump
+static unsigned int dump_next = 0;
+static unsigned int dump_end = 0;
+static int dumping = 0;
+
+unsigned int
+__fasttext
+trace_task (void)
+{
+  unsigned int task = current_task - tasks;
+  return task < MAX_TASK_NUMBER ? task + 1 : 0;
+}
+
+void
+__fasttext
+trace_syscall (unsigned int number, unsigned int arg0)
+{
+  trace(TRACE_SYSCALL, number, arg0);
+}
+
+// print the next chunk of records, oldest first, as hex words. the trace is
+// stopped while the records are printed.
+static int
+dump_chunk (void)
+{
+  if (!dumping)
+    {
+      unsigned int count = trace_head < TRACE_RECORDS ? trace_head : TRACE_RECORDS;
+      dump_next = trace_head - count;
+      dump_end = trace_head;
+      dumping = 1;
+      trace_enabled = 0;
+      printf("trace: begin records=%u total=%u counter_mhz=%u\n",
+             count, trace_head, TIMER_COUNTER_MHZ);
+    }
+
+  unsigned int n;
+  for (n = 0; n < TRACE_DUMP_CHUNK && dump_next != dump_end; ++n)
+    {
+      struct trace_record *record =
+        &trace_buffer[dump_next++ & (TRACE_RECORDS - 1)];
+      printf("trace: %x %x %x %x %x\n", record->time, record->event,
+             record->task, record->arg0, record->arg1);
+    }
+
+  if (dump_next != dump_end)
+    return dump_end - dump_next;
+
+  puts("trace: end");
+  dumping = 0;
+  return 0;
+}
+
+int
+sys_trace (int command)
+{
+  switch (command)
+    {
+    case TRACE_START:
+      trace_head = 0;
+      dumping = 0;
+      trace_enabled = 1;
+      return 0;
+    case TRACE_STOP:
+      trace_enabled = 0;
+      return 0;
+    case TRACE_DUMP:
+      return dump_chunk();
+    default:
+      return -EINVAL;
+    }
+}
+
+#else
+
+void
+trace_syscall (unsigned int number, unsigned int arg0)
+{ }
+
+int
+sys_trace (int command)
+{
+  return -ENOSYS;
+}
+
+#endif
@@ -0,0 +1,124 @@
+
+/******************************************************************************
+ *       ninjastorms - shuriken operating system                              *
+ *                                                                            *
+ *    Copyright (C) 2013 - 2016  Andreas Grapentin et al.                     *
+ *                                                                            *
+ *    This program is free software: you can redistribute it and/or modify    *
+ *    it under the terms of the GNU General Public License as published by    *
+ *    the Free Software Foundation, either version 3 of the License, or       *
+ *    (at your option) any later version.                                     *
+ *                                                                            *
+ *    This program is distributed in the hope that it will be useful,         *
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ *    GNU General Public License for more details.                            *
+ *                                                                            *
+ *    You should have received a copy of the GNU General Public License       *
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ ******************************************************************************/
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kernel/interrupt.h"
+#include "kernel/drivers/timer.h"
+
+/* the kernel trace records scheduling, interrupt and driver events in a
+ * ring buffer of binary records, for debugging scheduling latency without
+ * the overhead of printing. it is compiled in with --enable-trace, otherwise
+ * the trace points compile to nothing.
+ *
+ * the records are printed to the console with trace_dump from
+ * kernel/syscall.h, scripts/trace.py converts the output to the chrome
+ * trace format, which is also read by perfetto.
+ */
+
+// number of records kept, a power of two. once the buffer is full, new
+// records replace the oldest ones.
+#define TRACE_RECORDS 4096
+
+// records printed per call of sys_trace with TRACE_DUMP
+#define TRACE_DUMP_CHUNK 64
+
+// the events and the meaning of their arguments
+enum trace_event
+{
+  TRACE_SWITCH = 1,     // the previous and the next task
+  TRACE_IRQ_ENTRY,      // the interrupt line
+  TRACE_IRQ_EXIT,       // the interrupt line
+  TRACE_SOFTIRQ_ENTRY,  // the softirq number
+  TRACE_SOFTIRQ_EXIT,   // the softirq number and the work done
+  TRACE_SYSCALL,        // the syscall number and the first argument
+  TRACE_WAKE,           // the woken task
+  TRACE_BLOCK,          // the wait queue and the timeout in ticks
+  TRACE_SLEEP,          // the number of ticks
+  TRACE_EXIT,           // the exiting task
+  TRACE_NET_RX,         // the frames received by a poll of the controller
+  TRACE_NET_TX,         // the frames handed to the controller in a batch
+};
+
+/* a record is written in place, tasks are identified by their task id as
+ * reported by taskid, the idle task by 0
+ */
+struct trace_record
+{
+  unsigned int time;     // the free running counter, see timer_counter_read
+  unsigned short event;
+  unsigned short task;   // the running task
+  unsigned int arg0;
+  unsigned int arg1;
+};
+
+#if ENABLE_TRACE
+
+extern struct trace_record trace_buffer[TRACE_RECORDS];
+extern unsigned int trace_head;
+extern int trace_enabled;
+
+unsigned int trace_task (void);
+
+/* append a record to the trace, may be called from any context
+ *
+ * a slot is claimed by incrementing the head with interrupts disabled for
+ * the three instructions that take, since the arm926 has no atomic add. an
+ * interrupt arriving while the record is filled in claims the next slot,
+ * so appends never wait for each other.
+ */
+static inline void
+trace (unsigned int event, unsigned int arg0, unsigned int arg1)
+{
+  if (!trace_enabled)
+    return;
+
+  unsigned int flags = irq_save();
+  unsigned int slot = trace_head++;
+  irq_restore(flags);
+
+  struct trace_record *record = &trace_buffer[slot & (TRACE_RECORDS - 1)];
+  record->time = timer_counter_read();
+  record->event = event;
+  record->task = trace_task();
+  record->arg0 = arg0;
+  record->arg1 = arg1;
+}
+
+#else
+
+static inline void
+trace (unsigned int event, unsigned int arg0, unsigned int arg1)
+{ }
+
+#endif
+
+/* trace point of the syscall entry, called by swi_handler
+ */
+void trace_syscall (unsigned int number, unsigned int arg0);
+
+/* control the trace, see trace_start, trace_stop and trace_dump in
+ * kernel/syscall.h
+ */
+int sys_trace (int command);
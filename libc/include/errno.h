@@ -23,3 +23,21 @@
 extern int errno;
 
 #define ENOSYS 1
+#define ENOMEM 2
+#define EINVAL 3
+#define EAGAIN 4
+#define ENODEV 5
+#define EIO    6
+#define ENETUNREACH 7
+#define EMSGSIZE    8
+#define ERESTART    9
+#define EADDRINUSE  10
+#define EBADF       11
+#define EFAULT      12
+#define ENOBUFS     13
+#define ECONNREFUSED 14
+#define ECONNRESET  15
+#define ENOTCONN    16
+#define ETIMEDOUT   17
+#define ENOENT      18
+#define EBUSY       19
@@ -24,14 +24,7 @@
 
 #include <stdio.h>
 
-#if BOARD_VERSATILEPB
-#  define UART_THR (volatile char*)(0x101f1000)
-#endif
-
-#if BOARD_EV3
-#  define UART_THR (volatile char*)(0x01D0C000)
-#  define UART_LSR (volatile char*)(0x01D0C014)
-#endif
+#include "kernel/board.h"
 
 int
 putchar (int c)
@@ -39,10 +32,6 @@ putchar (int c)
   if (c == '\n')
     putchar('\r');
 
-  #if BOARD_EV3
-  while (!(*UART_LSR & (1 << 5)));
-  #endif
-
-  *UART_THR = c;
+  board_uart_putc(c);
   return c;
 }
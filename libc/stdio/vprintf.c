@@ -105,6 +105,27 @@ vprintf (const char *format, __attribute__((unused)) va_list ap)
                   }
               }
               break;
+            case 'u':
+              {
+                unsigned int x = va_arg(ap, unsigned int);
+                char tmp[10] = { 0 };
+                int i = 0;
+                while (x)
+                  {
+                    tmp[i] = x % 10;
+                    x /= 10;
+                    ++i;
+                  }
+                if (i != 0)
+                  --i;
+                for ( ; i >= 0; --i)
+                  {
+                    if (__builtin_expect(putchar(tmp[i] + '0') == EOF, 0))
+                      return chars_written;
+                    ++chars_written;
+                  }
+              }
+              break;
             case 'x':
               {
                 unsigned int x = va_arg(ap, int);
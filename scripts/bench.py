@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+#
+# ninjastorms - shuriken operating system
+#
+# Copyright (C) 2013 - 2016  Andreas Grapentin et al.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""run the kernel benchmarks in qemu and compare them to a baseline
+
+boots a kernel configured with --enable-benchmark on the versatilepb board,
+collects the bench: lines from the serial console and compares the
+task_switch and syscall_null costs and the memcpy bandwidth to the values
+stored in the baseline:
+
+  $> scripts/bench.py ninjastorms
+  $> scripts/bench.py --update ninjastorms
+
+make check runs it in a build configured with --enable-benchmark for the
+versatilepb board.
+
+the kernel resets the board when the last benchmark task exits, qemu runs
+with -no-reboot, so it exits at that point. the run fails on crashes, on
+failed benchmarks, on a timeout, on missing results and on results that are
+worse than the baseline by more than the tolerance. without a baseline file
+the comparison is skipped, a baseline depends on the machine that runs qemu
+and is not part of the tree. --update records the results of a passing run
+as the new baseline. a
+console log that was captured before is checked with --log instead of
+booting qemu.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import threading
+
+BENCH = re.compile(r'bench: (\S+)((?: \S+=\d+)*)\s*$')
+FAILURE = re.compile(r'crash:|bench: .*(failed|mismatch)')
+DONE = 'bench: done'
+
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        'bench-baseline.json')
+
+# the checked results, by benchmark and metric, and whether larger is better
+CHECKS = [
+    ('task_switch', 'min_ns', False),
+    ('syscall_null', 'min_ns', False),
+    ('memcpy', 'mbps', True),
+]
+
+
+def boot(kernel, timeout):
+    qemu = os.environ.get('QEMU', 'qemu-system-arm')
+    command = [qemu, '-M', 'versatilepb', '-m', '128M', '-nographic',
+               '-no-reboot', '-kernel', kernel]
+    process = subprocess.Popen(command, stdin=subprocess.DEVNULL,
+                               stdout=subprocess.PIPE,
+                               universal_newlines=True, errors='replace')
+    timer = threading.Timer(timeout, process.kill)
+    timer.start()
+    try:
+        for line in process.stdout:
+            sys.stdout.write(line)
+            yield line
+            if line.startswith(DONE):
+                break
+    finally:
+        timer.cancel()
+        process.kill()
+        process.wait()
+
+
+def parse(lines):
+    results, failures, done = {}, [], False
+    for line in lines:
+        line = line.rstrip()
+        if FAILURE.search(line):
+            failures.append(line)
+        if line.startswith(DONE):
+            done = True
+            continue
+        match = BENCH.search(line)
+        if not match:
+            continue
+        values = dict((key, int(value)) for key, value in
+                      (field.split('=') for field in match.group(2).split()))
+        results[match.group(1)] = values
+
+    # the bandwidth in MB/s, from the bytes copied per iteration
+    memcpy = results.get('memcpy')
+    if memcpy and memcpy.get('min_ns'):
+        memcpy['mbps'] = memcpy['bytes'] * 1000 // memcpy['min_ns']
+
+    if not done:
+        failures.append('the benchmarks did not finish')
+    return results, failures
+
+
+def compare(results, baseline, tolerance):
+    failures = []
+    for name, metric, larger in CHECKS:
+        value = results.get(name, {}).get(metric)
+        if value is None:
+            failures.append('%s %s: missing' % (name, metric))
+            continue
+        if baseline is None:
+            print('%-14s %-8s %10d' % (name, metric, value))
+            continue
+        base = baseline.get(name, {}).get(metric)
+        if base is None:
+            print('%-14s %-8s %10d  NO BASELINE' % (name, metric, value))
+            failures.append('%s %s: no baseline, record one with --update'
+                            % (name, metric))
+            continue
+
+        change = 100.0 * (value - base) / base if base else 0.0
+        worse = -change if larger else change
+        verdict = 'ok'
+        if worse > tolerance:
+            verdict = 'REGRESSION'
+            failures.append('%s %s: %d, baseline %d' % (name, metric, value,
+                                                        base))
+        print('%-14s %-8s %10d  baseline %10d  %+6.1f%%  %s'
+              % (name, metric, value, base, change, verdict))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('kernel', nargs='?', default='ninjastorms',
+                        help='the kernel binary, built with '
+                        '--enable-benchmark for versatilepb')
+    parser.add_argument('--log', help='check a captured console log instead '
+                        'of booting the kernel')
+    parser.add_argument('--baseline', default=BASELINE,
+                        help='the baseline file, default %(default)s')
+    parser.add_argument('--tolerance', type=float, default=20.0,
+                        help='the allowed regression in percent, '
+                        'default %(default)s')
+    parser.add_argument('--timeout', type=float, default=600.0,
+                        help='seconds until the run is aborted, '
+                        'default %(default)s')
+    parser.add_argument('--update', action='store_true',
+                        help='store the results as the new baseline')
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log) as log:
+            results, failures = parse(log)
+    else:
+        results, failures = parse(boot(args.kernel, args.timeout))
+
+    baseline = None
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    elif not args.update:
+        print('SKIP: no baseline in %s, the results are not compared, '
+              'record one with --update' % args.baseline)
+
+    if not args.update:
+        failures += compare(results, baseline, args.tolerance)
+    elif not failures:
+        stored = dict((name, {metric: results[name][metric]})
+                      for name, metric, larger in CHECKS
+                      if metric in results.get(name, {}))
+        with open(args.baseline, 'w') as f:
+            json.dump(stored, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('baseline written to %s' % args.baseline)
+
+    for failure in failures:
+        print('FAIL: %s' % failure)
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# ninjastorms - shuriken operating system
+#
+# Copyright (C) 2013 - 2016  Andreas Grapentin et al.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""symbolise a profile dump of the kernel
+
+reads the console output of a profile_dump (see kernel/syscall.h) and
+prints the sampled functions, most frequent first:
+
+  $> qemu-system-arm ... -kernel ninjastorms | tee console.log
+  $> scripts/profile.py ninjastorms console.log
+
+the symbols are read with arm-none-eabi-nm, set NM to use another tool.
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import subprocess
+import sys
+
+SAMPLE = re.compile(r'profile: (0x[0-9a-fA-F]+) (\S+)')
+
+
+def read_symbols(elf):
+    nm = os.environ.get('NM', 'arm-none-eabi-nm')
+    output = subprocess.run([nm, '-n', '--defined-only', elf], check=True,
+                            stdout=subprocess.PIPE, universal_newlines=True)
+    addresses, names = [], []
+    for line in output.stdout.splitlines():
+        fields = line.split()
+        if len(fields) != 3 or fields[1] not in 'tTwW':
+            continue
+        # skip the arm mapping symbols $a, $d and $t
+        if fields[2].startswith('$'):
+            continue
+        addresses.append(int(fields[0], 16))
+        names.append(fields[2])
+    return addresses, names
+
+
+def read_samples(log):
+    # only the last dump of the log is used
+    samples = []
+    for line in log:
+        if 'profile: begin' in line:
+            samples = []
+            continue
+        match = SAMPLE.search(line)
+        if match:
+            samples.append((int(match.group(1), 16), match.group(2)))
+    return samples
+
+
+def symbolise(addresses, names, pc):
+    i = bisect.bisect_right(addresses, pc) - 1
+    if i < 0:
+        return '0x%x' % pc
+    return names[i]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('elf', help='the kernel binary, e.g. ninjastorms')
+    parser.add_argument('log', nargs='?', help='the console output, '
+                        'read from stdin if omitted')
+    parser.add_argument('--by-task', action='store_true',
+                        help='count the functions of every task separately')
+    parser.add_argument('-n', '--lines', type=int, default=30,
+                        help='the number of functions to print')
+    args = parser.parse_args()
+
+    addresses, names = read_symbols(args.elf)
+    with open(args.log) if args.log else sys.stdin as log:
+        samples = read_samples(log)
+    if not samples:
+        sys.exit('no profile dump found')
+
+    counts = collections.Counter()
+    for pc, task in samples:
+        key = symbolise(addresses, names, pc)
+        if args.by_task:
+            key = '%s [%s]' % (key, task)
+        counts[key] += 1
+
+    print('%d samples' % len(samples))
+    for key, count in counts.most_common(args.lines):
+        print('%6.2f%% %6d  %s' % (100.0 * count / len(samples), count, key))
+
+
+if __name__ == '__main__':
+    main()
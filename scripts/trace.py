@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+#
+# ninjastorms - shuriken operating system
+#
+# Copyright (C) 2013 - 2016  Andreas Grapentin et al.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""convert a kernel trace dump to the chrome trace format
+
+reads the console output of a trace_dump (see kernel/syscall.h) and writes
+a json file for chrome://tracing or https://ui.perfetto.dev:
+
+  $> qemu-system-arm ... -kernel ninjastorms | tee console.log
+  $> scripts/trace.py console.log -o trace.json
+
+the record layout and the event numbers follow kernel/trace.h.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+BEGIN = re.compile(r'trace: begin .*counter_mhz=(\d+)')
+RECORD = re.compile(r'trace: ((?:[0-9a-fA-F]+ ){4}[0-9a-fA-F]+)\s*$')
+
+(SWITCH, IRQ_ENTRY, IRQ_EXIT, SOFTIRQ_ENTRY, SOFTIRQ_EXIT, SYSCALL, WAKE,
+ BLOCK, SLEEP, EXIT, NET_RX, NET_TX) = range(1, 13)
+
+SOFTIRQS = ['timer', 'net_rx']
+
+# the lanes of the trace, tasks get a lane each behind these
+CPU_LANE = 0
+IRQ_LANE = 1
+SOFTIRQ_LANE = 2
+TASK_LANE = 10
+
+
+def syscall_names():
+    # the syscall numbers are taken from the kernel sources next to the script
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          '..', 'kernel', 'syscall.h')
+    names = {}
+    try:
+        with open(header) as f:
+            for name, number in re.findall(r'#define SYSCALL_(\w+)\s+(\d+)',
+                                           f.read()):
+                if name != 'COUNT':
+                    names[int(number)] = name.lower()
+    except OSError:
+        pass
+    return names
+
+
+def read_records(log):
+    # only the last dump of the log is used
+    mhz, records = 1, []
+    for line in log:
+        match = BEGIN.search(line)
+        if match:
+            mhz, records = int(match.group(1)), []
+            continue
+        match = RECORD.search(line)
+        if match:
+            records.append([int(x, 16) for x in match.group(1).split()])
+    return mhz, records
+
+
+def task_name(task):
+    return 'idle' if task == 0 else 'task %d' % task
+
+
+def convert(mhz, records):
+    syscalls = syscall_names()
+    events = []
+    tasks = set()
+
+    def emit(ph, lane, name, ts, **kw):
+        event = {'ph': ph, 'pid': 0, 'tid': lane, 'name': name, 'ts': ts}
+        event.update(kw)
+        events.append(event)
+
+    # the counter wraps around at 2^32, records are assumed to be less than a
+    # full wrap apart
+    elapsed, last = 0, records[0][0]
+    running, since = records[0][2], 0.0
+    ts = 0.0
+    for time, event, task, arg0, arg1 in records:
+        elapsed += (time - last) & 0xFFFFFFFF
+        last = time
+        ts = elapsed / mhz
+        tasks.add(task)
+
+        if event == SWITCH:
+            emit('X', CPU_LANE, task_name(running), since, dur=ts - since)
+            running, since = arg1, ts
+            tasks.add(arg1)
+        elif event == IRQ_ENTRY:
+            emit('B', IRQ_LANE, 'irq %d' % arg0, ts)
+        elif event == IRQ_EXIT:
+            emit('E', IRQ_LANE, 'irq %d' % arg0, ts)
+        elif event == SOFTIRQ_ENTRY:
+            name = SOFTIRQS[arg0] if arg0 < len(SOFTIRQS) else 'softirq %d' % arg0
+            emit('B', SOFTIRQ_LANE, name, ts)
+        elif event == SOFTIRQ_EXIT:
+            name = SOFTIRQS[arg0] if arg0 < len(SOFTIRQS) else 'softirq %d' % arg0
+            emit('E', SOFTIRQ_LANE, name, ts, args={'work': arg1})
+        elif event == SYSCALL:
+            name = syscalls.get(arg0, 'syscall %d' % arg0)
+            emit('i', TASK_LANE + task, name, ts, s='t', args={'arg0': '0x%x' % arg1})
+        elif event == WAKE:
+            emit('i', TASK_LANE + arg0, 'wake', ts, s='t', args={'by': task_name(task)})
+            tasks.add(arg0)
+        elif event == BLOCK:
+            emit('i', TASK_LANE + task, 'block', ts, s='t',
+                 args={'queue': '0x%x' % arg0, 'timeout': arg1})
+        elif event == SLEEP:
+            emit('i', TASK_LANE + task, 'sleep', ts, s='t', args={'ticks': arg0})
+        elif event == EXIT:
+            emit('i', TASK_LANE + arg0, 'exit', ts, s='t')
+        elif event == NET_RX:
+            emit('C', SOFTIRQ_LANE, 'net_rx', ts, args={'frames': arg0})
+        elif event == NET_TX:
+            emit('C', SOFTIRQ_LANE, 'net_tx', ts, args={'frames': arg0})
+
+    emit('X', CPU_LANE, task_name(running), since, dur=ts - since)
+
+    lanes = {CPU_LANE: 'cpu', IRQ_LANE: 'irq', SOFTIRQ_LANE: 'softirq'}
+    for task in tasks:
+        lanes[TASK_LANE + task] = task_name(task)
+    for lane, name in lanes.items():
+        events.append({'ph': 'M', 'pid': 0, 'tid': lane, 'name': 'thread_name',
+                       'args': {'name': name}})
+    events.append({'ph': 'M', 'pid': 0, 'name': 'process_name',
+                   'args': {'name': 'ninjastorms'}})
+    return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', help='the console output, '
+                        'read from stdin if omitted')
+    parser.add_argument('-o', '--output', help='the json file to write, '
+                        'stdout if omitted')
+    args = parser.parse_args()
+
+    with open(args.log) if args.log else sys.stdin as log:
+        mhz, records = read_records(log)
+    if not records:
+        sys.exit('no trace dump found')
+
+    trace = convert(mhz, records)
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        print()
+
+
+if __name__ == '__main__':
+    main()